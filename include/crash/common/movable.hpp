@@ -35,6 +35,12 @@ public:
 
    virtual void move(float delta_t);
 
+   /**
+    * Determine if any velocity of this Movable is non-zero, such that moving
+    * it would change its transform.
+    */
+   bool isMoving() const;
+
    glm::vec3 getUp();
    glm::vec3 getForward();
 
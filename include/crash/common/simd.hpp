@@ -0,0 +1,269 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX__)
+#  include <immintrin.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+namespace crash {
+namespace common {
+namespace simd {
+
+/**
+ * A packed vector of single-precision floats.
+ *
+ * The width of the vector is selected at compile time from the widest
+ * instruction set the translation unit is built for: 8 lanes with AVX, 4 lanes
+ * with SSE2, and a single lane otherwise. Algorithms written against this type
+ * should iterate in steps of Float::WIDTH and finish any remainder with scalar
+ * code.
+ *
+ * Comparisons produce masks in the same representation: every bit of a lane is
+ * set when the comparison holds and cleared otherwise.
+ */
+#if defined(__AVX__)
+
+struct Float {
+   static const unsigned int WIDTH = 8;
+
+   Float() {}
+   Float(__m256 value) : value(value) {}
+
+   __m256 value;
+};
+
+inline Float load(const float* source) {
+   return _mm256_loadu_ps(source);
+}
+
+inline void store(float* destination, const Float& f) {
+   _mm256_storeu_ps(destination, f.value);
+}
+
+inline Float broadcast(float f) {
+   return _mm256_set1_ps(f);
+}
+
+inline Float operator+(const Float& a, const Float& b) {
+   return _mm256_add_ps(a.value, b.value);
+}
+
+inline Float operator-(const Float& a, const Float& b) {
+   return _mm256_sub_ps(a.value, b.value);
+}
+
+inline Float operator*(const Float& a, const Float& b) {
+   return _mm256_mul_ps(a.value, b.value);
+}
+
+inline Float operator&(const Float& a, const Float& b) {
+   return _mm256_and_ps(a.value, b.value);
+}
+
+inline Float operator|(const Float& a, const Float& b) {
+   return _mm256_or_ps(a.value, b.value);
+}
+
+inline Float andNot(const Float& a, const Float& b) {
+   return _mm256_andnot_ps(a.value, b.value);
+}
+
+inline Float min(const Float& a, const Float& b) {
+   return _mm256_min_ps(a.value, b.value);
+}
+
+inline Float max(const Float& a, const Float& b) {
+   return _mm256_max_ps(a.value, b.value);
+}
+
+inline Float lessThan(const Float& a, const Float& b) {
+   return _mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ);
+}
+
+inline Float greaterThan(const Float& a, const Float& b) {
+   return _mm256_cmp_ps(a.value, b.value, _CMP_GT_OQ);
+}
+
+inline Float select(const Float& mask, const Float& a, const Float& b) {
+   return _mm256_blendv_ps(b.value, a.value, mask.value);
+}
+
+inline unsigned int bits(const Float& mask) {
+   return _mm256_movemask_ps(mask.value);
+}
+
+#elif defined(__SSE2__)
+
+struct Float {
+   static const unsigned int WIDTH = 4;
+
+   Float() {}
+   Float(__m128 value) : value(value) {}
+
+   __m128 value;
+};
+
+inline Float load(const float* source) {
+   return _mm_loadu_ps(source);
+}
+
+inline void store(float* destination, const Float& f) {
+   _mm_storeu_ps(destination, f.value);
+}
+
+inline Float broadcast(float f) {
+   return _mm_set1_ps(f);
+}
+
+inline Float operator+(const Float& a, const Float& b) {
+   return _mm_add_ps(a.value, b.value);
+}
+
+inline Float operator-(const Float& a, const Float& b) {
+   return _mm_sub_ps(a.value, b.value);
+}
+
+inline Float operator*(const Float& a, const Float& b) {
+   return _mm_mul_ps(a.value, b.value);
+}
+
+inline Float operator&(const Float& a, const Float& b) {
+   return _mm_and_ps(a.value, b.value);
+}
+
+inline Float operator|(const Float& a, const Float& b) {
+   return _mm_or_ps(a.value, b.value);
+}
+
+inline Float andNot(const Float& a, const Float& b) {
+   return _mm_andnot_ps(a.value, b.value);
+}
+
+inline Float min(const Float& a, const Float& b) {
+   return _mm_min_ps(a.value, b.value);
+}
+
+inline Float max(const Float& a, const Float& b) {
+   return _mm_max_ps(a.value, b.value);
+}
+
+inline Float lessThan(const Float& a, const Float& b) {
+   return _mm_cmplt_ps(a.value, b.value);
+}
+
+inline Float greaterThan(const Float& a, const Float& b) {
+   return _mm_cmpgt_ps(a.value, b.value);
+}
+
+inline Float select(const Float& mask, const Float& a, const Float& b) {
+   return _mm_or_ps(_mm_and_ps(mask.value, a.value),
+    _mm_andnot_ps(mask.value, b.value));
+}
+
+inline unsigned int bits(const Float& mask) {
+   return _mm_movemask_ps(mask.value);
+}
+
+#else
+
+struct Float {
+   static const unsigned int WIDTH = 1;
+
+   Float() {}
+   Float(float value) : value(value) {}
+
+   float value;
+};
+
+inline std::uint32_t toBits(float f) {
+   std::uint32_t u;
+   std::memcpy(&u, &f, sizeof(u));
+   return u;
+}
+
+inline float fromBits(std::uint32_t u) {
+   float f;
+   std::memcpy(&f, &u, sizeof(f));
+   return f;
+}
+
+inline Float fromCondition(bool condition) {
+   return fromBits(condition ? 0xFFFFFFFFu : 0u);
+}
+
+inline Float load(const float* source) {
+   return *source;
+}
+
+inline void store(float* destination, const Float& f) {
+   *destination = f.value;
+}
+
+inline Float broadcast(float f) {
+   return f;
+}
+
+inline Float operator+(const Float& a, const Float& b) {
+   return a.value + b.value;
+}
+
+inline Float operator-(const Float& a, const Float& b) {
+   return a.value - b.value;
+}
+
+inline Float operator*(const Float& a, const Float& b) {
+   return a.value * b.value;
+}
+
+inline Float operator&(const Float& a, const Float& b) {
+   return fromBits(toBits(a.value) & toBits(b.value));
+}
+
+inline Float operator|(const Float& a, const Float& b) {
+   return fromBits(toBits(a.value) | toBits(b.value));
+}
+
+inline Float andNot(const Float& a, const Float& b) {
+   return fromBits(~toBits(a.value) & toBits(b.value));
+}
+
+inline Float min(const Float& a, const Float& b) {
+   return (a.value < b.value) ? a : b;
+}
+
+inline Float max(const Float& a, const Float& b) {
+   return (a.value > b.value) ? a : b;
+}
+
+inline Float lessThan(const Float& a, const Float& b) {
+   return fromCondition(a.value < b.value);
+}
+
+inline Float greaterThan(const Float& a, const Float& b) {
+   return fromCondition(a.value > b.value);
+}
+
+inline Float select(const Float& mask, const Float& a, const Float& b) {
+   return (toBits(mask.value) >> 31) ? a : b;
+}
+
+inline unsigned int bits(const Float& mask) {
+   return toBits(mask.value) >> 31;
+}
+
+#endif
+
+/**
+ * Calculate the absolute value of every lane by clearing the sign bits.
+ */
+inline Float abs(const Float& f) {
+   return andNot(broadcast(-0.0f), f);
+}
+
+} // namespace simd
+} // namespace common
+} // namespace crash
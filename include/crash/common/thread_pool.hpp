@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace crash {
+namespace common {
+
+class ThreadPool;
+typedef std::shared_ptr< ThreadPool > ThreadPoolPtr;
+
+/**
+ * A fixed set of worker threads that cooperatively run batches of tasks.
+ *
+ * A batch is a task function invoked once per index. Workers claim indices
+ * from a shared counter, so uneven tasks are balanced automatically. The
+ * thread that submits a batch takes part in running it and returns once
+ * every index has finished.
+ */
+class ThreadPool {
+public:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * :param task:   The index of the task to run.
+    * :param thread: The index of the thread running the task, in the range
+    *                [0, getNumThreads()). The submitting thread is 0.
+    */
+   typedef std::function< void(unsigned int task, unsigned int thread) > Task;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Constructors.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * :param numThreads: The number of threads that run each batch, including
+    *                    the submitting thread. A pool of one thread runs
+    *                    every batch serially.
+    */
+   ThreadPool(unsigned int numThreads);
+   ThreadPool();
+   virtual ~ThreadPool();
+
+   ThreadPool(const ThreadPool& threadPool) = delete;
+   ThreadPool& operator=(const ThreadPool& threadPool) = delete;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Execution.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Run the given task once for every index in [0, numTasks) and wait for all
+    * of them to finish. Batches may not be submitted concurrently or from
+    * within a task.
+    *
+    * :param numTasks: The number of task indices.
+    * :param task:     The task to run.
+    */
+   void run(unsigned int numTasks, const Task& task);
+
+   unsigned int getNumThreads() const;
+
+   /**
+    * Determine the number of threads the hardware can run concurrently.
+    */
+   static unsigned int getDefaultNumThreads();
+
+private:
+   /////////////////////////////////////////////////////////////////////////////
+   // Helpers.
+   /////////////////////////////////////////////////////////////////////////////
+
+   void work(unsigned int thread);
+   void execute(unsigned int thread);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Members.
+   /////////////////////////////////////////////////////////////////////////////
+
+   std::vector< std::thread > _workers;
+   std::mutex _mutex;
+   std::condition_variable _wake;
+   std::condition_variable _done;
+
+   // The current batch. Published under _mutex by advancing _generation.
+   const Task* _task;
+   unsigned int _numTasks;
+   std::atomic< unsigned int > _nextTask;
+   unsigned int _numBusy;
+   unsigned int _generation;
+   bool _isStopping;
+};
+
+} // namespace common
+} // namespace crash
@@ -1,20 +1,25 @@
 #pragma once
 
+#include <map>
 #include <memory>
 #include <set>
 #include <boost/timer/timer.hpp>
 #include <crash/engine/camera.hpp>
 #include <crash/render/light_manager.hpp>
 #include <crash/render/mesh_instance.hpp>
+#include <crash/render/occlusion_buffer.hpp>
 #include <crash/space/boundable.hpp>
 #include <crash/space/bounding_partition.hpp>
 #include <crash/space/collision.hpp>
+#include <crash/space/pair_cache.hpp>
+#include <crash/space/spatial_index.hpp>
 #include <crash/window/window.hpp>
 
 namespace crash {
 
 namespace space {
    class BoundingPartition;
+   struct SpatialIndex;
 }
 
 namespace window {
@@ -29,13 +34,15 @@ typedef std::shared_ptr< Driver > DriverPtr;
 class Driver {
 public:
    typedef void (*CollisionCallback)(const space::Collision& collision);
+   typedef void (*CollisionEventCallback)(const space::Collision& collision,
+    space::PairCache::CollisionEvent event);
    typedef void (*UpdateCallback)(space::Boundable* boundable);
    typedef void (*RenderCallback)(render::Renderable* renderable);
 
    static render::MeshInstancePtr BoundingCubeMeshInstance;
 
    Driver(const Driver& driver);
-   Driver(space::BoundingPartition* boundingPartition,
+   Driver(space::SpatialIndex* spatialIndex,
     engine::Camera* camera,
     render::LightManager* lightManager,
     window::Window* window);
@@ -45,6 +52,25 @@ public:
    // Data access.
    /////////////////////////////////////////////////////////////////////////////
 
+   space::SpatialIndex* getSpatialIndex() const;
+   void setSpatialIndex(space::SpatialIndex* spatialIndex);
+
+   /**
+    * Stop tracking a Boundable: remove it from the spatial index, forget the
+    * collision pairs it belongs to without reporting their end, and stop
+    * using it as an occluder. Call this instead of removing the Boundable
+    * from the spatial index directly, so that no later event refers to it.
+    *
+    * :param boundable: The Boundable to remove.
+    * :return:          True if the spatial index held the Boundable.
+    */
+   bool remove(space::Boundable* boundable);
+
+   /**
+    * Get the spatial index as a BoundingPartition.
+    *
+    * :return: The spatial index, or null if it is not a BoundingPartition.
+    */
    space::BoundingPartition* getBoundingPartition() const;
    void setBoundingPartition(space::BoundingPartition* boundingPartition);
 
@@ -54,11 +80,43 @@ public:
    window::Window* getWindow() const;
    void setWindow(window::Window* window);
 
+   /**
+    * Rasterize the occluders into the given OcclusionBuffer before each
+    * render, and skip drawing every Boundable whose BoundingBox lies entirely
+    * behind them.
+    *
+    * :param occlusionBuffer: The buffer to use, or null to draw everything.
+    */
+   render::OcclusionBuffer* getOcclusionBuffer() const;
+   void setOcclusionBuffer(render::OcclusionBuffer* occlusionBuffer);
+
+   /**
+    * Occluders are Boundables, such as buildings and terrain, that hide what
+    * lies behind them. Each is given a simplified mesh in its unit space,
+    * which must remain valid while it is an occluder.
+    */
+   const std::map< space::Boundable*, const render::OccluderMesh* >&
+    getOccluders() const;
+   void addOccluder(space::Boundable* boundable,
+    const render::OccluderMesh* mesh);
+   void removeOccluder(space::Boundable* boundable);
+   void clearOccluders();
+
    const std::set< CollisionCallback >& getCollisionCallbacks() const;
    void addCollisionCallback(CollisionCallback callback);
    void removeCollisionCallback(CollisionCallback callback);
    void clearCollisionCallbacks();
 
+   /**
+    * Collision event callbacks are only told when a pair begins colliding,
+    * continues colliding, or stops colliding. Registering any of them makes
+    * the Driver track pairs between updates in a PairCache.
+    */
+   const std::set< CollisionEventCallback >& getCollisionEventCallbacks() const;
+   void addCollisionEventCallback(CollisionEventCallback callback);
+   void removeCollisionEventCallback(CollisionEventCallback callback);
+   void clearCollisionEventCallbacks();
+
    const std::set< UpdateCallback >& getUpdateCallbacks() const;
    void addUpdateCallback(UpdateCallback callback);
    void removeUpdateCallback(UpdateCallback callback);
@@ -95,7 +153,12 @@ private:
    /////////////////////////////////////////////////////////////////////////////
 
    void update(float delta_t);
+   void dispatchCollisionEvents(const std::vector< space::Collision >& pairs,
+    space::PairCache::CollisionEvent event);
    void render(float delta_t) const;
+   void renderBoundable(space::Boundable* boundable, float delta_t) const;
+   void rasterizeOccluders() const;
+   bool isOccluded(space::Boundable* boundable) const;
 
    float getUpdateTimerElapsed() const;
    float getRenderTimerElapsed() const;
@@ -108,11 +171,15 @@ private:
    // Members.
    /////////////////////////////////////////////////////////////////////////////
 
-   space::BoundingPartition* _boundingPartition;
+   space::SpatialIndex* _spatialIndex;
    engine::Camera* _camera;
    render::LightManager* _lightManager;
    window::Window* _window;
+   render::OcclusionBuffer* _occlusionBuffer;
+   std::map< space::Boundable*, const render::OccluderMesh* > _occluders;
    std::set< CollisionCallback > _collisionCallbacks;
+   std::set< CollisionEventCallback > _collisionEventCallbacks;
+   space::PairCache _pairCache;
    std::set< UpdateCallback > _updateCallbacks;
    std::set< RenderCallback > _renderCallbacks;
    bool _shouldLoop;
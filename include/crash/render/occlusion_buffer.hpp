@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace crash {
+namespace render {
+
+/**
+ * A simplified mesh standing in for an object that hides what lies behind
+ * it, such as a building or a hill. Vertices are in the unit space of the
+ * Boundable the mesh belongs to, where its BoundingBox spans -0.5 to 0.5
+ * along every axis. Anything an occluder mesh covers is culled, so it should
+ * lie within the visible surface of its object.
+ */
+struct OccluderMesh {
+   std::vector< glm::vec3 > vertices;
+   // Three indices into vertices for each triangle.
+   std::vector< unsigned int > indices;
+
+   /**
+    * Build the cube that fills the BoundingBox of its Boundable.
+    */
+   static OccluderMesh unitCube();
+};
+
+/**
+ * A low-resolution depth buffer that occluder meshes are rasterized into on
+ * the CPU, so that objects hidden behind them can be culled before they are
+ * drawn.
+ *
+ * Occluders are rasterized several pixels at a time with common::simd. The
+ * depths are then summarized in a hierarchy in which every texel holds the
+ * nearest and farthest depth of the four texels beneath it, down to a single
+ * texel covering the whole buffer. A query starts from the coarsest texels
+ * covering the screen-space bounds of a box, and only descends where those
+ * texels are neither entirely in front of nor entirely behind the box.
+ *
+ * Depths are normalized device depths mapped to the range [0, 1], where 1 is
+ * the far plane.
+ */
+class OcclusionBuffer {
+public:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   static const unsigned int NUM_CORNERS = 8;
+
+   typedef std::array< glm::vec3, NUM_CORNERS > Corners;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Constructors.
+   /////////////////////////////////////////////////////////////////////////////
+
+   OcclusionBuffer(const OcclusionBuffer& occlusionBuffer);
+
+   /**
+    * :param width:  The number of pixels across the buffer.
+    * :param height: The number of pixels down the buffer.
+    */
+   OcclusionBuffer(unsigned int width, unsigned int height);
+   virtual ~OcclusionBuffer();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Rasterization.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Empty the buffer to begin a new frame.
+    *
+    * :param viewProjection: The perspective transform of the camera
+    *                        multiplied by its view transform.
+    */
+   void clear(const glm::mat4& viewProjection);
+
+   /**
+    * Rasterize the triangles of an occluder mesh. Triangles that cross the
+    * near plane are skipped, which can only make the occluder hide less.
+    *
+    * :param mesh:      The occluder mesh.
+    * :param transform: The transform from the unit space of the mesh to world
+    *                   space.
+    */
+   void rasterize(const OccluderMesh& mesh, const glm::mat4& transform);
+
+   /**
+    * Summarize the rasterized depths in the hierarchy. Call this once every
+    * occluder has been rasterized, and before any query.
+    */
+   void buildHierarchy();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Queries.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Determine if a box lies entirely behind the occluders. A box that
+    * reaches in front of the near plane is never occluded.
+    *
+    * :param corners: The corners of the box in world space, such as those of
+    *                 BoundingBox::getCorners().
+    */
+   bool isOccluded(const Corners& corners) const;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Data access.
+   /////////////////////////////////////////////////////////////////////////////
+
+   unsigned int getWidth() const;
+   unsigned int getHeight() const;
+
+   /**
+    * Look up the rasterized depth of a single pixel.
+    */
+   float getDepth(unsigned int x, unsigned int y) const;
+
+   /**
+    * Count the levels of the hierarchy. Level 0 holds a texel per pixel, and
+    * the last level holds a single texel.
+    */
+   unsigned int getNumLevels() const;
+   glm::ivec2 getLevelSize(unsigned int level) const;
+   float getMinDepth(unsigned int level, unsigned int x, unsigned int y) const;
+   float getMaxDepth(unsigned int level, unsigned int x, unsigned int y) const;
+
+private:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   struct Level {
+      unsigned int width;
+      unsigned int height;
+      std::vector< float > minimum;
+      std::vector< float > maximum;
+   };
+
+   /**
+    * An inclusive range of pixels.
+    */
+   struct PixelRect {
+      int minX;
+      int minY;
+      int maxX;
+      int maxY;
+   };
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Helpers.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Rasterize a triangle given in screen space, with depth in z.
+    */
+   void rasterizeTriangle(const glm::vec3& a, const glm::vec3& b,
+    const glm::vec3& c);
+
+   /**
+    * Determine if the part of a texel within the given pixels lies entirely
+    * in front of the given depth.
+    */
+   bool isOccluded(unsigned int level, unsigned int x, unsigned int y,
+    const PixelRect& rect, float depth) const;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Members.
+   /////////////////////////////////////////////////////////////////////////////
+
+   unsigned int _width;
+   unsigned int _height;
+   // The distance between rows of _depths, padded so that every row can be
+   // rasterized in whole SIMD vectors.
+   unsigned int _stride;
+   glm::mat4 _viewProjection;
+   std::vector< float > _depths;
+   std::vector< Level > _levels;
+
+   // Scratch storage for the screen-space vertices of an occluder mesh.
+   std::vector< glm::vec3 > _screenVertices;
+   std::vector< bool > _clipped;
+
+   // The depth of an empty pixel.
+   static const float FAR_DEPTH;
+};
+
+} // namespace render
+} // namespace crash
@@ -12,6 +12,9 @@ public:
    static const unsigned int NUM_PLANES = 6;
    static const unsigned int NUM_CORNERS = 8;
 
+   // A plane mask with a bit set for every plane.
+   static const unsigned int ALL_PLANES = (1 << NUM_PLANES) - 1;
+
    typedef std::array< common::Plane, NUM_PLANES > Planes;
    typedef std::array< glm::vec3, NUM_CORNERS > Corners3;
    typedef std::array< glm::vec4, NUM_CORNERS > Corners4;
@@ -12,7 +12,16 @@ namespace space {
 
 class BoundingBox;
 
+/**
+ * Boundables are sorted into collision layers. A pair of Boundables is only
+ * considered for collision if each lies in a layer the other's mask accepts,
+ * and if at least one of them is not static. Spatial indices drop every other
+ * pair before any intersection test is run.
+ */
 struct Boundable : public common::Movable {
+   Boundable(const Boundable& boundable);
+   Boundable();
+
    virtual BoundingBox* getBoundingBox() = 0;
 
    /**
@@ -22,13 +31,79 @@ struct Boundable : public common::Movable {
     */
    virtual bool isVisible(const render::ViewFrustum& viewFrustum);
 
+   /**
+    * Determine if any part of this Boundable is within the given ViewFrustum,
+    * testing only some of its planes. The caller must already know that this
+    * Boundable lies entirely inside every plane left out of the mask.
+    *
+    * :param viewFrustum:  The ViewFrustum to test this BoundingBox against.
+    * :param planeMask:    A mask with bit i set if plane i must be tested.
+    */
+   virtual bool isVisible(const render::ViewFrustum& viewFrustum,
+    unsigned int planeMask);
+
    /**
     * Determine if this BoundingBox is intersecting with the specified other
     * Boundable.
     *
+    * Spatial indices do not call this when finding colliding pairs. They test
+    * the BoundingBoxes of every candidate pair in batches with a Narrowphase,
+    * so an override that refines the test must be applied to the pairs they
+    * report.
+    *
     * :param other: The other Boundable to test for intersection.
     */
    virtual bool isIntersecting(Boundable* boundable);
+
+   /**
+    * Determine if this Boundable and the specified other Boundable should be
+    * tested for collision, according to their layers, masks, and static
+    * flags.
+    *
+    * :param other: The other Boundable to consider.
+    */
+   bool isCollidable(const Boundable* other) const;
+
+   /**
+    * :param layers: A mask with a bit set for each layer this Boundable
+    *                belongs to.
+    */
+   void setCollisionLayers(unsigned int layers);
+   unsigned int getCollisionLayers() const;
+
+   /**
+    * :param mask: A mask with a bit set for each layer this Boundable may
+    *              collide with.
+    */
+   void setCollisionMask(unsigned int mask);
+   unsigned int getCollisionMask() const;
+
+   /**
+    * Mark this Boundable as static scenery, which never collides with other
+    * static Boundables. Static Boundables sleep like any other once at rest,
+    * and are still moved if given velocity or placed elsewhere.
+    */
+   void setStatic(bool isStatic);
+   bool isStatic() const;
+
+   /**
+    * Sleeping Boundables are at rest, so the engine neither moves them nor
+    * refreshes them in its spatial index. The engine puts a Boundable to
+    * sleep once it has no velocity, and wakes it when it is given velocity or
+    * begins colliding. Setting the position, orientation, or size of a
+    * Boundable wakes it.
+    */
+   void setSleeping(bool isSleeping);
+   bool isSleeping() const;
+
+   static const unsigned int DEFAULT_LAYER;
+   static const unsigned int ALL_LAYERS;
+
+private:
+   unsigned int _collisionLayers;
+   unsigned int _collisionMask;
+   bool _isStatic;
+   bool _isSleeping;
 };
 
 } // namespace space
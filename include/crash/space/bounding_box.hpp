@@ -3,6 +3,7 @@
 #include <array>
 #include <boost/optional.hpp>
 #include <glm/glm.hpp>
+#include <crash/common/line.hpp>
 #include <crash/common/transformer.hpp>
 #include <crash/space/boundable.hpp>
 
@@ -22,6 +23,19 @@ public:
    typedef std::array< glm::vec3, NUM_CORNERS > Corners;
    typedef std::array< glm::vec3, NUM_FACE_NORMALS > FaceNormals;
    typedef std::array< glm::vec3, NUM_DIAGONALS > DiagonalDirections;
+   typedef std::array< glm::vec3, 2 > Extents;
+
+   // Separating axes are numbered:
+   //    0 -  2: the face normals of this BoundingBox
+   //    3 -  5: the face normals of the other BoundingBox
+   //    6 - 14: the cross products of a face normal of this BoundingBox
+   //            (index / 3) and one of the other (index % 3)
+   static const int NUM_SEPARATING_AXES = 15;
+   static const int NO_AXIS = -1;
+
+   // Time of impact queries between boxes that rotate or change size halve
+   // the interval searched at most MAX_IMPACT_DEPTH times.
+   static const unsigned int MAX_IMPACT_DEPTH = 6;
 
    /////////////////////////////////////////////////////////////////////////////
    // Constructors.
@@ -54,8 +68,86 @@ public:
 
    BoundingBox* getBoundingBox();
    bool isVisible(const render::ViewFrustum& viewFrustum);
+   bool isVisible(const render::ViewFrustum& viewFrustum,
+    unsigned int planeMask);
    bool isIntersecting(Boundable* boundable);
 
+   /////////////////////////////////////////////////////////////////////////////
+   // Spatial queries.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Calculate where the given ray first enters this BoundingBox.
+    *
+    * :param ray:   The ray, starting at ray.point and extending along
+    *               ray.direction.
+    * :return:      The multiple of ray.direction at which the ray enters this
+    *               BoundingBox, 0 if ray.point is inside it, or none if the ray
+    *               misses it.
+    */
+   boost::optional< float > intersectRay(const common::Line& ray);
+
+   /**
+    * Determine if this BoundingBox is intersecting with the specified other
+    * Boundable, remembering the axis that separates them. Boxes that moved
+    * only a little since the last test are usually still separated along the
+    * same axis, which is tested first.
+    *
+    * :param boundable:      The other Boundable to test for intersection.
+    * :param separatingAxis: Input and output. The axis to test first, or
+    *                        NO_AXIS. Set to the axis that separates the boxes
+    *                        if one is found, or NO_AXIS if they intersect.
+    *                        Left unchanged if the bounding spheres alone
+    *                        separate the boxes.
+    */
+   bool isIntersecting(Boundable* boundable, int& separatingAxis);
+
+   /**
+    * Calculate the distance from the given point to the nearest point of this
+    * BoundingBox.
+    *
+    * :param point: The point to measure from.
+    * :return:      The distance, which is 0 if the point is inside.
+    */
+   float getDistance(const glm::vec3& point);
+
+   /**
+    * Calculate when this BoundingBox first touches the specified other
+    * BoundingBox as both move with their current velocities, so that boxes
+    * moving fast enough to pass through one another between updates are
+    * still found to collide.
+    *
+    * The time is exact for boxes that only translate. Boxes that rotate or
+    * change size are never found to touch later than they truly do, but may
+    * be found to touch when they only pass close by, within a margin that
+    * shrinks as MAX_IMPACT_DEPTH grows.
+    *
+    * Only the transforms of both boxes are read, so queries between boxes
+    * shared by several threads may run concurrently.
+    *
+    * :param boundingBox:  The other BoundingBox.
+    * :param delta_t:      The length of the interval to search, starting now.
+    * :return:             The time of first contact within the interval, 0 if
+    *                      the boxes are intersecting now, or none if they do
+    *                      not touch within the interval.
+    */
+   boost::optional< float > getTimeOfImpact(const BoundingBox& boundingBox,
+    float delta_t) const;
+
+   /**
+    * Calculate the world-space axis-aligned extents of every position this
+    * BoundingBox takes while moving with its current velocities.
+    *
+    * :param delta_t:   The length of the interval, starting now.
+    */
+   Extents getSweptExtents(float delta_t);
+
+   /**
+    * Calculate this BoundingBox as it will be after moving with its current
+    * velocities for the given time.
+    */
+   BoundingBox getMoved(float delta_t) const;
+
    /////////////////////////////////////////////////////////////////////////////
    // Data access.
    /////////////////////////////////////////////////////////////////////////////
@@ -107,6 +199,14 @@ public:
     */
    const DiagonalDirections& getDiagonalDirections();
 
+   /**
+    * Calculate the world-space axis-aligned extents of this BoundingBox.
+    * Ordered:
+    *    0: minimum
+    *    1: maximum
+    */
+   const Extents& getExtents();
+
 private:
    // Data members
    common::Transformer _transformer;
@@ -116,11 +216,13 @@ private:
    void generateCorners();
    void generateFaceNormals();
    void generateDiagonalDirections();
+   void generateExtents();
 
    boost::optional< float > _radius;
    boost::optional< Corners > _corners;
    boost::optional< FaceNormals > _faceNormals;
    boost::optional< DiagonalDirections > _diagonalDirections;
+   boost::optional< Extents > _extents;
 
    // Spatial queries
    typedef std::array< float, 9 > CoefficientMatrix;
@@ -134,8 +236,26 @@ private:
    /**
     * Calculate intersection between this BoundingBox and the other specified
     * BoundingBox using method of separating axis.
+    *
+    * :param separatingAxis: Input and output. See isIntersecting().
     */
-   bool intersectAsBoxes(BoundingBox& boundingBox);
+   bool intersectAsBoxes(BoundingBox& boundingBox, int& separatingAxis);
+
+   /**
+    * Determine if the given axis separates two boxes.
+    *
+    * :param axis:     The index of the axis to test.
+    * :param aSize:    The half-size of this BoundingBox.
+    * :param bSize:    The half-size of the other BoundingBox.
+    * :param aDots:    The center difference projected onto each face normal
+    *                  of this BoundingBox.
+    * :param bDots:    The center difference projected onto each face normal
+    *                  of the other BoundingBox.
+    */
+   static bool isSeparatingAxis(int axis, const glm::vec3& aSize,
+    const glm::vec3& bSize, const glm::vec3& aDots, const glm::vec3& bDots,
+    const CoefficientMatrix& coefMatrix,
+    const CoefficientMatrix& absCoefMatrix);
 
    /**
     * Calculate the projection of the difference in box centers onto the
@@ -158,6 +278,53 @@ private:
    static float otherIntersectionRadiusProjection(int aNdx, int bNdx,
     const glm::vec3& bSize, CoefficientMatrix absCoefMatrix);
 
+   /**
+    * Search part of the interval of a time of impact query, which is divided
+    * in half wherever the boxes may touch.
+    *
+    * :param boundingBox:  The other BoundingBox, at the start of the query.
+    * :param aStart:       This BoundingBox at the start of the part.
+    * :param bStart:       The other BoundingBox at the start of the part.
+    * :param start:        The start of the part, relative to the query.
+    * :param end:          The end of the part, relative to the query.
+    * :param depth:        The number of times the interval has been halved.
+    * :return:             The time of first contact within the part, or none.
+    */
+   boost::optional< float > findImpact(const BoundingBox& boundingBox,
+    BoundingBox& aStart, BoundingBox& bStart, float start, float end,
+    unsigned int depth) const;
+
+   /**
+    * Find the earliest moment two boxes may touch while moving between two
+    * poses, with a separating axis test on the velocity of one relative to
+    * the other. Boxes that only translate are tested exactly. A box that
+    * rotates or changes size is grown by the most any of its corners can
+    * stray from where its starting orientation and larger size would put it,
+    * so it may be found to touch early but never late.
+    *
+    * :param duration:  The time taken to move from the start to the end.
+    * :return:          The fraction of the duration elapsed at first
+    *                   contact, or none if the boxes stay apart.
+    */
+   static boost::optional< float > getSweptContact(BoundingBox& aStart,
+    BoundingBox& aEnd, BoundingBox& bStart, BoundingBox& bEnd,
+    float duration);
+
+   /**
+    * Calculate the half-extent of a swept box along an axis, from its
+    * starting orientation, its larger half-size, and the distance its
+    * corners may stray while it rotates.
+    */
+   static float getSweptRadius(const glm::vec3& axis,
+    const glm::mat4& rotation, const glm::vec3& halfSize, float slack);
+
+   /**
+    * Calculate the farthest any corner of a box rotating with its current
+    * velocity can stray from where it started, relative to its center.
+    */
+   static float getSweptSlack(const BoundingBox& boundingBox,
+    const glm::vec3& halfSize, float duration);
+
    int _frustumPlaneIndex;
 };
 
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace crash {
+
+namespace render {
+   class ViewFrustum;
+}
+
+namespace space {
+
+struct Boundable;
+class BoundingBox;
+
+/**
+ * A structure-of-arrays store of oriented bounding boxes.
+ *
+ * Each slot mirrors the BoundingBox of one Boundable as a center, a set of
+ * half-extents and three rotation axes, with every component held in its own
+ * contiguous array. This layout lets batch queries test several boxes per
+ * instruction instead of chasing a pointer and a virtual call for each one.
+ *
+ * Slots are snapshots: they must be refreshed with update() after the
+ * corresponding Boundable moves.
+ */
+class BoundingBoxArray {
+public:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * One bit per slot, packed 32 slots to a word. Bit (ndx % 32) of word
+    * (ndx / 32) corresponds to slot ndx.
+    */
+   typedef std::vector< std::uint32_t > Bitmask;
+
+   /**
+    * A pair of slot indices into the same BoundingBoxArray.
+    */
+   typedef std::pair< unsigned int, unsigned int > SlotPair;
+   typedef std::vector< SlotPair > SlotPairs;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Constructors.
+   /////////////////////////////////////////////////////////////////////////////
+
+   BoundingBoxArray(const BoundingBoxArray& boundingBoxArray);
+   BoundingBoxArray();
+   BoundingBoxArray(const std::vector< Boundable* >& boundables);
+   virtual ~BoundingBoxArray();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Data access.
+   /////////////////////////////////////////////////////////////////////////////
+
+   unsigned int getNumBoundables() const;
+   Boundable* getBoundable(unsigned int index) const;
+
+   glm::vec3 getCenter(unsigned int index) const;
+   glm::vec3 getHalfExtents(unsigned int index) const;
+   glm::vec3 getAxis(unsigned int index, unsigned int axis) const;
+
+   /**
+    * Append a slot for the given Boundable.
+    *
+    * :param boundable: The Boundable whose BoundingBox should be mirrored.
+    * :return:          The index of the new slot.
+    */
+   unsigned int add(Boundable* boundable);
+
+   /**
+    * Remove the slot at the given index by moving the last slot into its place.
+    *
+    * :param index:  The slot to remove.
+    */
+   void remove(unsigned int index);
+
+   /**
+    * Refresh the slot at the given index from its Boundable.
+    *
+    * :param index:  The slot to refresh.
+    */
+   void update(unsigned int index);
+
+   /**
+    * Refresh every slot from its Boundable.
+    */
+   void update();
+
+   void reserve(unsigned int capacity);
+   void clear();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Batch queries.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Determine which slots are at least partially within the given
+    * ViewFrustum.
+    *
+    * Boxes are tested simd::Float::WIDTH at a time by projecting each box onto
+    * every plane normal and comparing the projected radius to the signed
+    * distance of its center.
+    *
+    * :param viewFrustum:  The ViewFrustum to test against.
+    * :param visible:      Output bitmask. Resized to cover every slot; a bit is
+    *                      set when the corresponding box is visible.
+    */
+   void cullAgainst(const render::ViewFrustum& viewFrustum,
+    Bitmask& visible) const;
+
+   /**
+    * Determine which of the given pairs of slots are intersecting.
+    *
+    * Pairs are tested simd::Float::WIDTH at a time. Each lane is first
+    * rejected with a bounding sphere test, and lanes that survive are run
+    * through the full 15-axis separating axis test.
+    *
+    * :param pairs:        The candidate pairs of slots.
+    * :param intersecting: Output bitmask. Resized to cover every pair; a bit is
+    *                      set when the corresponding pair is intersecting.
+    */
+   void intersectPairs(const SlotPairs& pairs, Bitmask& intersecting) const;
+
+   /**
+    * Determine if the bit for the given slot is set in a Bitmask.
+    */
+   static bool isSet(const Bitmask& bitmask, unsigned int index);
+
+private:
+   static const unsigned int NUM_COMPONENTS = 16;
+   typedef std::array< const float*, NUM_COMPONENTS > Components;
+
+   void assign(unsigned int index, BoundingBox* boundingBox);
+   Components getComponents() const;
+
+   std::vector< Boundable* > _boundables;
+   std::array< std::vector< float >, 3 > _centers;
+   std::array< std::vector< float >, 3 > _halfExtents;
+   // Axis a, component c lives in _axes[a * 3 + c].
+   std::array< std::vector< float >, 9 > _axes;
+   std::vector< float > _radii;
+};
+
+} // namespace space
+} // namespace crash
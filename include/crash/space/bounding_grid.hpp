@@ -0,0 +1,254 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <crash/space/collision.hpp>
+#include <crash/space/narrowphase.hpp>
+#include <crash/space/spatial_index.hpp>
+
+namespace crash {
+
+namespace render {
+   class ViewFrustum;
+}
+
+namespace space {
+
+struct Boundable;
+
+////////////////////////////////////////////////////////////////////////////////
+// Cell policies.
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Store the members of each cell of a BoundingGridT in a vector, which grows
+ * on the heap to hold any number of members.
+ */
+struct DynamicCellPolicy {
+   typedef std::vector< unsigned int > Cell;
+
+   /**
+    * :return: True, since a cell never fills up.
+    */
+   static bool insert(Cell& cell, unsigned int member);
+   static void erase(Cell& cell, unsigned int member);
+   static void clear(Cell& cell);
+   static unsigned int size(const Cell& cell);
+   static unsigned int get(const Cell& cell, unsigned int ndx);
+};
+
+/**
+ * Store the members of each cell of a BoundingGridT in place, with room for
+ * at most N members, so that the cells never touch the heap.
+ */
+template < unsigned int N >
+struct FixedCellPolicy {
+   struct Cell {
+      std::array< unsigned int, N > members;
+      unsigned int size;
+
+      Cell();
+   };
+
+   /**
+    * :return: True if the member was added, or false if the cell is full.
+    */
+   static bool insert(Cell& cell, unsigned int member);
+   static void erase(Cell& cell, unsigned int member);
+   static void clear(Cell& cell);
+   static unsigned int size(const Cell& cell);
+   static unsigned int get(const Cell& cell, unsigned int ndx);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Grid.
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A world-aligned grid of X by Y by Z cells whose shape and cell storage are
+ * fixed at compile time.
+ *
+ * Unlike BoundingPartition, which is sized at runtime, every cell index is
+ * computed from constant dimensions, so powers of two reduce to shifts and
+ * masks, and loops over the grid have constant bounds. The cells are stored
+ * in a fixed-size array within the grid, and the CellPolicy decides how
+ * each cell stores its members. A large grid should therefore be allocated
+ * on the heap.
+ *
+ * Boundables beyond the sides of the grid are placed in its outermost cells,
+ * so every Boundable is tracked. A Boundable that does not fit in a full cell
+ * of a FixedCellPolicy overflows into a list of Boundables that are paired
+ * with every other.
+ */
+template < int X, int Y, int Z, typename CellPolicy >
+class BoundingGridT : public SpatialIndex {
+public:
+   static_assert(X > 0 && Y > 0 && Z > 0,
+    "A BoundingGridT must have at least one cell along every axis.");
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   typedef typename CellPolicy::Cell Cell;
+
+   static const unsigned int NUM_CELLS = X * Y * Z;
+
+   typedef std::array< Cell, NUM_CELLS > Cells;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Constructors.
+   /////////////////////////////////////////////////////////////////////////////
+
+   BoundingGridT(const BoundingGridT& boundingGrid);
+
+   /**
+    * :param minimum:  The minimum corner of the grid in world space.
+    * :param cellSize: The size of every cell along each axis.
+    */
+   BoundingGridT(const glm::vec3& minimum, const glm::vec3& cellSize);
+   virtual ~BoundingGridT();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // SpatialIndex interface.
+   /////////////////////////////////////////////////////////////////////////////
+
+   bool add(Boundable* boundable);
+   bool remove(Boundable* boundable);
+
+   /**
+    * Refresh the cells containing the given Boundable after it has moved.
+    * Only the cells entered or left since the last update are touched.
+    *
+    * :param boundable: The Boundable to refresh.
+    * :return:          True if the set of containing cells changed.
+    */
+   bool update(Boundable* boundable);
+   void clear();
+
+   unsigned int getNumBoundables() const;
+   std::vector< Boundable* > getBoundables() const;
+   void forEachBoundable(const BoundableVisitor& visitor) const;
+
+   std::vector< Collision > getCandidateElements() const;
+   std::vector< Collision > getCollidingElements() const;
+   void forEachPair(const CollisionVisitor& visitor) const;
+   std::vector< Boundable* > getVisibleElements(
+    const render::ViewFrustum& viewFrustum);
+   void forEachVisible(const render::ViewFrustum& viewFrustum,
+    const BoundableVisitor& visitor);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Data access.
+   /////////////////////////////////////////////////////////////////////////////
+
+   const glm::vec3& getMinimum() const;
+   const glm::vec3& getCellSize() const;
+
+   /**
+    * Count the members of a single cell.
+    *
+    * :param index: The index of the cell along each axis.
+    */
+   unsigned int getNumMembers(const glm::ivec3& index) const;
+
+   /**
+    * Count the Boundables that did not fit in a full cell.
+    */
+   unsigned int getNumOverflowing() const;
+
+   /**
+    * Calculate the position of a cell in the array of cells.
+    */
+   static unsigned int linearize(const glm::ivec3& index);
+   static glm::ivec3 vectorize(unsigned int ndx);
+
+private:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * An inclusive range of cell indices along each axis.
+    */
+   struct CellRange {
+      glm::ivec3 minimum;
+      glm::ivec3 maximum;
+
+      bool contains(const glm::ivec3& index) const;
+      bool operator==(const CellRange& other) const;
+   };
+
+   struct Proxy {
+      Boundable* boundable;
+      CellRange range;
+      bool overflowing;
+   };
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Helpers.
+   /////////////////////////////////////////////////////////////////////////////
+
+   CellRange getCellRange(Boundable* boundable) const;
+
+   /**
+    * Add a proxy to every cell in one range but not another.
+    *
+    * :return: False if a cell was full, in which case the proxy is left in
+    *          some of the cells.
+    */
+   bool addToRange(unsigned int proxy, const CellRange& range,
+    const CellRange* exclude);
+   void removeFromRange(unsigned int proxy, const CellRange& range,
+    const CellRange* exclude);
+
+   /**
+    * Place a proxy in the cells of its range, or in the overflow list if any
+    * of them is full.
+    */
+   void insert(unsigned int proxy);
+
+   /**
+    * Take a proxy out of the cells of its range, or out of the overflow list.
+    */
+   void erase(unsigned int proxy);
+
+   void getCandidateElements(std::vector< Collision >& candidates) const;
+   bool isCulled(const glm::ivec3& index,
+    const render::ViewFrustum& viewFrustum) const;
+
+   static void removeFromList(std::vector< unsigned int >& list,
+    unsigned int proxy);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Members.
+   /////////////////////////////////////////////////////////////////////////////
+
+   glm::vec3 _minimum;
+   glm::vec3 _cellSize;
+   glm::vec3 _inverseCellSize;
+   // Fixed cells can add up to megabytes, so they are kept off the stack.
+   std::unique_ptr< Cells > _cells;
+   std::vector< unsigned int > _overflow;
+
+   std::vector< Proxy > _proxies;
+   std::vector< unsigned int > _freeProxies;
+   std::unordered_map< Boundable*, unsigned int > _proxyIndices;
+
+   // A proxy has been visited by the current query if its stamp matches.
+   std::vector< unsigned int > _stamps;
+   unsigned int _stamp;
+
+   // Scratch storage for batch intersection tests.
+   mutable Narrowphase _narrowphase;
+   mutable std::vector< Collision > _candidates;
+   mutable std::vector< Collision > _colliding;
+};
+
+} // namespace space
+} // namespace crash
+
+#include <crash/space/bounding_grid.inl>
@@ -0,0 +1,511 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <crash/render/view_frustum.hpp>
+#include <crash/space/boundable.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/util.hpp>
+
+namespace crash {
+namespace space {
+
+////////////////////////////////////////////////////////////////////////////////
+// Cell policies.
+////////////////////////////////////////////////////////////////////////////////
+
+template < unsigned int N >
+FixedCellPolicy< N >::Cell::Cell() :
+   members(), size(0)
+{}
+
+template < unsigned int N >
+/* static */ bool FixedCellPolicy< N >::insert(Cell& cell,
+ unsigned int member) {
+   if (cell.size == N) {
+      return false;
+   }
+
+   cell.members[cell.size++] = member;
+   return true;
+}
+
+template < unsigned int N >
+/* static */ void FixedCellPolicy< N >::erase(Cell& cell,
+ unsigned int member) {
+   for (unsigned int ndx = 0; ndx < cell.size; ++ndx) {
+      if (cell.members[ndx] == member) {
+         cell.members[ndx] = cell.members[--cell.size];
+         return;
+      }
+   }
+}
+
+template < unsigned int N >
+/* static */ void FixedCellPolicy< N >::clear(Cell& cell) {
+   cell.size = 0;
+}
+
+template < unsigned int N >
+/* static */ unsigned int FixedCellPolicy< N >::size(const Cell& cell) {
+   return cell.size;
+}
+
+template < unsigned int N >
+/* static */ unsigned int FixedCellPolicy< N >::get(const Cell& cell,
+ unsigned int ndx) {
+   return cell.members[ndx];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+template < int X, int Y, int Z, typename CellPolicy >
+BoundingGridT< X, Y, Z, CellPolicy >::BoundingGridT(
+ const BoundingGridT& boundingGrid) :
+   _minimum(boundingGrid._minimum),
+    _cellSize(boundingGrid._cellSize),
+    _inverseCellSize(boundingGrid._inverseCellSize),
+    _cells(new Cells(*boundingGrid._cells)),
+    _overflow(boundingGrid._overflow),
+    _proxies(boundingGrid._proxies),
+    _freeProxies(boundingGrid._freeProxies),
+    _proxyIndices(boundingGrid._proxyIndices),
+    _stamps(boundingGrid._proxies.size(), 0),
+    _stamp(0),
+    _narrowphase(),
+    _candidates(),
+    _colliding()
+{}
+
+template < int X, int Y, int Z, typename CellPolicy >
+BoundingGridT< X, Y, Z, CellPolicy >::BoundingGridT(const glm::vec3& minimum,
+ const glm::vec3& cellSize) :
+   _minimum(minimum), _cellSize(cellSize),
+    _inverseCellSize(glm::vec3(1.0f) / cellSize), _cells(new Cells()),
+    _overflow(), _proxies(), _freeProxies(), _proxyIndices(), _stamps(),
+    _stamp(0), _narrowphase(), _candidates(), _colliding()
+{}
+
+template < int X, int Y, int Z, typename CellPolicy >
+/* virtual */ BoundingGridT< X, Y, Z, CellPolicy >::~BoundingGridT() {}
+
+////////////////////////////////////////////////////////////////////////////////
+// SpatialIndex interface.
+////////////////////////////////////////////////////////////////////////////////
+
+template < int X, int Y, int Z, typename CellPolicy >
+bool BoundingGridT< X, Y, Z, CellPolicy >::add(Boundable* boundable) {
+   if (this->_proxyIndices.find(boundable) != this->_proxyIndices.end()) {
+      return false;
+   }
+
+   unsigned int index;
+   if (this->_freeProxies.empty()) {
+      index = this->_proxies.size();
+      this->_proxies.push_back(Proxy());
+      this->_stamps.push_back(0);
+   } else {
+      index = this->_freeProxies.back();
+      this->_freeProxies.pop_back();
+   }
+   this->_proxyIndices.insert(std::make_pair(boundable, index));
+
+   Proxy& proxy = this->_proxies[index];
+   proxy.boundable = boundable;
+   proxy.range = this->getCellRange(boundable);
+   this->insert(index);
+   return true;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+bool BoundingGridT< X, Y, Z, CellPolicy >::remove(Boundable* boundable) {
+   auto itr = this->_proxyIndices.find(boundable);
+   if (itr == this->_proxyIndices.end()) {
+      return false;
+   }
+
+   unsigned int index = itr->second;
+   this->_proxyIndices.erase(itr);
+
+   this->erase(index);
+   this->_proxies[index].boundable = nullptr;
+   this->_freeProxies.push_back(index);
+   return true;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+bool BoundingGridT< X, Y, Z, CellPolicy >::update(Boundable* boundable) {
+   auto itr = this->_proxyIndices.find(boundable);
+   if (itr == this->_proxyIndices.end()) {
+      return this->add(boundable);
+   }
+
+   unsigned int index = itr->second;
+   CellRange range = this->getCellRange(boundable);
+   if (range == this->_proxies[index].range) {
+      return false;
+   }
+
+   // An overflowing proxy tries its new cells from scratch.
+   if (this->_proxies[index].overflowing) {
+      this->erase(index);
+      this->_proxies[index].range = range;
+      this->insert(index);
+      return true;
+   }
+
+   CellRange previous = this->_proxies[index].range;
+   this->removeFromRange(index, previous, &range);
+   this->_proxies[index].range = range;
+   if (!this->addToRange(index, range, &previous)) {
+      this->removeFromRange(index, range, nullptr);
+      this->_proxies[index].overflowing = true;
+      this->_overflow.push_back(index);
+   }
+   return true;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+void BoundingGridT< X, Y, Z, CellPolicy >::clear() {
+   for (Cell& cell : *this->_cells) {
+      CellPolicy::clear(cell);
+   }
+   this->_overflow.clear();
+   this->_proxies.clear();
+   this->_freeProxies.clear();
+   this->_proxyIndices.clear();
+   this->_stamps.clear();
+   this->_stamp = 0;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+unsigned int BoundingGridT< X, Y, Z, CellPolicy >::getNumBoundables() const {
+   return this->_proxyIndices.size();
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+std::vector< Boundable* >
+ BoundingGridT< X, Y, Z, CellPolicy >::getBoundables() const {
+   std::vector< Boundable* > accumulator;
+   accumulator.reserve(this->_proxyIndices.size());
+
+   for (const Proxy& proxy : this->_proxies) {
+      if (proxy.boundable != nullptr) {
+         accumulator.push_back(proxy.boundable);
+      }
+   }
+
+   return accumulator;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+void BoundingGridT< X, Y, Z, CellPolicy >::forEachBoundable(
+ const BoundableVisitor& visitor) const {
+   for (const Proxy& proxy : this->_proxies) {
+      if (proxy.boundable != nullptr) {
+         visitor(proxy.boundable);
+      }
+   }
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+std::vector< Collision >
+ BoundingGridT< X, Y, Z, CellPolicy >::getCandidateElements() const {
+   std::vector< Collision > candidates;
+   this->getCandidateElements(candidates);
+   return candidates;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+std::vector< Collision >
+ BoundingGridT< X, Y, Z, CellPolicy >::getCollidingElements() const {
+   std::vector< Collision > accumulator;
+   this->_candidates.clear();
+   this->getCandidateElements(this->_candidates);
+   this->_narrowphase.collide(this->_candidates, accumulator);
+   return accumulator;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+void BoundingGridT< X, Y, Z, CellPolicy >::forEachPair(
+ const CollisionVisitor& visitor) const {
+   this->_candidates.clear();
+   this->getCandidateElements(this->_candidates);
+   this->_narrowphase.collide(this->_candidates, this->_colliding);
+   for (const Collision& collision : this->_colliding) {
+      visitor(collision);
+   }
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+std::vector< Boundable* >
+ BoundingGridT< X, Y, Z, CellPolicy >::getVisibleElements(
+ const render::ViewFrustum& viewFrustum) {
+   std::vector< Boundable* > accumulator;
+   this->forEachVisible(viewFrustum, [&accumulator](Boundable* boundable) {
+      accumulator.push_back(boundable);
+   });
+   return accumulator;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+void BoundingGridT< X, Y, Z, CellPolicy >::forEachVisible(
+ const render::ViewFrustum& viewFrustum, const BoundableVisitor& visitor) {
+   // Stamps only need to be cleared when the counter wraps around.
+   if (++this->_stamp == 0) {
+      std::fill(this->_stamps.begin(), this->_stamps.end(), 0);
+      this->_stamp = 1;
+   }
+
+   glm::ivec3 index;
+   for (index.z = 0; index.z < Z; ++index.z) {
+      for (index.y = 0; index.y < Y; ++index.y) {
+         for (index.x = 0; index.x < X; ++index.x) {
+            const Cell& cell = (*this->_cells)[linearize(index)];
+            unsigned int size = CellPolicy::size(cell);
+            if (size == 0 || this->isCulled(index, viewFrustum)) {
+               continue;
+            }
+
+            for (unsigned int ndx = 0; ndx < size; ++ndx) {
+               unsigned int proxy = CellPolicy::get(cell, ndx);
+               if (this->_stamps[proxy] == this->_stamp) {
+                  continue;
+               }
+               this->_stamps[proxy] = this->_stamp;
+
+               Boundable* boundable = this->_proxies[proxy].boundable;
+               if (boundable->isVisible(viewFrustum)) {
+                  visitor(boundable);
+               }
+            }
+         }
+      }
+   }
+
+   for (unsigned int proxy : this->_overflow) {
+      Boundable* boundable = this->_proxies[proxy].boundable;
+      if (boundable->isVisible(viewFrustum)) {
+         visitor(boundable);
+      }
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data access.
+////////////////////////////////////////////////////////////////////////////////
+
+template < int X, int Y, int Z, typename CellPolicy >
+const glm::vec3& BoundingGridT< X, Y, Z, CellPolicy >::getMinimum() const {
+   return this->_minimum;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+const glm::vec3& BoundingGridT< X, Y, Z, CellPolicy >::getCellSize() const {
+   return this->_cellSize;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+unsigned int BoundingGridT< X, Y, Z, CellPolicy >::getNumMembers(
+ const glm::ivec3& index) const {
+   return CellPolicy::size((*this->_cells)[linearize(index)]);
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+unsigned int BoundingGridT< X, Y, Z, CellPolicy >::getNumOverflowing() const {
+   return this->_overflow.size();
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+/* static */ unsigned int BoundingGridT< X, Y, Z, CellPolicy >::linearize(
+ const glm::ivec3& index) {
+   return index.x + X * (index.y + Y * index.z);
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+/* static */ glm::ivec3 BoundingGridT< X, Y, Z, CellPolicy >::vectorize(
+ unsigned int ndx) {
+   return glm::ivec3(ndx % X, (ndx / X) % Y, ndx / (X * Y));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Type definitions.
+////////////////////////////////////////////////////////////////////////////////
+
+template < int X, int Y, int Z, typename CellPolicy >
+bool BoundingGridT< X, Y, Z, CellPolicy >::CellRange::contains(
+ const glm::ivec3& index) const {
+   return glm::all(glm::lessThanEqual(this->minimum, index)) &&
+    glm::all(glm::lessThanEqual(index, this->maximum));
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+bool BoundingGridT< X, Y, Z, CellPolicy >::CellRange::operator==(
+ const CellRange& other) const {
+   return this->minimum == other.minimum && this->maximum == other.maximum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers.
+////////////////////////////////////////////////////////////////////////////////
+
+template < int X, int Y, int Z, typename CellPolicy >
+typename BoundingGridT< X, Y, Z, CellPolicy >::CellRange
+ BoundingGridT< X, Y, Z, CellPolicy >::getCellRange(
+ Boundable* boundable) const {
+   static const glm::vec3 limits(X - 1, Y - 1, Z - 1);
+
+   const BoundingBox::Extents& extents =
+    boundable->getBoundingBox()->getExtents();
+   glm::vec3 minimum = (extents[0] - this->_minimum) * this->_inverseCellSize;
+   glm::vec3 maximum = (extents[1] - this->_minimum) * this->_inverseCellSize;
+
+   // Clamping in floating point keeps distant extents from overflowing.
+   CellRange range;
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      range.minimum[axis] = (int)std::floor(
+       std::min(std::max(minimum[axis], 0.0f), limits[axis]));
+      range.maximum[axis] = (int)std::floor(
+       std::min(std::max(maximum[axis], 0.0f), limits[axis]));
+   }
+   return range;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+bool BoundingGridT< X, Y, Z, CellPolicy >::addToRange(unsigned int proxy,
+ const CellRange& range, const CellRange* exclude) {
+   glm::ivec3 index;
+   for (index.z = range.minimum.z; index.z <= range.maximum.z; ++index.z) {
+      for (index.y = range.minimum.y; index.y <= range.maximum.y; ++index.y) {
+         for (index.x = range.minimum.x; index.x <= range.maximum.x;
+          ++index.x) {
+            if (exclude != nullptr && exclude->contains(index)) {
+               continue;
+            }
+            if (!CellPolicy::insert((*this->_cells)[linearize(index)], proxy)) {
+               return false;
+            }
+         }
+      }
+   }
+
+   return true;
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+void BoundingGridT< X, Y, Z, CellPolicy >::removeFromRange(unsigned int proxy,
+ const CellRange& range, const CellRange* exclude) {
+   glm::ivec3 index;
+   for (index.z = range.minimum.z; index.z <= range.maximum.z; ++index.z) {
+      for (index.y = range.minimum.y; index.y <= range.maximum.y; ++index.y) {
+         for (index.x = range.minimum.x; index.x <= range.maximum.x;
+          ++index.x) {
+            if (exclude == nullptr || !exclude->contains(index)) {
+               CellPolicy::erase((*this->_cells)[linearize(index)], proxy);
+            }
+         }
+      }
+   }
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+void BoundingGridT< X, Y, Z, CellPolicy >::insert(unsigned int proxy) {
+   Proxy& target = this->_proxies[proxy];
+   target.overflowing = !this->addToRange(proxy, target.range, nullptr);
+
+   // Cells are never partially occupied by an overflowing proxy.
+   if (target.overflowing) {
+      this->removeFromRange(proxy, target.range, nullptr);
+      this->_overflow.push_back(proxy);
+   }
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+void BoundingGridT< X, Y, Z, CellPolicy >::erase(unsigned int proxy) {
+   const Proxy& target = this->_proxies[proxy];
+
+   if (target.overflowing) {
+      removeFromList(this->_overflow, proxy);
+   } else {
+      this->removeFromRange(proxy, target.range, nullptr);
+   }
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+void BoundingGridT< X, Y, Z, CellPolicy >::getCandidateElements(
+ std::vector< Collision >& candidates) const {
+   // A pair shares every cell in the intersection of their ranges, and is
+   // only reported by the cell at the minimum corner of that intersection.
+   glm::ivec3 index;
+   for (index.z = 0; index.z < Z; ++index.z) {
+      for (index.y = 0; index.y < Y; ++index.y) {
+         for (index.x = 0; index.x < X; ++index.x) {
+            const Cell& cell = (*this->_cells)[linearize(index)];
+            unsigned int size = CellPolicy::size(cell);
+
+            for (unsigned int i = 0; i < size; ++i) {
+               const Proxy& a = this->_proxies[CellPolicy::get(cell, i)];
+               for (unsigned int j = i + 1; j < size; ++j) {
+                  const Proxy& b = this->_proxies[CellPolicy::get(cell, j)];
+                  if (glm::max(a.range.minimum, b.range.minimum) == index &&
+                   a.boundable->isCollidable(b.boundable)) {
+                     candidates.push_back(Collision::factory(a.boundable,
+                      b.boundable));
+                  }
+               }
+            }
+         }
+      }
+   }
+
+   // Overflowing Boundables are paired with every other Boundable.
+   for (unsigned int i = 0; i < this->_overflow.size(); ++i) {
+      const Proxy& a = this->_proxies[this->_overflow[i]];
+      for (unsigned int j = i + 1; j < this->_overflow.size(); ++j) {
+         const Proxy& b = this->_proxies[this->_overflow[j]];
+         if (a.boundable->isCollidable(b.boundable)) {
+            candidates.push_back(Collision::factory(a.boundable,
+             b.boundable));
+         }
+      }
+
+      for (const Proxy& b : this->_proxies) {
+         if (b.boundable != nullptr && !b.overflowing &&
+          a.boundable->isCollidable(b.boundable)) {
+            candidates.push_back(Collision::factory(a.boundable,
+             b.boundable));
+         }
+      }
+   }
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+bool BoundingGridT< X, Y, Z, CellPolicy >::isCulled(const glm::ivec3& index,
+ const render::ViewFrustum& viewFrustum) const {
+   // The outermost cells also hold the Boundables beyond them.
+   bool outermost = index.x == 0 || index.y == 0 || index.z == 0 ||
+    index.x == X - 1 || index.y == Y - 1 || index.z == Z - 1;
+   if (outermost) {
+      return false;
+   }
+
+   glm::vec3 halfSize = this->_cellSize * 0.5f;
+   glm::vec3 center = this->_minimum +
+    (glm::vec3(index) + glm::vec3(0.5f)) * this->_cellSize;
+   return !box_visible(center, halfSize, viewFrustum);
+}
+
+template < int X, int Y, int Z, typename CellPolicy >
+/* static */ void BoundingGridT< X, Y, Z, CellPolicy >::removeFromList(
+ std::vector< unsigned int >& list, unsigned int proxy) {
+   auto itr = std::find(list.begin(), list.end(), proxy);
+   if (itr != list.end()) {
+      *itr = list.back();
+      list.pop_back();
+   }
+}
+
+} // namespace space
+} // namespace crash
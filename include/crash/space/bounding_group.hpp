@@ -1,6 +1,5 @@
 #pragma once
 
-#include <set>
 #include <vector>
 #include <crash/common/transformer.hpp>
 #include <crash/space/bounding_box.hpp>
@@ -52,9 +51,25 @@ public:
    /////////////////////////////////////////////////////////////////////////////
 
    bool add(Boundable* boundingBox);
+
+   /**
+    * Remove the given Boundable from this group. The last member takes its
+    * place, so the order of members is not preserved.
+    */
    bool remove(Boundable* boundingBox);
    void clear();
-   const std::set< Boundable* >& getBoundables() const;
+   const std::vector< Boundable* >& getBoundables() const;
+
+   /**
+    * Collect every pair of Boundables in this group without testing them for
+    * intersection. The result is suitable input for Narrowphase::collide().
+    */
+   std::vector< Collision > getCandidateElements() const;
+
+   /**
+    * Count the pairs that getCandidateElements() would collect.
+    */
+   unsigned int getNumCandidatePairs() const;
 
    std::vector< Collision > getCollidingElements() const;
    std::vector< Boundable* > getVisibleElements(
@@ -62,7 +77,7 @@ public:
 
 protected:
    BoundingBox _boundingBox;
-   std::set< Boundable* > _boundables;
+   std::vector< Boundable* > _boundables;
 };
 
 } // namespace space
@@ -1,11 +1,18 @@
 #pragma once
 
-#include <set>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include <glm/glm.hpp>
+#include <crash/common/line.hpp>
+#include <crash/common/thread_pool.hpp>
 #include <crash/common/transformer.hpp>
 #include <crash/space/bounding_box.hpp>
 #include <crash/space/bounding_group.hpp>
+#include <crash/space/narrowphase.hpp>
+#include <crash/space/ray_hit.hpp>
+#include <crash/space/spatial_index.hpp>
 
 namespace crash {
 
@@ -20,8 +27,52 @@ typedef std::shared_ptr< BoundingPartition > BoundingPartitionPtr;
 
 class Collision;
 
-class BoundingPartition : public Boundable {
+class BoundingPartition : public Boundable, public SpatialIndex {
 public:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * How the Boundables of a partition are spread among its groups.
+    */
+   struct Occupancy {
+      unsigned int numCells;
+      // The number of groups with at least one member.
+      unsigned int numOccupied;
+      // The greatest and mean number of members of an occupied group.
+      unsigned int maxMembers;
+      float meanMembers;
+      // The number of Boundables that lie entirely outside of every group,
+      // and that reach past the sides of the partition.
+      unsigned int numOutside;
+      unsigned int numOverhanging;
+      // The number of pairs a collision query tests within groups.
+      unsigned int numCellPairs;
+   };
+
+   /**
+    * Measurements of the latest query of each kind. Durations are in seconds,
+    * and include the time spent in visitors.
+    *
+    * Every query records its measurements here, and also reuses scratch
+    * storage and stamps held by the partition, even if it is const. Queries
+    * must therefore not run concurrently on one partition; a ThreadPool
+    * given to setThreadPool() parallelizes each query instead.
+    */
+   struct QueryStatistics {
+      // The pairs given to the narrowphase, and those found to collide.
+      unsigned int numCandidates;
+      unsigned int numColliding;
+      unsigned int numVisible;
+      unsigned int numRayHits;
+      float collisionTime;
+      float visibilityTime;
+      float raycastTime;
+      float radiusTime;
+      float nearestTime;
+   };
+
    /////////////////////////////////////////////////////////////////////////////
    // Constructors.
    /////////////////////////////////////////////////////////////////////////////
@@ -54,6 +105,35 @@ public:
 
    BoundingBox* getBoundingBox();
 
+   /////////////////////////////////////////////////////////////////////////////
+   // SpatialIndex interface.
+   /////////////////////////////////////////////////////////////////////////////
+
+   bool add(Boundable* boundable);
+   bool remove(Boundable* boundable);
+
+   /**
+    * Refresh the groups containing the given Boundable after it has moved.
+    * Only the groups entered or left since the last update are touched.
+    *
+    * :param boundable: The Boundable to refresh.
+    * :return:          True if the set of containing groups changed.
+    */
+   bool update(Boundable* boundable);
+   void clear();
+
+   unsigned int getNumBoundables() const;
+   std::vector< Boundable* > getBoundables() const;
+   void forEachBoundable(const BoundableVisitor& visitor) const;
+
+   std::vector< Collision > getCandidateElements() const;
+   std::vector< Collision > getCollidingElements() const;
+   void forEachPair(const CollisionVisitor& visitor) const;
+   std::vector< Boundable* > getVisibleElements(
+    const render::ViewFrustum& viewFrustum);
+   void forEachVisible(const render::ViewFrustum& viewFrustum,
+    const BoundableVisitor& visitor);
+
    /////////////////////////////////////////////////////////////////////////////
    // Grouping.
    /////////////////////////////////////////////////////////////////////////////
@@ -63,31 +143,703 @@ public:
    void partition(const common::Transformer& transformer,
     const glm::ivec3& partitions);
 
-   bool add(Boundable* boundable);
-   bool remove(Boundable* boundable);
-   bool update(Boundable* boundable);
-   void clear();
+   /**
+    * Replace the members of this partition with the given Boundables. This is
+    * much faster than adding them one at a time: the range of every Boundable
+    * is found across the ThreadPool, and the members of every cell are then
+    * binned at once by a counting sort over cell indices. Cells list their
+    * members in the order given, just as if each had been added in turn.
+    *
+    * :param boundables: The Boundables to track. Duplicates are ignored.
+    */
+   void build(const std::vector< Boundable* >& boundables);
 
-   unsigned int getNumBoundables() const;
+   /**
+    * Place each Boundable in one level of a hierarchy of grids. Level 0 is the
+    * grid given by the partitions, and each coarser level halves the number
+    * of groups along every axis until a single group covers the partition.
+    * A Boundable is placed at the finest level whose groups are at least as
+    * large as its extents, and is only paired with Boundables at the same or
+    * coarser levels. Large Boundables then occupy a few coarse groups rather
+    * than every fine one. Off by default.
+    *
+    * :param hierarchical: Should levels be used. Every Boundable is placed
+    *                      again if this changes.
+    */
+   void setHierarchical(bool hierarchical);
+   bool getHierarchical() const;
+
+   unsigned int getNumLevels() const;
+
+   /**
+    * Detect collisions continuously over the given interval, so that
+    * Boundables moving fast enough to pass through one another between
+    * updates still collide. Each Boundable is placed in every group it
+    * sweeps through while moving with its velocities at the time it was
+    * added or last updated, and candidate pairs apart now collide if they
+    * touch within the interval. Set this to the longest expected time
+    * between updates. Off (0) by default. A Driver sweeps its collision
+    * events over the same interval.
+    *
+    * :param sweepInterval: The length of the interval, or 0 to only test the
+    *                       current positions. Every Boundable is placed again
+    *                       if this changes.
+    */
+   void setSweepInterval(float sweepInterval);
+   float getSweepInterval() const;
+
+   /**
+    * Count the groups of every level.
+    */
    unsigned int getNumBoundingGroups() const;
 
-   std::vector< Boundable* > getBoundables() const;
+   /**
+    * Copy the groups of this partition along with their members. Prefer the
+    * SpatialIndex queries in per-frame code, which do not copy.
+    */
    std::vector< BoundingGroup > getBoundingGroups() const;
 
+   /**
+    * Access the volume of a single group. The group itself holds no members;
+    * visit them with forEachInCell(). Groups are numbered level by level,
+    * from finest to coarsest.
+    *
+    * :param ndx: The linear index of the group.
+    */
+   const BoundingGroup& getBoundingGroup(unsigned int ndx) const;
+
+   /**
+    * Visit every Boundable overlapping a single group.
+    *
+    * :param ndx:     The linear index of the group.
+    * :param visitor: The visitor to give each Boundable.
+    */
+   void forEachInCell(unsigned int ndx, const BoundableVisitor& visitor) const;
+
    const glm::ivec3& getPartitions() const;
 
    std::vector< BoundingGroup > getContainingBoundingGroups(
     Boundable* boundingBox) const;
-   std::vector< Collision > getCollidingElements() const;
-   std::vector< Boundable* > getVisibleElements(
-    const render::ViewFrustum& viewFrustum);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Statistics.
+   /////////////////////////////////////////////////////////////////////////////
+
+   Occupancy getOccupancy() const;
+
+   /**
+    * Count the groups by their number of members.
+    *
+    * :return: The number of groups with each number of members, up to the
+    *          greatest.
+    */
+   std::vector< unsigned int > getMemberHistogram() const;
+
+   const QueryStatistics& getQueryStatistics() const;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Rebalancing.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Choose the partitions automatically from the occupancy of the groups.
+    * Off by default. Every call to rebalance() then checks the occupancy now
+    * and then, and builds a new grid when it leaves the occupancy limits.
+    */
+   void setAutoPartition(bool autoPartition);
+   bool getAutoPartition() const;
+
+   /**
+    * :param maxMembers:  The greatest mean number of members of an occupied
+    *                     group before the groups are made smaller.
+    * :param minOccupied: The smallest fraction of groups that must be
+    *                     occupied before the groups are made larger.
+    */
+   void setOccupancyLimits(float maxMembers, float minOccupied);
+   float getMaxMembers() const;
+   float getMinOccupied() const;
+
+   /**
+    * :param budget: The greatest number of Boundables moved to a new grid
+    *                by each call to rebalance(). Before any are moved, each
+    *                call builds up to GROUPS_PER_MIGRATION times as many
+    *                groups of the new grid.
+    */
+   void setMigrationBudget(unsigned int budget);
+   unsigned int getMigrationBudget() const;
+
+   /**
+    * Advance the automatic partitioning by one step; call this once per frame.
+    * A new grid is built a few groups at a time and then filled a few
+    * Boundables at a time, so the cost of re-partitioning is spread across
+    * frames. Queries use the current grid
+    * until every Boundable has been moved to the new one.
+    *
+    * :return: True if the partitions changed.
+    */
+   bool rebalance();
+   bool isRebalancing() const;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Parallelism.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Use the given ThreadPool to find colliding and visible elements. Cells
+    * are divided among the threads of the pool, each of which runs its own
+    * narrowphase when finding colliding elements.
+    *
+    * :param threadPool: The pool to use, or null to run serially.
+    */
+   void setThreadPool(common::ThreadPool* threadPool);
+   common::ThreadPool* getThreadPool() const;
+
+   /**
+    * Keep colliding elements in the same order as a serial query when using a
+    * ThreadPool. Each task then writes to its own buffer rather than one per
+    * thread. On by default. Visible elements are always kept in serial order.
+    */
+   void setDeterministic(bool deterministic);
+   bool getDeterministic() const;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Queries.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Determine every Boundable hit by the given ray. Only the cells the ray
+    * passes through are visited, in order from nearest to farthest.
+    *
+    * :param ray:         The ray to cast. Its direction need not be
+    *                     normalized.
+    * :param maxDistance: The distance along the ray beyond which hits are
+    *                     ignored.
+    * :return:            The hits, sorted from nearest to farthest.
+    */
+   std::vector< RayHit > raycast(const common::Line& ray, float maxDistance);
+
+   /**
+    * Determine the nearest Boundables hit by the given ray. The walk through
+    * the cells stops as soon as no farther cell can produce a nearer hit.
+    *
+    * :param ray:         The ray to cast. Its direction need not be
+    *                     normalized.
+    * :param maxDistance: The distance along the ray beyond which hits are
+    *                     ignored.
+    * :param maxHits:     The greatest number of hits to return.
+    * :return:            The nearest hits, sorted from nearest to farthest.
+    */
+   std::vector< RayHit > raycast(const common::Line& ray, float maxDistance,
+    unsigned int maxHits);
+
+   /**
+    * Determine every Boundable hit by the segment between two points, such as
+    * a line of sight.
+    *
+    * :param start:   The point to cast from.
+    * :param end:     The point to cast to.
+    * :param maxHits: The greatest number of hits to return.
+    * :return:        The nearest hits, sorted from nearest to farthest. Their
+    *                 distances are measured from start.
+    */
+   std::vector< RayHit > segmentCast(const glm::vec3& start,
+    const glm::vec3& end, unsigned int maxHits);
+
+   /**
+    * Find every Boundable within the given distance of a point. Only the
+    * cells overlapped by the sphere of that radius are visited.
+    *
+    * :param center:  The point to search around.
+    * :param radius:  The greatest distance from center to the nearest point
+    *                 of a Boundable.
+    * :param results: Output. Replaced by the Boundables found, in no
+    *                 particular order.
+    */
+   void queryRadius(const glm::vec3& center, float radius,
+    std::vector< Boundable* >& results);
+
+   /**
+    * Find the Boundables nearest to a point. Cells are visited in rings of
+    * growing distance around the point, stopping once no farther ring can
+    * hold a nearer Boundable.
+    *
+    * :param center:       The point to search around.
+    * :param numNeighbors: The greatest number of Boundables to find.
+    * :param results:      Output. Replaced by the Boundables found, sorted
+    *                      from nearest to farthest.
+    */
+   void queryNearest(const glm::vec3& center, unsigned int numNeighbors,
+    std::vector< Boundable* >& results);
 
 private:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * An inclusive range of group indices along each axis of one level. A
+    * range whose minimum exceeds its maximum on any axis is empty.
+    */
+   struct CellRange {
+      glm::ivec3 minimum;
+      glm::ivec3 maximum;
+      // Whether the extents reach past the sides of the partition, so that
+      // they are not bounded by the cells in the range.
+      bool overhanging;
+      unsigned int level;
+
+      bool isEmpty() const;
+      bool contains(const glm::ivec3& index) const;
+      bool operator==(const CellRange& other) const;
+
+      /**
+       * Express this range at the given level, which must be no finer than
+       * the level of this range.
+       */
+      CellRange atLevel(unsigned int level) const;
+   };
+
+   /**
+    * One grid of the hierarchy. The cells of every level are stored one level
+    * after another, from finest to coarsest.
+    */
+   struct Level {
+      glm::ivec3 partitions;
+      // The index of the first cell of this level.
+      unsigned int offset;
+      unsigned int numBoundables;
+   };
+
+   static const CellRange EMPTY_RANGE;
+
+   /**
+    * The distance from a query point to the Boundable in a slot.
+    */
+   typedef std::pair< float, unsigned int > Neighbor;
+
+   /**
+    * The slots of the Boundables overlapping a single group.
+    */
+   typedef std::vector< unsigned int > Cell;
+
+   /**
+    * Scratch storage for one thread of a parallel collision query.
+    */
+   struct Worker {
+      Narrowphase narrowphase;
+      std::vector< Collision > candidates;
+      std::vector< Collision > colliding;
+      unsigned int numCandidates;
+   };
+
+   /**
+    * Measures the lifetime of a query, storing the duration on destruction.
+    */
+   class QueryTimer {
+   public:
+      QueryTimer(float& duration);
+      ~QueryTimer();
+
+   private:
+      float& _duration;
+      std::chrono::steady_clock::time_point _start;
+   };
+
+   // Set in the plane mask of a cell that lies entirely outside of the
+   // ViewFrustum. The other bits of a plane mask mark the planes that a cell
+   // straddles; the cell lies entirely inside every other plane.
+   static const unsigned int CULLED;
+
+   // The number of tasks each thread is given when processing cells in
+   // parallel, to balance cells with uneven populations.
+   static const unsigned int TASKS_PER_THREAD;
+
+   // The number of calls to rebalance() between checks of the occupancy.
+   static const unsigned int REBALANCE_INTERVAL;
+
+   // The greatest number of partitions along any axis chosen by rebalance().
+   static const int MAX_PARTITIONS;
+
+   // The greatest number of groups per Boundable within the partition that
+   // rebalance() splits the groups into.
+   static const unsigned int MAX_CELLS_PER_BOUNDABLE;
+
+   // The number of groups of a new grid that rebalance() builds for each
+   // Boundable of its migration budget.
+   static const unsigned int GROUPS_PER_MIGRATION;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Helpers.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Calculate the range of groups overlapped by the axis-aligned extents of
+    * the given Boundable in the local space of this partition, at the level
+    * the Boundable belongs to.
+    *
+    * :param boundable: The Boundable to locate.
+    * :return:          The overlapped range, which is empty if the Boundable
+    *                   lies entirely outside of this partition.
+    */
+   CellRange getCellRange(Boundable* boundable);
+
+   /**
+    * Calculate the range of level 0 groups overlapped by the given extents.
+    *
+    * :param minimum: The minimum corner of the extents in grid space.
+    * :param maximum: The maximum corner of the extents in grid space.
+    * :return:        The overlapped range, which is empty if the extents lie
+    *                 entirely outside of this partition.
+    */
+   CellRange getCellRange(const glm::vec3& minimum,
+    const glm::vec3& maximum) const;
+
+   /**
+    * Express a point in grid space: the local space of this partition, scaled
+    * so that every group is a unit cube and the minimum corner is at the
+    * origin.
+    */
+   glm::vec3 toGridSpace(const glm::vec3& point) const;
+
+   /**
+    * Calculate the index into _cells of a group.
+    *
+    * :param index: The index of the group within its level.
+    * :param level: The level of the group.
+    */
+   unsigned int getCellIndex(const glm::ivec3& index,
+    unsigned int level) const;
+
+   /**
+    * Add a slot to every cell in one range but not another.
+    *
+    * :param slot:    The slot to add.
+    * :param range:   The range of cells to add the slot to.
+    * :param exclude: The range of cells to skip.
+    */
+   void addToRange(unsigned int slot, const CellRange& range,
+    const CellRange& exclude);
+
+   /**
+    * Remove a slot from every cell in one range but not another.
+    *
+    * :param slot:    The slot to remove.
+    * :param range:   The range of cells to remove the slot from.
+    * :param exclude: The range of cells to skip.
+    */
+   void removeFromRange(unsigned int slot, const CellRange& range,
+    const CellRange& exclude);
+
+   /**
+    * Visit the index into _cells of every cell in a range.
+    */
+   template < typename Visitor >
+   void forEachCellIndex(const CellRange& range, const Visitor& visitor) const;
+
+   /**
+    * Run a task over contiguous runs of items across the ThreadPool, or over
+    * every item at once if there is no ThreadPool.
+    *
+    * :param numItems: The number of items.
+    * :param task:     The task, given the index of the first item of its run
+    *                  and the index after the last.
+    */
+   template < typename Task >
+   void runRanges(unsigned int numItems, const Task& task);
+
+   /**
+    * Begin a new query by advancing the stamp. A slot has been visited by the
+    * current query if its stamp matches.
+    *
+    * :return: The stamp for the new query.
+    */
+   unsigned int nextStamp() const;
+
+   /**
+    * Collect the candidate pairs owned by a contiguous run of cells.
+    *
+    * :param begin:      The index of the first cell.
+    * :param end:        The index after the last cell.
+    * :param candidates: Output. Candidate pairs are appended.
+    */
+   void getCandidateElements(unsigned int begin, unsigned int end,
+    std::vector< Collision >& candidates) const;
+
+   /**
+    * Collect the candidate pairs between a Boundable and every Boundable at a
+    * coarser level.
+    *
+    * :param slot:       The slot of the Boundable.
+    * :param candidates: Output. Candidate pairs are appended.
+    */
+   void getCoarserCandidateElements(unsigned int slot,
+    std::vector< Collision >& candidates) const;
+
+   /**
+    * Find the colliding elements across the ThreadPool.
+    *
+    * :return: The number of leading _buffers that hold the results.
+    */
+   unsigned int getCollidingElementsParallel() const;
+
+   /**
+    * Calculate the plane mask of a box against the given ViewFrustum.
+    *
+    * :param center:      The center of the box.
+    * :param halfAxes:    The axes of the box, scaled by its half-size.
+    * :param viewFrustum: The ViewFrustum to classify against.
+    * :param parentMask:  The planes to test. The box must lie entirely inside
+    *                     every other plane.
+    * :return:            The planes straddled by the box, or CULLED.
+    */
+   static unsigned int classifyBox(const glm::vec3& center,
+    const glm::vec3 halfAxes[3], const render::ViewFrustum& viewFrustum,
+    unsigned int parentMask);
+
+   /**
+    * Calculate the plane mask of the partition as a whole, which every cell
+    * inherits.
+    */
+   unsigned int classifyPartition(const render::ViewFrustum& viewFrustum);
+
+   /**
+    * Determine if a cell lies on a side of the partition.
+    */
+   bool isOutermost(unsigned int ndx) const;
+
+   /**
+    * Calculate the plane masks of a contiguous run of cells. Empty cells are
+    * culled without being tested. The outermost cells are never culled,
+    * since the parts of their members beyond the partition may be visible.
+    *
+    * :param begin:       The index of the first cell.
+    * :param end:         The index after the last cell.
+    * :param viewFrustum: The ViewFrustum to classify against.
+    * :param parentMask:  The plane mask of the partition.
+    */
+   void classifyCells(unsigned int begin, unsigned int end,
+    const render::ViewFrustum& viewFrustum, unsigned int parentMask);
+
+   /**
+    * Combine the plane masks of every cell in a range.
+    *
+    * :param range:     The range to inspect.
+    * :param owner:     Output. The index of the first cell in the range that
+    *                   is not culled, or -1 if every cell is culled.
+    * :return:          Every plane straddled by a cell in the range, which
+    *                   are the only planes that anything overlapping only
+    *                   those cells needs to be tested against.
+    */
+   unsigned int inspectRange(const CellRange& range, int& owner) const;
+
+   /**
+    * Find the first cell in a range that is not culled. Stops at that cell,
+    * so only the culled cells before it are visited.
+    *
+    * :param range: The range to search.
+    * :return:      The index of the owning cell, or -1 if every cell is
+    *               culled.
+    */
+   int findOwner(const CellRange& range) const;
+
+   /**
+    * Find the visible elements owned by a contiguous run of cells. Each
+    * Boundable is owned by the first cell of its range that is not culled.
+    *
+    * :param begin:       The index of the first cell.
+    * :param end:         The index after the last cell.
+    * :param viewFrustum: The ViewFrustum to test against.
+    * :param visible:     Output. Visible Boundables are appended.
+    */
+   void getVisibleElements(unsigned int begin, unsigned int end,
+    const render::ViewFrustum& viewFrustum,
+    std::vector< Boundable* >& visible);
+
+   /**
+    * Find the visible elements within every cell across the ThreadPool.
+    *
+    * :param viewFrustum: The ViewFrustum to test against.
+    * :return:            The number of leading _visibleBuffers that hold the
+    *                     results.
+    */
+   unsigned int getVisibleElementsParallel(
+    const render::ViewFrustum& viewFrustum);
+
+   /**
+    * Test a Boundable against a ray unless the current query has already
+    * tested it.
+    *
+    * :param slot:        The slot of the Boundable.
+    * :param stamp:       The stamp of the current query.
+    * :param ray:         The ray to cast, with a normalized direction.
+    * :param maxDistance: The distance along the ray beyond which hits are
+    *                     ignored.
+    * :param hits:        Output. A hit is appended if the ray hits.
+    */
+   void castRay(unsigned int slot, unsigned int stamp,
+    const common::Line& ray, float maxDistance, std::vector< RayHit >& hits);
+
+   /**
+    * Walk a ray through the cells of one level from nearest to farthest,
+    * testing their members.
+    *
+    * :param level:       The level to walk.
+    * :param point:       The origin of the ray in grid space.
+    * :param direction:   The direction of the ray in grid space, scaled so
+    *                     that distances match those along the ray.
+    * :param entry:       The distance at which the ray enters the partition.
+    * :param exit:        The distance at which the ray leaves the partition.
+    * :param stamp:       The stamp of the current query.
+    * :param ray:         The ray to cast, with a normalized direction.
+    * :param maxDistance: The distance along the ray beyond which hits are
+    *                     ignored.
+    * :param maxHits:     The walk stops once this many hits are final.
+    * :param hits:        Output. Hits are appended.
+    */
+   void castRayThroughLevel(unsigned int level, const glm::vec3& point,
+    const glm::vec3& direction, float entry, float exit, unsigned int stamp,
+    const common::Line& ray, float maxDistance, unsigned int maxHits,
+    std::vector< RayHit >& hits);
+
+   /**
+    * Measure the distance from a point to a Boundable for a nearest neighbor
+    * query unless the current query has already measured it.
+    *
+    * :param slot:   The slot of the Boundable.
+    * :param stamp:  The stamp of the current query.
+    * :param center: The point to measure from.
+    */
+   void measureNeighbor(unsigned int slot, unsigned int stamp,
+    const glm::vec3& center);
+
+   /**
+    * Measure the Boundables of one level in rings of growing distance around a
+    * point, until no farther ring can hold one of the nearest Boundables.
+    *
+    * :param level:        The level to search.
+    * :param center:       The point to search around.
+    * :param numNeighbors: The number of Boundables to find.
+    * :param stamp:        The stamp of the current query.
+    */
+   void measureLevel(unsigned int level, const glm::vec3& center,
+    unsigned int numNeighbors, unsigned int stamp);
+
+   /**
+    * Measure every Boundable in the cells whose greatest offset along any axis
+    * from an origin cell is exactly the given ring.
+    *
+    * :param level:  The level of the cells.
+    * :param origin: The index of the origin cell, which may lie outside of
+    *                this partition.
+    * :param ring:   The offset of the cells to visit.
+    * :param stamp:  The stamp of the current query.
+    * :param center: The point to measure from.
+    */
+   void measureRing(unsigned int level, const glm::ivec3& origin, int ring,
+    unsigned int stamp, const glm::vec3& center);
+
+   /**
+    * Empty this partition and lay out the levels of a new grid, without
+    * building any of its groups.
+    */
+   void layOut(const common::Transformer& transformer,
+    const glm::ivec3& partitions);
+
+   /**
+    * Build the next groups of the grid, and their cells, in order.
+    *
+    * :param count: The greatest number of groups to build.
+    * :return:      True if every group of the grid has been built.
+    */
+   bool buildGroups(unsigned int count);
+
+   /**
+    * Count the groups of every level of the grid, including any that are yet
+    * to be built.
+    */
+   unsigned int getNumGroups() const;
+
+   /**
+    * Calculate the mean number of members of an occupied group.
+    */
+   float getMeanMembers() const;
+
+   /**
+    * Choose the partitions that would bring the occupancy of the grid within
+    * the occupancy limits.
+    *
+    * :return: The new partitions, which equal the current ones if the
+    *          occupancy is acceptable or cannot be improved.
+    */
+   glm::ivec3 getBalancedPartitions() const;
+
+   /**
+    * Take the grid and the Boundables of another partition, which is left
+    * with this one's.
+    */
+   void adopt(BoundingPartition& other);
+
+   static void removeFromCell(Cell& cell, unsigned int slot);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Members.
+   /////////////////////////////////////////////////////////////////////////////
+
    BoundingBox _boundingBox;
    glm::ivec3 _partitions;
+   bool _hierarchical;
+   float _sweepInterval;
+   std::vector< Level > _levels;
    std::vector< BoundingGroup > _boundingGroups;
-   std::set< Boundable* > _boundingBoxes;
-   unsigned int _numBoundables;
+   // Cells parallel to _boundingGroups.
+   std::vector< Cell > _cells;
+   // Boundables that lie entirely outside of every group.
+   Cell _outside;
+   // Boundables that reach past the sides of the partition.
+   Cell _overhanging;
+   // The number of non-empty cells, and of members across every cell, kept
+   // as cells change so that rebalance() need not count them.
+   unsigned int _numOccupied;
+   unsigned int _numMembers;
+
+   // Every Boundable is assigned a slot. The following are indexed by slot.
+   std::vector< Boundable* > _boundables;
+   std::vector< CellRange > _cellRanges;
+   mutable std::vector< unsigned int > _stamps;
+
+   std::vector< unsigned int > _freeSlots;
+   std::unordered_map< Boundable*, unsigned int > _slots;
+   mutable unsigned int _stamp;
+
+   // Scratch storage for batch intersection tests.
+   mutable Narrowphase _narrowphase;
+   mutable std::vector< Collision > _candidates;
+   mutable std::vector< Collision > _colliding;
+
+   common::ThreadPool* _threadPool;
+   bool _deterministic;
+   mutable std::vector< Worker > _workers;
+   mutable std::vector< std::vector< Collision > > _buffers;
+   std::vector< std::vector< Boundable* > > _visibleBuffers;
+   // The plane mask of every cell from the latest visibility query.
+   std::vector< unsigned char > _planeMasks;
+   // Scratch storage for nearest neighbor queries.
+   std::vector< Neighbor > _neighbors;
+   mutable QueryStatistics _queryStatistics;
+
+   bool _autoPartition;
+   float _maxMembers;
+   float _minOccupied;
+   unsigned int _migrationBudget;
+   unsigned int _rebalanceCalls;
+   // The mean number of members of an occupied group when the groups were
+   // last split, or 0 if they have not been split since they were last
+   // within the limits.
+   float _splitMembers;
+   // The grid being filled by rebalance(), which holds the Boundables in
+   // every slot before _migrated.
+   std::unique_ptr< BoundingPartition > _pending;
+   unsigned int _migrated;
 };
 
 } // namespace space
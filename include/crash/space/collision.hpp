@@ -12,6 +12,14 @@ public:
    Boundable* getFirst() const;
    Boundable* getSecond() const;
 
+   /**
+    * The time within the interval swept by a continuous collision test at
+    * which the pair first touches. Pairs that are intersecting now, and pairs
+    * found by a discrete test, touch at 0.
+    */
+   float getTimeOfImpact() const;
+   void setTimeOfImpact(float timeOfImpact);
+
    bool operator<(const Collision& other) const;
 
    static Collision factory(Boundable* first, Boundable* second);
@@ -21,6 +29,7 @@ private:
 
    Boundable* _first;
    Boundable* _second;
+   float _timeOfImpact;
 };
 
 } // namespace space
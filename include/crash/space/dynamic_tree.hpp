@@ -0,0 +1,191 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <crash/common/line.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/collision.hpp>
+#include <crash/space/narrowphase.hpp>
+#include <crash/space/ray_hit.hpp>
+#include <crash/space/spatial_index.hpp>
+
+namespace crash {
+
+namespace render {
+   class ViewFrustum;
+}
+
+namespace space {
+
+struct Boundable;
+
+class DynamicTree;
+typedef std::shared_ptr< DynamicTree > DynamicTreePtr;
+
+/**
+ * A dynamic bounding volume hierarchy of axis-aligned boxes.
+ *
+ * Every Boundable is stored in a leaf whose box is its world-space extents
+ * grown by a margin on every side. Updating a Boundable is free until it
+ * leaves its fattened box, at which point the leaf is reinserted. Leaves are
+ * inserted next to the sibling that minimizes the growth in surface area of
+ * the tree, and subtrees are rotated on the way back up to keep the tree
+ * balanced.
+ *
+ * The tree has no bounds, so it scales to worlds that are unbounded or very
+ * unevenly populated.
+ */
+class DynamicTree : public SpatialIndex {
+public:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   static const float DEFAULT_MARGIN;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Constructors.
+   /////////////////////////////////////////////////////////////////////////////
+
+   DynamicTree(const DynamicTree& dynamicTree);
+   DynamicTree();
+   DynamicTree(float margin);
+   virtual ~DynamicTree();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // SpatialIndex interface.
+   /////////////////////////////////////////////////////////////////////////////
+
+   bool add(Boundable* boundable);
+   bool remove(Boundable* boundable);
+
+   /**
+    * Refresh the given Boundable after it has moved.
+    *
+    * :param boundable: The Boundable to refresh.
+    * :return:          True if the leaf for the Boundable had to be
+    *                   reinserted.
+    */
+   bool update(Boundable* boundable);
+   void clear();
+
+   unsigned int getNumBoundables() const;
+   std::vector< Boundable* > getBoundables() const;
+   void forEachBoundable(const BoundableVisitor& visitor) const;
+
+   std::vector< Collision > getCandidateElements() const;
+   std::vector< Collision > getCollidingElements() const;
+   void forEachPair(const CollisionVisitor& visitor) const;
+   std::vector< Boundable* > getVisibleElements(
+    const render::ViewFrustum& viewFrustum);
+   void forEachVisible(const render::ViewFrustum& viewFrustum,
+    const BoundableVisitor& visitor);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Queries.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Determine every Boundable hit by the given ray.
+    *
+    * :param ray:         The ray to cast. Its direction need not be
+    *                     normalized.
+    * :param maxDistance: The distance along the ray beyond which hits are
+    *                     ignored.
+    * :return:            The hits, sorted from nearest to farthest.
+    */
+   std::vector< RayHit > raycast(const common::Line& ray, float maxDistance);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Data access.
+   /////////////////////////////////////////////////////////////////////////////
+
+   float getMargin() const;
+
+   /**
+    * Calculate the number of levels in the tree.
+    */
+   unsigned int getHeight() const;
+
+private:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   static const int NULL_NODE = -1;
+
+   struct Node {
+      BoundingBox::Extents extents;
+      Boundable* boundable;
+      // The parent of an allocated node, or the next node on the free list.
+      int parent;
+      int child1;
+      int child2;
+      // Leaves have a height of 0; free nodes have a height of -1.
+      int height;
+
+      bool isLeaf() const;
+   };
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Helpers.
+   /////////////////////////////////////////////////////////////////////////////
+
+   int allocateNode();
+   void freeNode(int node);
+
+   void insertLeaf(int leaf);
+   void removeLeaf(int leaf);
+
+   /**
+    * Rotate the subtree rooted at the given node if its children differ in
+    * height by more than one.
+    *
+    * :param node:  The root of the subtree.
+    * :return:      The new root of the subtree.
+    */
+   int balance(int node);
+
+   /**
+    * Recalculate the extents and height of every ancestor of the given node,
+    * balancing each as it goes.
+    */
+   void refit(int node);
+
+   BoundingBox::Extents getFattenedExtents(Boundable* boundable) const;
+
+   static BoundingBox::Extents combine(const BoundingBox::Extents& a,
+    const BoundingBox::Extents& b);
+   static float surfaceArea(const BoundingBox::Extents& extents);
+   static bool contains(const BoundingBox::Extents& outer,
+    const BoundingBox::Extents& inner);
+
+   /**
+    * Determine if a ray enters the given extents before the given distance.
+    *
+    * :param extents:     The extents to test.
+    * :param ray:         The ray, with a normalized direction.
+    * :param maxDistance: The distance beyond which hits are ignored.
+    */
+   static bool intersectRay(const BoundingBox::Extents& extents,
+    const common::Line& ray, float maxDistance);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Members.
+   /////////////////////////////////////////////////////////////////////////////
+
+   float _margin;
+   int _root;
+   int _freeList;
+   std::vector< Node > _nodes;
+   std::unordered_map< Boundable*, int > _leaves;
+
+   // Scratch storage for batch intersection tests.
+   mutable Narrowphase _narrowphase;
+   mutable std::vector< Collision > _colliding;
+};
+
+} // namespace space
+} // namespace crash
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <crash/space/bounding_box.hpp>
+
+namespace crash {
+namespace space {
+
+/**
+ * Counts of the outcomes of box intersection tests.
+ *
+ * While collection is enabled, BoundingBox::isIntersecting() and
+ * BoundingBoxArray::intersectPairs() add every test they run to a set of
+ * totals shared by all threads. Collection is disabled by default, when it
+ * costs each test a single branch.
+ */
+struct IntersectionStatistics {
+   /**
+    * A count for each separating axis, numbered as in BoundingBox.
+    */
+   typedef std::array< unsigned long,
+    BoundingBox::NUM_SEPARATING_AXES > AxisCounts;
+
+   IntersectionStatistics(const IntersectionStatistics& statistics);
+   IntersectionStatistics();
+
+   unsigned long numTests;
+   // Tests rejected by the bounding sphere test alone.
+   unsigned long numSphereRejects;
+   // Tests separated by each axis. A single test counts the first axis it
+   // finds, which may be one remembered from an earlier test. A batch test
+   // counts the lowest numbered axis.
+   AxisCounts numSeparations;
+   unsigned long numIntersections;
+
+   /**
+    * Calculate the fraction of tests rejected by the bounding sphere test.
+    */
+   float getSphereRejectRate() const;
+
+   IntersectionStatistics& operator+=(const IntersectionStatistics& other);
+
+   static void setCollecting(bool collecting);
+   static bool isCollecting();
+
+   /**
+    * Take a snapshot of the totals collected so far.
+    */
+   static IntersectionStatistics getCollected();
+   static void resetCollected();
+
+   /**
+    * Add the given counts to the collected totals.
+    */
+   static void collect(const IntersectionStatistics& statistics);
+
+   /**
+    * Add a single test to the collected totals.
+    *
+    * :param sphereReject:   Whether the bounding sphere test rejected it.
+    * :param separatingAxis: The axis that separated the boxes, or NO_AXIS if
+    *                        they intersect. Ignored for a sphere reject.
+    */
+   static void collect(bool sphereReject, int separatingAxis);
+};
+
+} // namespace space
+} // namespace crash
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/collision.hpp>
+#include <crash/space/narrowphase.hpp>
+#include <crash/space/spatial_index.hpp>
+
+namespace crash {
+
+namespace common {
+   class ThreadPool;
+}
+
+namespace render {
+   class ViewFrustum;
+}
+
+namespace space {
+
+struct Boundable;
+
+class LinearBVH;
+typedef std::shared_ptr< LinearBVH > LinearBVHPtr;
+
+/**
+ * A bounding volume hierarchy rebuilt from scratch whenever its Boundables
+ * change.
+ *
+ * The center of every Boundable is given a 30-bit Morton code within the
+ * bounds of the scene, and the codes are radix sorted. Sorting places nearby
+ * Boundables next to one another, so the hierarchy follows directly from the
+ * bits in which neighbouring codes differ, and every internal node is emitted
+ * independently of the others in one linear pass.
+ *
+ * Updating a Boundable only marks the hierarchy as stale, so this suits
+ * scenes in which nearly everything moves every frame. The hierarchy is
+ * rebuilt by the next query, or explicitly with build(). Nodes are stored
+ * contiguously, which keeps traversal cache friendly.
+ */
+class LinearBVH : public SpatialIndex {
+public:
+   /////////////////////////////////////////////////////////////////////////////
+   // Constructors.
+   /////////////////////////////////////////////////////////////////////////////
+
+   LinearBVH(const LinearBVH& linearBVH);
+   LinearBVH();
+   virtual ~LinearBVH();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // SpatialIndex interface.
+   /////////////////////////////////////////////////////////////////////////////
+
+   bool add(Boundable* boundable);
+   bool remove(Boundable* boundable);
+
+   /**
+    * Mark the hierarchy as stale after the given Boundable has moved.
+    *
+    * :param boundable: The Boundable to refresh.
+    * :return:          True if the Boundable was not tracked and had to be
+    *                   added.
+    */
+   bool update(Boundable* boundable);
+   void clear();
+
+   unsigned int getNumBoundables() const;
+   std::vector< Boundable* > getBoundables() const;
+   void forEachBoundable(const BoundableVisitor& visitor) const;
+
+   std::vector< Collision > getCandidateElements() const;
+   std::vector< Collision > getCollidingElements() const;
+   void forEachPair(const CollisionVisitor& visitor) const;
+   std::vector< Boundable* > getVisibleElements(
+    const render::ViewFrustum& viewFrustum);
+   void forEachVisible(const render::ViewFrustum& viewFrustum,
+    const BoundableVisitor& visitor);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Construction.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Rebuild the hierarchy from the current extents of every Boundable.
+    * Queries rebuild a stale hierarchy on their own; call this to control
+    * when the cost is paid, such as once per tick after moving everything.
+    */
+   void build();
+
+   /**
+    * Determine if the hierarchy must be rebuilt before the next query.
+    */
+   bool isStale() const;
+
+   /**
+    * Set a pool of threads with which to build the hierarchy and find
+    * candidate pairs. The pool must outlive its use by this LinearBVH.
+    *
+    * :param threadPool: The pool to use, or null to run serially.
+    */
+   void setThreadPool(common::ThreadPool* threadPool);
+   common::ThreadPool* getThreadPool() const;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Data access.
+   /////////////////////////////////////////////////////////////////////////////
+
+   unsigned int getNumNodes() const;
+
+   /**
+    * Calculate the greatest number of nodes from the root to a leaf.
+    */
+   unsigned int getHeight() const;
+
+   // The number of tasks each thread is given when working in parallel.
+   static const unsigned int TASKS_PER_THREAD;
+
+private:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * The first getNumBoundables() - 1 nodes are internal, with the root
+    * first. The remaining nodes are leaves in Morton order.
+    */
+   struct Node {
+      BoundingBox::Extents extents;
+      unsigned int child1;
+      unsigned int child2;
+      Boundable* boundable;
+   };
+
+   struct Primitive {
+      std::uint32_t code;
+      unsigned int index;
+   };
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Helpers.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Rebuild the hierarchy if it is stale. Queries are logically const, so
+    * the hierarchy is held in mutable storage.
+    */
+   void refresh() const;
+
+   /**
+    * Run a task over the given number of items, split into ranges across the
+    * thread pool if there is one.
+    *
+    * :param numItems: The number of items.
+    * :param task:     The task to run for each range of items, as
+    *                  task(taskIndex, begin, end).
+    * :return:         The number of tasks the items were split into.
+    */
+   template < typename Task >
+   unsigned int runRanges(unsigned int numItems, const Task& task) const;
+
+   /**
+    * Sort the primitives by their Morton codes, keeping the order of equal
+    * codes.
+    */
+   void sortPrimitives() const;
+
+   /**
+    * Emit the internal node with the given index from the sorted codes.
+    */
+   void emitNode(unsigned int index) const;
+
+   /**
+    * Calculate the extents of every internal node from its children.
+    */
+   void refitNodes() const;
+
+   /**
+    * Calculate the length of the prefix shared by the sorted codes at two
+    * positions, or -1 if the second position lies outside of the codes.
+    * Equal codes are told apart by their positions.
+    */
+   int getCommonPrefix(int first, int second) const;
+
+   /**
+    * Collect the candidate pairs of the leaves in the given range, which are
+    * appended to the given container.
+    */
+   void getCandidateElements(unsigned int begin, unsigned int end,
+    std::vector< Collision >& candidates) const;
+
+   bool isLeaf(unsigned int node) const;
+
+   /**
+    * Spread the low 10 bits of a value so that two zero bits separate each.
+    */
+   static std::uint32_t expandBits(std::uint32_t value);
+   static std::uint32_t getMortonCode(const glm::vec3& position);
+   static int countLeadingZeros(std::uint32_t value);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Members.
+   /////////////////////////////////////////////////////////////////////////////
+
+   std::vector< Boundable* > _boundables;
+   std::unordered_map< Boundable*, unsigned int > _indices;
+   common::ThreadPool* _threadPool;
+
+   // The hierarchy, which is rebuilt when stale.
+   mutable bool _isStale;
+   mutable std::vector< Node > _nodes;
+   mutable std::vector< BoundingBox::Extents > _extents;
+   mutable std::vector< Primitive > _primitives;
+   mutable std::vector< Primitive > _sortBuffer;
+
+   // Scratch storage for parallel queries and batch intersection tests.
+   mutable std::vector< std::vector< Collision > > _candidateBuffers;
+   mutable Narrowphase _narrowphase;
+   mutable std::vector< Collision > _candidates;
+   mutable std::vector< Collision > _colliding;
+};
+
+} // namespace space
+} // namespace crash
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <boost/optional.hpp>
+#include <crash/space/bounding_box_array.hpp>
+#include <crash/space/collision.hpp>
+
+namespace crash {
+namespace space {
+
+struct Boundable;
+
+/**
+ * Batch intersection tests for candidate pairs of Boundables.
+ *
+ * Candidate pairs are typically produced by a broadphase, such as
+ * BoundingGroup::getCandidateElements(). Each distinct Boundable is copied
+ * into a BoundingBoxArray once per call, and the pairs are then tested several
+ * at a time with BoundingBoxArray::intersectPairs(). Only the BoundingBoxes
+ * are tested; overrides of Boundable::isIntersecting() are not called.
+ *
+ * The scratch storage used for a call is retained, so reusing one Narrowphase
+ * across frames does not allocate once it has grown to the working set.
+ */
+class Narrowphase {
+public:
+   /////////////////////////////////////////////////////////////////////////////
+   // Constructors.
+   /////////////////////////////////////////////////////////////////////////////
+
+   Narrowphase(const Narrowphase& narrowphase);
+   Narrowphase();
+   virtual ~Narrowphase();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Queries.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Determine which of the given candidate pairs are intersecting.
+    *
+    * :param candidates:   The candidate pairs to test.
+    * :param colliding:    Output. Cleared, then filled with every intersecting
+    *                      candidate in the order they were given.
+    */
+   void collide(const std::vector< Collision >& candidates,
+    std::vector< Collision >& colliding);
+
+   /**
+    * Determine which of the given candidate pairs are intersecting now, or
+    * will touch within the given interval as they move with their current
+    * velocities.
+    *
+    * :param candidates:   The candidate pairs to test.
+    * :param colliding:    Output. Cleared, then filled with every colliding
+    *                      candidate in the order they were given, each
+    *                      carrying its time of impact.
+    * :param delta_t:      The length of the interval to sweep, or 0 to test
+    *                      only the current positions.
+    */
+   void collide(const std::vector< Collision >& candidates,
+    std::vector< Collision >& colliding, float delta_t);
+
+private:
+   unsigned int getSlot(Boundable* boundable);
+
+   /**
+    * Calculate when a pair that is apart now will touch within the interval.
+    * Only the transforms of the pair are read, so Narrowphases on several
+    * threads may test pairs that share a Boundable.
+    */
+   boost::optional< float > getTimeOfImpact(const Collision& candidate,
+    float delta_t) const;
+
+   BoundingBoxArray _boundingBoxes;
+   BoundingBoxArray::SlotPairs _pairs;
+   BoundingBoxArray::Bitmask _intersecting;
+   std::unordered_map< Boundable*, unsigned int > _slots;
+};
+
+} // namespace space
+} // namespace crash
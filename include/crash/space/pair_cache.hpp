@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <crash/space/collision.hpp>
+
+namespace crash {
+namespace space {
+
+struct Boundable;
+
+class PairCache;
+typedef std::shared_ptr< PairCache > PairCachePtr;
+
+/**
+ * A persistent record of candidate pairs that reports how their collisions
+ * change from one update to the next.
+ *
+ * Every update is given the candidate pairs from a broadphase, such as
+ * SpatialIndex::getCandidateElements(). Each pair is tested for intersection
+ * and compared with the previous update: pairs that started colliding are
+ * reported as COLLISION_BEGIN, pairs that continue to collide as
+ * COLLISION_STAY, and pairs that stopped colliding or are no longer
+ * candidates as COLLISION_END.
+ *
+ * The axis that last separated each pair is remembered and tested first, so
+ * a pair that stays apart usually costs a single axis test.
+ */
+class PairCache {
+public:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   enum CollisionEvent {
+      COLLISION_BEGIN,
+      COLLISION_STAY,
+      COLLISION_END,
+   };
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Constructors.
+   /////////////////////////////////////////////////////////////////////////////
+
+   PairCache(const PairCache& pairCache);
+   PairCache();
+   virtual ~PairCache();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Caching.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Test the given candidate pairs and determine which collisions began,
+    * stayed, and ended since the previous update.
+    *
+    * :param candidates: The candidate pairs, each of which appears once.
+    */
+   void update(const std::vector< Collision >& candidates);
+
+   /**
+    * Test the given candidate pairs as in update(candidates), and also count
+    * as colliding every pair that is apart now but will touch within the
+    * given interval as its Boundables move with their current velocities.
+    * Each reported pair carries its time of impact.
+    *
+    * :param candidates: The candidate pairs, each of which appears once.
+    * :param delta_t:    The length of the interval to sweep, or 0 to test
+    *                    only the current positions.
+    */
+   void update(const std::vector< Collision >& candidates, float delta_t);
+
+   /**
+    * Forget every pair involving the given Boundable without reporting their
+    * end. Call this before a Boundable is destroyed.
+    *
+    * :param boundable: The Boundable to forget.
+    */
+   void remove(Boundable* boundable);
+   void clear();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Data access.
+   /////////////////////////////////////////////////////////////////////////////
+
+   const std::vector< Collision >& getBegun() const;
+   const std::vector< Collision >& getStaying() const;
+   const std::vector< Collision >& getEnded() const;
+
+   /**
+    * Gather every pair colliding as of the latest update.
+    */
+   std::vector< Collision > getColliding() const;
+
+   unsigned int getNumPairs() const;
+
+private:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   typedef std::pair< Boundable*, Boundable* > Key;
+
+   struct KeyHash {
+      std::size_t operator()(const Key& key) const;
+   };
+
+   struct Entry {
+      int separatingAxis;
+      unsigned int update;
+      bool colliding;
+   };
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Members.
+   /////////////////////////////////////////////////////////////////////////////
+
+   std::unordered_map< Key, Entry, KeyHash > _entries;
+   unsigned int _update;
+
+   std::vector< Collision > _begun;
+   std::vector< Collision > _staying;
+   std::vector< Collision > _ended;
+};
+
+} // namespace space
+} // namespace crash
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace crash {
+namespace space {
+
+struct Boundable;
+
+struct RayHit {
+   RayHit(const RayHit& rayHit);
+   RayHit(Boundable* boundable, float distance);
+
+   Boundable* boundable;
+   float distance;
+
+   /**
+    * Order RayHits from nearest to farthest.
+    */
+   bool operator<(const RayHit& other) const;
+};
+
+} // namespace space
+} // namespace crash
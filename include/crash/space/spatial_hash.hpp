@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <crash/space/collision.hpp>
+#include <crash/space/narrowphase.hpp>
+#include <crash/space/spatial_index.hpp>
+
+namespace crash {
+
+namespace render {
+   class ViewFrustum;
+}
+
+namespace space {
+
+struct Boundable;
+
+class SpatialHash;
+typedef std::shared_ptr< SpatialHash > SpatialHashPtr;
+
+/**
+ * An unbounded grid of uniform, axis-aligned cells.
+ *
+ * Each Boundable is placed in every cell overlapped by its world-space
+ * extents. Cells are found by hashing their integer coordinates into a
+ * sparse table, and only cells with members are stored, so the grid has no
+ * bounds and its memory is proportional to the occupied cells.
+ *
+ * A Boundable that would overlap more than MAX_CELLS cells is instead kept
+ * in a list of oversized Boundables, which are paired with every other.
+ */
+class SpatialHash : public SpatialIndex {
+public:
+   /////////////////////////////////////////////////////////////////////////////
+   // Constructors.
+   /////////////////////////////////////////////////////////////////////////////
+
+   SpatialHash(const SpatialHash& spatialHash);
+
+   /**
+    * :param cellSize: The length of each side of a cell. Cells work best
+    *                  when a little larger than a typical Boundable.
+    */
+   SpatialHash(float cellSize);
+   virtual ~SpatialHash();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // SpatialIndex interface.
+   /////////////////////////////////////////////////////////////////////////////
+
+   bool add(Boundable* boundable);
+   bool remove(Boundable* boundable);
+
+   /**
+    * Refresh the cells containing the given Boundable after it has moved.
+    * Only the cells entered or left since the last update are touched.
+    *
+    * :param boundable: The Boundable to refresh.
+    * :return:          True if the set of containing cells changed.
+    */
+   bool update(Boundable* boundable);
+   void clear();
+
+   unsigned int getNumBoundables() const;
+   std::vector< Boundable* > getBoundables() const;
+   void forEachBoundable(const BoundableVisitor& visitor) const;
+
+   std::vector< Collision > getCandidateElements() const;
+   std::vector< Collision > getCollidingElements() const;
+   void forEachPair(const CollisionVisitor& visitor) const;
+   std::vector< Boundable* > getVisibleElements(
+    const render::ViewFrustum& viewFrustum);
+   void forEachVisible(const render::ViewFrustum& viewFrustum,
+    const BoundableVisitor& visitor);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Data access.
+   /////////////////////////////////////////////////////////////////////////////
+
+   float getCellSize() const;
+
+   /**
+    * Count the cells with at least one member.
+    */
+   unsigned int getNumCells() const;
+
+   unsigned int getNumOversized() const;
+
+   // The greatest number of cells a Boundable may overlap before it is kept
+   // in the list of oversized Boundables instead.
+   static const unsigned int MAX_CELLS;
+
+private:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * An inclusive range of cell coordinates along each axis. A range whose
+    * minimum exceeds its maximum on any axis is empty.
+    */
+   struct CellRange {
+      glm::ivec3 minimum;
+      glm::ivec3 maximum;
+
+      bool isEmpty() const;
+      bool contains(const glm::ivec3& index) const;
+      bool operator==(const CellRange& other) const;
+
+      /**
+       * Count the cells in this range, without overflowing for huge ranges.
+       */
+      double getNumCells() const;
+   };
+
+   struct Proxy {
+      Boundable* boundable;
+      CellRange range;
+      bool oversized;
+   };
+
+   struct CellHash {
+      std::size_t operator()(const glm::ivec3& index) const;
+   };
+
+   /**
+    * The proxies of the Boundables overlapping a single cell.
+    */
+   typedef std::vector< unsigned int > Cell;
+
+   static const CellRange EMPTY_RANGE;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Helpers.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Calculate the range of cells overlapped by the world-space extents of
+    * the given Boundable.
+    */
+   CellRange getCellRange(Boundable* boundable) const;
+
+   /**
+    * Add a proxy to every cell in one range but not another.
+    *
+    * :param proxy:   The proxy to add.
+    * :param range:   The range of cells to add the proxy to.
+    * :param exclude: The range of cells to skip.
+    */
+   void addToRange(unsigned int proxy, const CellRange& range,
+    const CellRange& exclude);
+
+   /**
+    * Remove a proxy from every cell in one range but not another. Cells left
+    * empty are released.
+    *
+    * :param proxy:   The proxy to remove.
+    * :param range:   The range of cells to remove the proxy from.
+    * :param exclude: The range of cells to skip.
+    */
+   void removeFromRange(unsigned int proxy, const CellRange& range,
+    const CellRange& exclude);
+
+   /**
+    * Place a proxy in the cells of its range, or in the list of oversized
+    * proxies.
+    */
+   void insert(unsigned int proxy);
+
+   /**
+    * Take a proxy out of the cells of its range, or out of the list of
+    * oversized proxies.
+    */
+   void erase(unsigned int proxy);
+
+   /**
+    * Collect the candidate pairs, which are appended to the given container.
+    */
+   void getCandidateElements(std::vector< Collision >& candidates) const;
+
+   /**
+    * Determine if a cell lies entirely outside of any plane of the given
+    * ViewFrustum.
+    */
+   bool isCulled(const glm::ivec3& index,
+    const render::ViewFrustum& viewFrustum) const;
+
+   static void removeFromCell(Cell& cell, unsigned int proxy);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Members.
+   /////////////////////////////////////////////////////////////////////////////
+
+   float _cellSize;
+   std::unordered_map< glm::ivec3, Cell, CellHash > _cells;
+   Cell _oversized;
+
+   std::vector< Proxy > _proxies;
+   std::vector< unsigned int > _freeProxies;
+   std::unordered_map< Boundable*, unsigned int > _proxyIndices;
+
+   // A proxy has been visited by the current query if its stamp matches.
+   std::vector< unsigned int > _stamps;
+   unsigned int _stamp;
+
+   // Scratch storage for batch intersection tests.
+   mutable Narrowphase _narrowphase;
+   mutable std::vector< Collision > _candidates;
+   mutable std::vector< Collision > _colliding;
+};
+
+} // namespace space
+} // namespace crash
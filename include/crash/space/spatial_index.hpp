@@ -0,0 +1,98 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <crash/space/collision.hpp>
+
+namespace crash {
+
+namespace render {
+   class ViewFrustum;
+}
+
+namespace space {
+
+struct Boundable;
+
+/**
+ * A broadphase structure that tracks a set of Boundables and answers
+ * collision and visibility queries about them.
+ */
+struct SpatialIndex {
+   /**
+    * Visitors are given each result of a query in turn, so that no container
+    * of results is built. A visitor must not modify the SpatialIndex or run
+    * another query on it.
+    */
+   typedef std::function< void(Boundable* boundable) > BoundableVisitor;
+   typedef std::function< void(const Collision& collision) > CollisionVisitor;
+
+   virtual ~SpatialIndex() {}
+
+   /**
+    * Begin tracking the given Boundable.
+    *
+    * :param boundable: The Boundable to track.
+    */
+   virtual bool add(Boundable* boundable) = 0;
+
+   /**
+    * Stop tracking the given Boundable.
+    *
+    * :param boundable: The Boundable to stop tracking.
+    */
+   virtual bool remove(Boundable* boundable) = 0;
+
+   /**
+    * Refresh the given Boundable after it has moved.
+    *
+    * :param boundable: The Boundable to refresh.
+    */
+   virtual bool update(Boundable* boundable) = 0;
+
+   virtual void clear() = 0;
+
+   virtual unsigned int getNumBoundables() const = 0;
+   virtual std::vector< Boundable* > getBoundables() const = 0;
+   virtual void forEachBoundable(const BoundableVisitor& visitor) const = 0;
+
+   /**
+    * Determine every pair of tracked Boundables that might be intersecting,
+    * without testing them. Each pair is reported once.
+    */
+   virtual std::vector< Collision > getCandidateElements() const = 0;
+
+   /**
+    * Determine every pair of tracked Boundables that are intersecting. Each
+    * pair is reported once.
+    */
+   virtual std::vector< Collision > getCollidingElements() const = 0;
+
+   /**
+    * Visit every pair of tracked Boundables that are intersecting. Each pair
+    * is visited once.
+    *
+    * :param visitor: The visitor to give each pair.
+    */
+   virtual void forEachPair(const CollisionVisitor& visitor) const = 0;
+
+   /**
+    * Determine every tracked Boundable that is within the given ViewFrustum.
+    *
+    * :param viewFrustum:  The ViewFrustum to test against.
+    */
+   virtual std::vector< Boundable* > getVisibleElements(
+    const render::ViewFrustum& viewFrustum) = 0;
+
+   /**
+    * Visit every tracked Boundable that is within the given ViewFrustum.
+    *
+    * :param viewFrustum:  The ViewFrustum to test against.
+    * :param visitor:      The visitor to give each Boundable.
+    */
+   virtual void forEachVisible(const render::ViewFrustum& viewFrustum,
+    const BoundableVisitor& visitor) = 0;
+};
+
+} // namespace space
+} // namespace crash
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#include <crash/space/collision.hpp>
+#include <crash/space/narrowphase.hpp>
+#include <crash/space/spatial_index.hpp>
+
+namespace crash {
+
+namespace render {
+   class ViewFrustum;
+}
+
+namespace space {
+
+struct Boundable;
+
+class SweepAndPrune;
+typedef std::shared_ptr< SweepAndPrune > SweepAndPrunePtr;
+
+/**
+ * A sweep-and-prune broadphase.
+ *
+ * The world-space extents of every Boundable are kept as sorted lists of
+ * interval endpoints, one list per axis. A set of Boundables whose extents
+ * overlap on all three axes is maintained incrementally: when an endpoint is
+ * moved past another with an insertion sort, the pair they belong to either
+ * begins or ends overlapping on that axis.
+ *
+ * Boundables typically move a small distance per update, so each update only
+ * performs a handful of swaps regardless of how densely they are clustered.
+ */
+class SweepAndPrune : public SpatialIndex {
+public:
+   /////////////////////////////////////////////////////////////////////////////
+   // Constructors.
+   /////////////////////////////////////////////////////////////////////////////
+
+   SweepAndPrune(const SweepAndPrune& sweepAndPrune);
+   SweepAndPrune();
+   virtual ~SweepAndPrune();
+
+   /////////////////////////////////////////////////////////////////////////////
+   // SpatialIndex interface.
+   /////////////////////////////////////////////////////////////////////////////
+
+   bool add(Boundable* boundable);
+   bool remove(Boundable* boundable);
+   bool update(Boundable* boundable);
+   void clear();
+
+   unsigned int getNumBoundables() const;
+   std::vector< Boundable* > getBoundables() const;
+   void forEachBoundable(const BoundableVisitor& visitor) const;
+
+   std::vector< Collision > getCandidateElements() const;
+   std::vector< Collision > getCollidingElements() const;
+   void forEachPair(const CollisionVisitor& visitor) const;
+   std::vector< Boundable* > getVisibleElements(
+    const render::ViewFrustum& viewFrustum);
+   void forEachVisible(const render::ViewFrustum& viewFrustum,
+    const BoundableVisitor& visitor);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Data access.
+   /////////////////////////////////////////////////////////////////////////////
+
+   unsigned int getNumOverlappingPairs() const;
+
+private:
+   /////////////////////////////////////////////////////////////////////////////
+   // Type definitions.
+   /////////////////////////////////////////////////////////////////////////////
+
+   struct Endpoint {
+      float value;
+      unsigned int proxy;
+      bool isMaximum;
+   };
+
+   struct Proxy {
+      Boundable* boundable;
+      glm::vec3 minimum;
+      glm::vec3 maximum;
+      std::array< unsigned int, 3 > minimumEndpoints;
+      std::array< unsigned int, 3 > maximumEndpoints;
+   };
+
+   typedef std::vector< Endpoint > Endpoints;
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Helpers.
+   /////////////////////////////////////////////////////////////////////////////
+
+   /**
+    * Move the endpoint at the given position towards the front of the list for
+    * the given axis until it is sorted.
+    *
+    * :param axis:     The axis whose list the endpoint is in.
+    * :param position: The current position of the endpoint.
+    * :param track:    Should pairs be added or removed as endpoints cross.
+    */
+   void sortDown(unsigned int axis, unsigned int position, bool track);
+
+   /**
+    * Move the endpoint at the given position towards the back of the list for
+    * the given axis until it is sorted.
+    *
+    * :param axis:     The axis whose list the endpoint is in.
+    * :param position: The current position of the endpoint.
+    * :param track:    Should pairs be added or removed as endpoints cross.
+    */
+   void sortUp(unsigned int axis, unsigned int position, bool track);
+
+   /**
+    * Exchange two adjacent endpoints in the list for the given axis and record
+    * any change in overlap between their proxies.
+    *
+    * :param axis:     The axis whose list the endpoints are in.
+    * :param lower:    The position of the first endpoint; the second endpoint
+    *                  is immediately after it.
+    * :param track:    Should pairs be added or removed as endpoints cross.
+    */
+   void swap(unsigned int axis, unsigned int lower, bool track);
+
+   void setEndpoint(unsigned int axis, unsigned int position);
+   void refreshExtents(Proxy& proxy);
+   bool isOverlapping(const Proxy& a, const Proxy& b) const;
+
+   /**
+    * Determine if one endpoint sorts before another. Ties are broken with
+    * minimums before maximums, so that touching intervals overlap.
+    */
+   static bool precedes(const Endpoint& a, const Endpoint& b);
+   static std::uint64_t pairKey(unsigned int a, unsigned int b);
+
+   /////////////////////////////////////////////////////////////////////////////
+   // Members.
+   /////////////////////////////////////////////////////////////////////////////
+
+   std::array< Endpoints, 3 > _endpoints;
+   std::vector< Proxy > _proxies;
+   std::vector< unsigned int > _freeProxies;
+   std::unordered_map< Boundable*, unsigned int > _proxyIndices;
+   std::unordered_set< std::uint64_t > _overlappingPairs;
+
+   // Scratch storage for batch intersection tests.
+   mutable Narrowphase _narrowphase;
+   mutable std::vector< Collision > _colliding;
+};
+
+} // namespace space
+} // namespace crash
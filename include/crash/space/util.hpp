@@ -1,8 +1,14 @@
 #pragma once
 
+#include <array>
 #include <glm/glm.hpp>
 
 namespace crash {
+
+namespace render {
+   class ViewFrustum;
+}
+
 namespace space {
 
 /**
@@ -41,5 +47,37 @@ glm::ivec2 vectorize_index(int index, const glm::ivec2& bounds);
  */
 glm::ivec3 vectorize_index(int index, const glm::ivec3& bounds);
 
+/**
+ * Determines if two axis-aligned extents, such as BoundingBox::Extents,
+ * overlap. Extents that only touch are overlapping.
+ *
+ * :param a: The minimum and maximum corners of the first extents.
+ * :param b: The minimum and maximum corners of the second extents.
+ */
+bool extents_overlap(const std::array< glm::vec3, 2 >& a,
+ const std::array< glm::vec3, 2 >& b);
+
+/**
+ * Determines if any part of an axis-aligned box may be within a
+ * ViewFrustum. The box is only rejected if it lies entirely outside of some
+ * plane of the frustum.
+ *
+ * :param center:      The center of the box.
+ * :param halfSize:    Half of the size of the box along each axis.
+ * :param viewFrustum: The ViewFrustum to test against.
+ */
+bool box_visible(const glm::vec3& center, const glm::vec3& halfSize,
+ const render::ViewFrustum& viewFrustum);
+
+/**
+ * Determines if any part of axis-aligned extents may be within a
+ * ViewFrustum, as box_visible() does.
+ *
+ * :param extents:     The minimum and maximum corners of the extents.
+ * :param viewFrustum: The ViewFrustum to test against.
+ */
+bool extents_visible(const std::array< glm::vec3, 2 >& extents,
+ const render::ViewFrustum& viewFrustum);
+
 } // namespace space
 } // namespace crash
@@ -26,8 +26,9 @@ buildoptions({
    '-Wextra',
    '-Werror',
    '-Wno-unused-result',
+   '-pthread',
 })
-linkoptions({})
+linkoptions({'-pthread'})
 
 configurations('debug', 'profile', 'release')
 
@@ -20,15 +20,27 @@ using namespace crash::common;
    this->setSize(size + size * scale);
 }
 
+// Each component of movement is skipped while its velocity is zero, which
+// spares the slerp and keeps any state cached from the transform.
+
 /* virtual */ void Movable::translate(float delta_t) {
+   if (this->getTranslationalVelocity() == glm::vec3()) {
+      return;
+   }
    this->translate(this->getTranslationalDelta(delta_t));
 }
 
 /* virtual */ void Movable::rotate(float delta_t) {
+   if (this->getRotationalVelocity() == NO_ROTATION) {
+      return;
+   }
    this->rotate(this->getRotationalDelta(delta_t));
 }
 
 /* virtual */ void Movable::scale(float delta_t) {
+   if (this->getScaleVelocity() == glm::vec3()) {
+      return;
+   }
    this->scale(this->getScaleDelta(delta_t));
 }
 
@@ -38,6 +50,12 @@ using namespace crash::common;
    this->scale(delta_t);
 }
 
+bool Movable::isMoving() const {
+   return this->getTranslationalVelocity() != glm::vec3() ||
+    this->getRotationalVelocity() != NO_ROTATION ||
+    this->getScaleVelocity() != glm::vec3();
+}
+
 glm::vec3 Movable::getUp() {
    return glm::normalize(glm::vec3(glm::mat4_cast(this->getOrientation()) *
     glm::vec4(UP, 1.0f)));
@@ -0,0 +1,110 @@
+#include <crash/common/thread_pool.hpp>
+
+using namespace crash::common;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::ThreadPool(unsigned int numThreads) :
+   _workers(), _mutex(), _wake(), _done(), _task(nullptr), _numTasks(0),
+    _nextTask(0), _numBusy(0), _generation(0), _isStopping(false)
+{
+   for (unsigned int thread = 1; thread < numThreads; ++thread) {
+      this->_workers.push_back(std::thread(&ThreadPool::work, this, thread));
+   }
+}
+
+ThreadPool::ThreadPool() :
+   ThreadPool(ThreadPool::getDefaultNumThreads())
+{}
+
+/* virtual */ ThreadPool::~ThreadPool() {
+   {
+      std::lock_guard< std::mutex > lock(this->_mutex);
+      this->_isStopping = true;
+   }
+   this->_wake.notify_all();
+
+   for (std::thread& worker : this->_workers) {
+      worker.join();
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Execution.
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::run(unsigned int numTasks, const Task& task) {
+   if (numTasks == 0) {
+      return;
+   }
+
+   if (this->_workers.empty() || numTasks == 1) {
+      for (unsigned int ndx = 0; ndx < numTasks; ++ndx) {
+         task(ndx, 0);
+      }
+      return;
+   }
+
+   {
+      std::lock_guard< std::mutex > lock(this->_mutex);
+      this->_task = &task;
+      this->_numTasks = numTasks;
+      this->_nextTask = 0;
+      this->_numBusy = this->_workers.size();
+      ++this->_generation;
+   }
+   this->_wake.notify_all();
+
+   this->execute(0);
+
+   std::unique_lock< std::mutex > lock(this->_mutex);
+   this->_done.wait(lock, [this]() { return this->_numBusy == 0; });
+   this->_task = nullptr;
+}
+
+unsigned int ThreadPool::getNumThreads() const {
+   return this->_workers.size() + 1;
+}
+
+/* static */ unsigned int ThreadPool::getDefaultNumThreads() {
+   unsigned int numThreads = std::thread::hardware_concurrency();
+   return (numThreads > 0) ? numThreads : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers.
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::work(unsigned int thread) {
+   unsigned int generation = 0;
+
+   while (true) {
+      {
+         std::unique_lock< std::mutex > lock(this->_mutex);
+         this->_wake.wait(lock, [this, generation]() {
+            return this->_isStopping || this->_generation != generation;
+         });
+
+         if (this->_isStopping) {
+            return;
+         }
+         generation = this->_generation;
+      }
+
+      this->execute(thread);
+
+      std::lock_guard< std::mutex > lock(this->_mutex);
+      if (--this->_numBusy == 0) {
+         this->_done.notify_all();
+      }
+   }
+}
+
+void ThreadPool::execute(unsigned int thread) {
+   unsigned int task;
+   while ((task = this->_nextTask++) < this->_numTasks) {
+      (*this->_task)(task, thread);
+   }
+}
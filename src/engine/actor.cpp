@@ -6,7 +6,9 @@ using namespace crash::render;
 using namespace crash::space;
 
 Actor::Actor(const Actor& actor) :
-   _boundingBox(actor._boundingBox), _meshInstance(actor._meshInstance)
+   Boundable(actor),
+    _boundingBox(actor._boundingBox),
+    _meshInstance(actor._meshInstance)
 {}
 
 Actor::Actor(const BoundingBox& _boundingBox,
@@ -46,14 +48,17 @@ glm::vec3 Actor::getScaleVelocity() const {
 
 void Actor::setPosition(const glm::vec3& position) {
    this->_boundingBox.setPosition(position);
+   this->setSleeping(false);
 }
 
 void Actor::setOrientation(const glm::quat& orientation) {
    this->_boundingBox.setOrientation(orientation);
+   this->setSleeping(false);
 }
 
 void Actor::setSize(const glm::vec3& size) {
    this->_boundingBox.setSize(size);
+   this->setSleeping(false);
 }
 
 void Actor::setTranslationalVelocity(const glm::vec3& translationalVelocity) {
@@ -7,7 +7,8 @@ using namespace crash::render;
 using namespace crash::space;
 
 Camera::Camera(const Camera& camera) :
-   _boundingBox(camera._boundingBox),
+   Boundable(camera),
+    _boundingBox(camera._boundingBox),
     _verticalFieldOfView(camera._verticalFieldOfView),
     _aspectRatio(camera._aspectRatio),
     _nearPlane(camera._nearPlane),
@@ -65,16 +66,19 @@ glm::vec3 Camera::getScaleVelocity() const {
 void Camera::setPosition(const glm::vec3& position) {
    this->_boundingBox.setPosition(position);
    this->invalidate();
+   this->setSleeping(false);
 }
 
 void Camera::setOrientation(const glm::quat& orientation) {
    this->_boundingBox.setOrientation(orientation);
    this->invalidate();
+   this->setSleeping(false);
 }
 
 void Camera::setSize(const glm::vec3& size) {
    this->_boundingBox.setSize(size);
    this->invalidate();
+   this->setSleeping(false);
 }
 
 void Camera::setTranslationalVelocity(const glm::vec3& translationalVelocity) {
@@ -13,6 +13,8 @@
 #include <crash/engine/actor.hpp>
 #include <crash/engine/driver.hpp>
 #include <crash/space/boundable.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/bounding_partition.hpp>
 #include <crash/render/mesh_instance.hpp>
 #include <crash/render/renderable.hpp>
 #include <crash/render/shader_program.hpp>
@@ -23,11 +25,15 @@ using namespace crash::space;
 using namespace crash::window;
 
 Driver::Driver(const Driver& driver) :
-   _boundingPartition(driver._boundingPartition),
+   _spatialIndex(driver._spatialIndex),
     _camera(driver._camera),
     _lightManager(driver._lightManager),
     _window(driver._window),
+    _occlusionBuffer(driver._occlusionBuffer),
+    _occluders(driver._occluders),
     _collisionCallbacks(),
+    _collisionEventCallbacks(),
+    _pairCache(),
     _updateCallbacks(),
     _shouldLoop(true),
     _renderBoundingGroups(false),
@@ -38,14 +44,18 @@ Driver::Driver(const Driver& driver) :
     _rendersPerSecond(0.0f)
 {}
 
-Driver::Driver(BoundingPartition* boundingPartition,
+Driver::Driver(SpatialIndex* spatialIndex,
  Camera* camera, LightManager* lightManager,
  Window* window) :
-   _boundingPartition(boundingPartition),
+   _spatialIndex(spatialIndex),
     _camera(camera),
     _lightManager(lightManager),
     _window(window),
+    _occlusionBuffer(nullptr),
+    _occluders(),
     _collisionCallbacks(),
+    _collisionEventCallbacks(),
+    _pairCache(),
     _updateCallbacks(),
     _shouldLoop(true),
     _renderBoundingGroups(false),
@@ -62,12 +72,26 @@ Driver::Driver(BoundingPartition* boundingPartition,
 // Data access.
 ////////////////////////////////////////////////////////////////////////////////
 
+SpatialIndex* Driver::getSpatialIndex() const {
+   return this->_spatialIndex;
+}
+
+void Driver::setSpatialIndex(SpatialIndex* spatialIndex) {
+   this->_spatialIndex = spatialIndex;
+}
+
+bool Driver::remove(Boundable* boundable) {
+   this->_pairCache.remove(boundable);
+   this->_occluders.erase(boundable);
+   return this->_spatialIndex->remove(boundable);
+}
+
 BoundingPartition* Driver::getBoundingPartition() const {
-   return this->_boundingPartition;
+   return dynamic_cast< BoundingPartition* >(this->_spatialIndex);
 }
 
 void Driver::setBoundingPartition(BoundingPartition* boundingPartition) {
-   this->_boundingPartition = boundingPartition;
+   this->_spatialIndex = boundingPartition;
 }
 
 Camera* Driver::getCamera() const {
@@ -86,6 +110,31 @@ void Driver::setWindow(Window* window) {
    this->_window = window;
 }
 
+OcclusionBuffer* Driver::getOcclusionBuffer() const {
+   return this->_occlusionBuffer;
+}
+
+void Driver::setOcclusionBuffer(OcclusionBuffer* occlusionBuffer) {
+   this->_occlusionBuffer = occlusionBuffer;
+}
+
+const std::map< Boundable*, const OccluderMesh* >&
+ Driver::getOccluders() const {
+   return this->_occluders;
+}
+
+void Driver::addOccluder(Boundable* boundable, const OccluderMesh* mesh) {
+   this->_occluders[boundable] = mesh;
+}
+
+void Driver::removeOccluder(Boundable* boundable) {
+   this->_occluders.erase(boundable);
+}
+
+void Driver::clearOccluders() {
+   this->_occluders.clear();
+}
+
 const std::set< Driver::CollisionCallback >&
  Driver::getCollisionCallbacks() const {
    return this->_collisionCallbacks;
@@ -103,6 +152,27 @@ void Driver::clearCollisionCallbacks() {
    this->_collisionCallbacks.clear();
 }
 
+const std::set< Driver::CollisionEventCallback >&
+ Driver::getCollisionEventCallbacks() const {
+   return this->_collisionEventCallbacks;
+}
+
+void Driver::addCollisionEventCallback(CollisionEventCallback callback) {
+   this->_collisionEventCallbacks.insert(callback);
+}
+
+void Driver::removeCollisionEventCallback(CollisionEventCallback callback) {
+   this->_collisionEventCallbacks.erase(callback);
+   if (this->_collisionEventCallbacks.empty()) {
+      this->_pairCache.clear();
+   }
+}
+
+void Driver::clearCollisionEventCallbacks() {
+   this->_collisionEventCallbacks.clear();
+   this->_pairCache.clear();
+}
+
 const std::set< Driver::UpdateCallback >& Driver::getUpdateCallbacks() const {
    return this->_updateCallbacks;
 }
@@ -218,26 +288,54 @@ float Driver::getRendersPerSecond() const {
 void Driver::update(float delta_t) {
    glfwPollEvents();
 
-   if (this->_collisionCallbacks.size() > 0) {
-      std::vector< Collision > collidingBoundables =
-       this->_boundingPartition->getCollidingElements();
-      for (const Collision& collision : collidingBoundables) {
+   // Only a BoundingPartition places Boundables by their swept extents, so
+   // its candidates are the only ones worth sweeping.
+   BoundingPartition* boundingPartition = this->getBoundingPartition();
+   float sweepInterval = 0.0f;
+   if (boundingPartition != nullptr) {
+      sweepInterval = boundingPartition->getSweepInterval();
+   }
+
+   if (this->_collisionEventCallbacks.size() > 0) {
+      this->_pairCache.update(this->_spatialIndex->getCandidateElements(),
+       sweepInterval);
+
+      this->dispatchCollisionEvents(this->_pairCache.getBegun(),
+       PairCache::COLLISION_BEGIN);
+      this->dispatchCollisionEvents(this->_pairCache.getStaying(),
+       PairCache::COLLISION_STAY);
+      this->dispatchCollisionEvents(this->_pairCache.getEnded(),
+       PairCache::COLLISION_END);
+   } else if (this->_collisionCallbacks.size() > 0) {
+      this->_spatialIndex->forEachPair([this](const Collision& collision) {
          for (const CollisionCallback& callback : this->_collisionCallbacks) {
             callback(collision);
          }
-      }
+      });
    }
 
    std::vector< Boundable* > boundables =
-    this->_boundingPartition->getBoundables();
+    this->_spatialIndex->getBoundables();
 
    for (Boundable* boundable : boundables) {
       for (const UpdateCallback& callback : this->_updateCallbacks) {
          callback(boundable);
       }
 
+      // Boundables at rest since the last update, such as static scenery,
+      // are already up to date in the spatial index.
+      bool isMoving = boundable->isMoving();
+      if (!isMoving && boundable->isSleeping()) {
+         continue;
+      }
+
       boundable->move(delta_t);
-      this->_boundingPartition->update(boundable);
+      this->_spatialIndex->update(boundable);
+      boundable->setSleeping(!isMoving);
+   }
+
+   if (boundingPartition != nullptr) {
+      boundingPartition->rebalance();
    }
 
    for (Boundable* boundable : boundables) {
@@ -251,72 +349,65 @@ void Driver::update(float delta_t) {
    }
 }
 
-void Driver::render(float delta_t) const {
-   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-   std::vector< Boundable* > visibleBoundables =
-    this->_boundingPartition->getBoundables();
-    /* this->_boundingPartition->getVisibleElements( */
-    /* this->_camera->getViewFrustum()); */
-   for (Boundable* boundable : visibleBoundables) {
-      Renderable* renderable = dynamic_cast< Renderable* >(boundable);
-      if (renderable == nullptr) {
-         continue;
+void Driver::dispatchCollisionEvents(const std::vector< Collision >& pairs,
+ PairCache::CollisionEvent event) {
+   for (const Collision& collision : pairs) {
+      // Boundables are woken when they begin colliding, so that a response
+      // to the collision is picked up by the spatial index. Pairs that stay
+      // in contact, such as an Actor resting on the ground, are left asleep.
+      if (event == PairCache::COLLISION_BEGIN) {
+         collision.getFirst()->setSleeping(false);
+         collision.getSecond()->setSleeping(false);
       }
 
-      for (const RenderCallback& callback : this->_renderCallbacks) {
-         callback(renderable);
+      for (const CollisionEventCallback& callback :
+       this->_collisionEventCallbacks) {
+         callback(collision, event);
       }
 
-      ShaderProgramPtr program =
-       renderable->getMeshInstance()->getShaderProgram();
-      const UniformVariable& uniforms = program->getVariableNames();
-
-      program->use();
-
-      glm::mat4 perspective = this->_camera->getPerspective();
-      program->setUniformVariableMatrix4(uniforms.perspective_transform,
-       glm::value_ptr(perspective), 1);
-
-      glm::mat4 view = this->_camera->getLookAt();
-      program->setUniformVariableMatrix4(uniforms.view_transform,
-       glm::value_ptr(view), 1);
-
-      glm::vec3 position = this->_camera->getPosition();
-      program->setUniformVariable3f(uniforms.camera_position,
-       glm::value_ptr(position), 1);
-
-      this->_lightManager->setUniforms(*program);
-
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-      /* glEnable(GL_CULL_FACE); */
-      glDisable(GL_CULL_FACE);
+      // Plain collision callbacks hear about every colliding pair, which the
+      // PairCache has already found.
+      if (event != PairCache::COLLISION_END) {
+         for (const CollisionCallback& callback : this->_collisionCallbacks) {
+            callback(collision);
+         }
+      }
+   }
+}
 
-      renderable->render(delta_t);
+void Driver::render(float delta_t) const {
+   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-      if (Driver::BoundingCubeMeshInstance != nullptr &&
-       this->getRenderBoundingBoxes()) {
-         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-         glDisable(GL_CULL_FACE);
+   if (this->_occlusionBuffer != nullptr) {
+      this->rasterizeOccluders();
+   }
 
-         glm::mat4 transform = boundable->getBoundingBox()->getTransform();
-         Driver::BoundingCubeMeshInstance->render(transform, delta_t);
+   // Only Boundables inside the view frustum are tested against the
+   // occluders.
+   this->_spatialIndex->forEachVisible(this->_camera->getViewFrustum(),
+    [this, delta_t](Boundable* boundable) {
+      if (!this->isOccluded(boundable)) {
+         this->renderBoundable(boundable, delta_t);
       }
-   }
+   });
 
-   if (Driver::BoundingCubeMeshInstance != nullptr) {
+   // Only a BoundingPartition has a volume and groups to draw.
+   BoundingPartition* boundingPartition = this->getBoundingPartition();
+   if (Driver::BoundingCubeMeshInstance != nullptr &&
+    boundingPartition != nullptr) {
       glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
       glDisable(GL_CULL_FACE);
 
       if (this->_renderBoundingPartition) {
-         glm::mat4 transform = this->_boundingPartition->getTransform();
+         glm::mat4 transform = boundingPartition->getTransform();
          Driver::BoundingCubeMeshInstance->render(transform, delta_t);
       }
 
       if (this->getRenderBoundingGroups()) {
-         const auto groups = this->_boundingPartition->getBoundingGroups();
-         for (const BoundingGroup& group : groups) {
-            glm::mat4 transform = group.getTransform();
+         unsigned int numGroups = boundingPartition->getNumBoundingGroups();
+         for (unsigned int ndx = 0; ndx < numGroups; ++ndx) {
+            glm::mat4 transform =
+             boundingPartition->getBoundingGroup(ndx).getTransform();
             Driver::BoundingCubeMeshInstance->render(transform, delta_t);
          }
       }
@@ -325,6 +416,75 @@ void Driver::render(float delta_t) const {
    this->_window->swapBuffers();
 }
 
+void Driver::renderBoundable(Boundable* boundable, float delta_t) const {
+   Renderable* renderable = dynamic_cast< Renderable* >(boundable);
+   if (renderable == nullptr) {
+      return;
+   }
+
+   for (const RenderCallback& callback : this->_renderCallbacks) {
+      callback(renderable);
+   }
+
+   ShaderProgramPtr program =
+    renderable->getMeshInstance()->getShaderProgram();
+   const UniformVariable& uniforms = program->getVariableNames();
+
+   program->use();
+
+   glm::mat4 perspective = this->_camera->getPerspective();
+   program->setUniformVariableMatrix4(uniforms.perspective_transform,
+    glm::value_ptr(perspective), 1);
+
+   glm::mat4 view = this->_camera->getLookAt();
+   program->setUniformVariableMatrix4(uniforms.view_transform,
+    glm::value_ptr(view), 1);
+
+   glm::vec3 position = this->_camera->getPosition();
+   program->setUniformVariable3f(uniforms.camera_position,
+    glm::value_ptr(position), 1);
+
+   this->_lightManager->setUniforms(*program);
+
+   glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+   /* glEnable(GL_CULL_FACE); */
+   glDisable(GL_CULL_FACE);
+
+   renderable->render(delta_t);
+
+   if (Driver::BoundingCubeMeshInstance != nullptr &&
+    this->getRenderBoundingBoxes()) {
+      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+      glDisable(GL_CULL_FACE);
+
+      glm::mat4 transform = boundable->getBoundingBox()->getTransform();
+      Driver::BoundingCubeMeshInstance->render(transform, delta_t);
+   }
+}
+
+void Driver::rasterizeOccluders() const {
+   this->_occlusionBuffer->clear(this->_camera->getPerspective() *
+    this->_camera->getLookAt());
+
+   for (const auto& occluder : this->_occluders) {
+      this->_occlusionBuffer->rasterize(*occluder.second,
+       occluder.first->getTransform());
+   }
+
+   this->_occlusionBuffer->buildHierarchy();
+}
+
+bool Driver::isOccluded(Boundable* boundable) const {
+   // Occluders are always drawn, since they stand in front of what they hide.
+   if (this->_occlusionBuffer == nullptr ||
+    this->_occluders.find(boundable) != this->_occluders.end()) {
+      return false;
+   }
+
+   return this->_occlusionBuffer->isOccluded(
+    boundable->getBoundingBox()->getCorners());
+}
+
 float Driver::getUpdateTimerElapsed() const {
    return this->getTimerElapsed(this->_updateTimer);
 }
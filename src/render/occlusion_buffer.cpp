@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <crash/common/simd.hpp>
+#include <crash/render/occlusion_buffer.hpp>
+
+using namespace crash::render;
+
+////////////////////////////////////////////////////////////////////////////////
+// OccluderMesh.
+////////////////////////////////////////////////////////////////////////////////
+
+/* static */ OccluderMesh OccluderMesh::unitCube() {
+   OccluderMesh mesh;
+   mesh.vertices = {
+      glm::vec3(-0.5f, -0.5f, -0.5f), // 0:nbl
+      glm::vec3( 0.5f, -0.5f, -0.5f), // 1:nbr
+      glm::vec3(-0.5f,  0.5f, -0.5f), // 2:ntl
+      glm::vec3( 0.5f,  0.5f, -0.5f), // 3:ntr
+      glm::vec3(-0.5f, -0.5f,  0.5f), // 4:fbl
+      glm::vec3( 0.5f, -0.5f,  0.5f), // 5:fbr
+      glm::vec3(-0.5f,  0.5f,  0.5f), // 6:ftl
+      glm::vec3( 0.5f,  0.5f,  0.5f), // 7:ftr
+   };
+   mesh.indices = {
+      0, 1, 3,  0, 3, 2, // near
+      4, 6, 7,  4, 7, 5, // far
+      0, 2, 6,  0, 6, 4, // left
+      1, 5, 7,  1, 7, 3, // right
+      0, 4, 5,  0, 5, 1, // bottom
+      2, 3, 7,  2, 7, 6, // top
+   };
+   return mesh;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+OcclusionBuffer::OcclusionBuffer(const OcclusionBuffer& occlusionBuffer) :
+   _width(occlusionBuffer._width),
+    _height(occlusionBuffer._height),
+    _stride(occlusionBuffer._stride),
+    _viewProjection(occlusionBuffer._viewProjection),
+    _depths(occlusionBuffer._depths),
+    _levels(occlusionBuffer._levels),
+    _screenVertices(),
+    _clipped()
+{}
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height) :
+   _width(std::max(width, 1u)), _height(std::max(height, 1u)), _stride(0),
+    _viewProjection(), _depths(), _levels(), _screenVertices(), _clipped()
+{
+   using namespace crash::common::simd;
+
+   unsigned int numVectors = (this->_width + Float::WIDTH - 1) / Float::WIDTH;
+   this->_stride = numVectors * Float::WIDTH;
+   this->_depths.assign(this->_stride * this->_height,
+    OcclusionBuffer::FAR_DEPTH);
+
+   // Each level halves the one before it, rounding up, until a single texel
+   // covers the buffer.
+   unsigned int levelWidth = this->_width;
+   unsigned int levelHeight = this->_height;
+   while (true) {
+      Level level;
+      level.width = levelWidth;
+      level.height = levelHeight;
+      level.minimum.assign(levelWidth * levelHeight,
+       OcclusionBuffer::FAR_DEPTH);
+      level.maximum.assign(levelWidth * levelHeight,
+       OcclusionBuffer::FAR_DEPTH);
+      this->_levels.push_back(level);
+
+      if (levelWidth == 1 && levelHeight == 1) {
+         break;
+      }
+      levelWidth = (levelWidth + 1) / 2;
+      levelHeight = (levelHeight + 1) / 2;
+   }
+}
+
+/* virtual */ OcclusionBuffer::~OcclusionBuffer() {}
+
+////////////////////////////////////////////////////////////////////////////////
+// Rasterization.
+////////////////////////////////////////////////////////////////////////////////
+
+void OcclusionBuffer::clear(const glm::mat4& viewProjection) {
+   this->_viewProjection = viewProjection;
+   std::fill(this->_depths.begin(), this->_depths.end(),
+    OcclusionBuffer::FAR_DEPTH);
+}
+
+void OcclusionBuffer::rasterize(const OccluderMesh& mesh,
+ const glm::mat4& transform) {
+   glm::mat4 modelViewProjection = this->_viewProjection * transform;
+   glm::vec2 screenSize((float)this->_width, (float)this->_height);
+
+   // Every vertex is projected once, however many triangles share it.
+   unsigned int numVertices = mesh.vertices.size();
+   this->_screenVertices.resize(numVertices);
+   this->_clipped.resize(numVertices);
+   for (unsigned int ndx = 0; ndx < numVertices; ++ndx) {
+      glm::vec4 clip = modelViewProjection *
+       glm::vec4(mesh.vertices[ndx], 1.0f);
+      this->_clipped[ndx] = clip.w <= 0.0f || clip.z < -clip.w;
+      if (this->_clipped[ndx]) {
+         continue;
+      }
+
+      glm::vec3 ndc = glm::vec3(clip) / clip.w;
+      this->_screenVertices[ndx] = glm::vec3(
+       (ndc.x * 0.5f + 0.5f) * screenSize.x,
+       (ndc.y * 0.5f + 0.5f) * screenSize.y,
+       ndc.z * 0.5f + 0.5f);
+   }
+
+   for (unsigned int ndx = 0; ndx + 2 < mesh.indices.size(); ndx += 3) {
+      unsigned int a = mesh.indices[ndx];
+      unsigned int b = mesh.indices[ndx + 1];
+      unsigned int c = mesh.indices[ndx + 2];
+      if (this->_clipped[a] || this->_clipped[b] || this->_clipped[c]) {
+         continue;
+      }
+
+      this->rasterizeTriangle(this->_screenVertices[a],
+       this->_screenVertices[b], this->_screenVertices[c]);
+   }
+}
+
+void OcclusionBuffer::buildHierarchy() {
+   Level& first = this->_levels[0];
+   for (unsigned int y = 0; y < this->_height; ++y) {
+      const float* row = this->_depths.data() + y * this->_stride;
+      std::copy(row, row + this->_width,
+       first.minimum.begin() + y * this->_width);
+      std::copy(row, row + this->_width,
+       first.maximum.begin() + y * this->_width);
+   }
+
+   for (unsigned int ndx = 1; ndx < this->_levels.size(); ++ndx) {
+      const Level& finer = this->_levels[ndx - 1];
+      Level& level = this->_levels[ndx];
+
+      for (unsigned int y = 0; y < level.height; ++y) {
+         unsigned int y0 = y * 2;
+         unsigned int y1 = std::min(y0 + 1, finer.height - 1);
+
+         for (unsigned int x = 0; x < level.width; ++x) {
+            unsigned int x0 = x * 2;
+            unsigned int x1 = std::min(x0 + 1, finer.width - 1);
+
+            unsigned int a = y0 * finer.width + x0;
+            unsigned int b = y0 * finer.width + x1;
+            unsigned int c = y1 * finer.width + x0;
+            unsigned int d = y1 * finer.width + x1;
+
+            unsigned int texel = y * level.width + x;
+            level.minimum[texel] = std::min(
+             std::min(finer.minimum[a], finer.minimum[b]),
+             std::min(finer.minimum[c], finer.minimum[d]));
+            level.maximum[texel] = std::max(
+             std::max(finer.maximum[a], finer.maximum[b]),
+             std::max(finer.maximum[c], finer.maximum[d]));
+         }
+      }
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Queries.
+////////////////////////////////////////////////////////////////////////////////
+
+bool OcclusionBuffer::isOccluded(const Corners& corners) const {
+   glm::vec2 minimum(std::numeric_limits< float >::max());
+   glm::vec2 maximum(-std::numeric_limits< float >::max());
+   float depth = OcclusionBuffer::FAR_DEPTH;
+
+   for (const glm::vec3& corner : corners) {
+      glm::vec4 clip = this->_viewProjection * glm::vec4(corner, 1.0f);
+      if (clip.w <= 0.0f || clip.z < -clip.w) {
+         return false;
+      }
+
+      glm::vec3 ndc = glm::vec3(clip) / clip.w;
+      minimum.x = std::min(minimum.x, ndc.x);
+      minimum.y = std::min(minimum.y, ndc.y);
+      maximum.x = std::max(maximum.x, ndc.x);
+      maximum.y = std::max(maximum.y, ndc.y);
+      depth = std::min(depth, ndc.z * 0.5f + 0.5f);
+   }
+
+   // Boxes off the screen are left to frustum culling.
+   if (maximum.x < -1.0f || minimum.x > 1.0f ||
+    maximum.y < -1.0f || minimum.y > 1.0f) {
+      return false;
+   }
+
+   PixelRect rect;
+   rect.minX = (int)((std::max(minimum.x, -1.0f) * 0.5f + 0.5f) * this->_width);
+   rect.minY = (int)((std::max(minimum.y, -1.0f) * 0.5f + 0.5f) *
+    this->_height);
+   rect.maxX = std::min((int)((std::min(maximum.x, 1.0f) * 0.5f + 0.5f) *
+    this->_width), (int)this->_width - 1);
+   rect.maxY = std::min((int)((std::min(maximum.y, 1.0f) * 0.5f + 0.5f) *
+    this->_height), (int)this->_height - 1);
+
+   // Start from the finest level at which the rect spans at most two texels
+   // along each axis.
+   unsigned int level = 0;
+   while ((rect.maxX >> level) - (rect.minX >> level) > 1 ||
+    (rect.maxY >> level) - (rect.minY >> level) > 1) {
+      ++level;
+   }
+
+   for (int y = rect.minY >> level; y <= rect.maxY >> level; ++y) {
+      for (int x = rect.minX >> level; x <= rect.maxX >> level; ++x) {
+         if (!this->isOccluded(level, x, y, rect, depth)) {
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data access.
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int OcclusionBuffer::getWidth() const {
+   return this->_width;
+}
+
+unsigned int OcclusionBuffer::getHeight() const {
+   return this->_height;
+}
+
+float OcclusionBuffer::getDepth(unsigned int x, unsigned int y) const {
+   return this->_depths[y * this->_stride + x];
+}
+
+unsigned int OcclusionBuffer::getNumLevels() const {
+   return this->_levels.size();
+}
+
+glm::ivec2 OcclusionBuffer::getLevelSize(unsigned int level) const {
+   return glm::ivec2(this->_levels[level].width, this->_levels[level].height);
+}
+
+float OcclusionBuffer::getMinDepth(unsigned int level, unsigned int x,
+ unsigned int y) const {
+   const Level& texels = this->_levels[level];
+   return texels.minimum[y * texels.width + x];
+}
+
+float OcclusionBuffer::getMaxDepth(unsigned int level, unsigned int x,
+ unsigned int y) const {
+   const Level& texels = this->_levels[level];
+   return texels.maximum[y * texels.width + x];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers.
+////////////////////////////////////////////////////////////////////////////////
+
+void OcclusionBuffer::rasterizeTriangle(const glm::vec3& a,
+ const glm::vec3& b, const glm::vec3& c) {
+   using namespace crash::common::simd;
+
+   static const float laneOffsets[8] = {
+      0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f
+   };
+
+   // Each edge function is positive on the inside of its edge once the
+   // triangle is wound counter-clockwise. Occluders are double-sided, so
+   // clockwise triangles are flipped rather than dropped.
+   float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+   if (area == 0.0f) {
+      return;
+   }
+
+   const glm::vec3& p0 = a;
+   const glm::vec3& p1 = area > 0.0f ? b : c;
+   const glm::vec3& p2 = area > 0.0f ? c : b;
+   area = std::abs(area);
+
+   float lowX = std::min(p0.x, std::min(p1.x, p2.x));
+   float lowY = std::min(p0.y, std::min(p1.y, p2.y));
+   float highX = std::max(p0.x, std::max(p1.x, p2.x));
+   float highY = std::max(p0.y, std::max(p1.y, p2.y));
+   if (highX < 0.0f || highY < 0.0f ||
+    lowX > (float)this->_width || lowY > (float)this->_height) {
+      return;
+   }
+
+   // The bounds are clamped before conversion, since vertices close to the
+   // plane of the camera project far off the screen.
+   int minX = (int)std::max(lowX, 0.0f);
+   int minY = (int)std::max(lowY, 0.0f);
+   int maxX = (int)std::min(highX, (float)this->_width - 1.0f);
+   int maxY = (int)std::min(highY, (float)this->_height - 1.0f);
+
+   // Edge function i is opposite vertex i: e(x, y) = A * x + B * y + C.
+   glm::vec3 edgeA(p1.y - p2.y, p2.y - p0.y, p0.y - p1.y);
+   glm::vec3 edgeB(p2.x - p1.x, p0.x - p2.x, p1.x - p0.x);
+   glm::vec3 edgeC(
+    p1.x * p2.y - p2.x * p1.y,
+    p2.x * p0.y - p0.x * p2.y,
+    p0.x * p1.y - p1.x * p0.y);
+
+   // Depth is interpolated by the normalized edge functions, which are the
+   // barycentric weights of the vertices.
+   glm::vec3 depths(p0.z, p1.z, p2.z);
+   float depthA = glm::dot(edgeA, depths) / area;
+   float depthB = glm::dot(edgeB, depths) / area;
+   float depthC = glm::dot(edgeC, depths) / area;
+
+   Float zero = broadcast(0.0f);
+   Float a0 = broadcast(edgeA.x);
+   Float a1 = broadcast(edgeA.y);
+   Float a2 = broadcast(edgeA.z);
+   Float aDepth = broadcast(depthA);
+
+   // Rows are walked in whole vectors from an aligned start, which stays
+   // within the padded stride. Pixels outside the bounds of the triangle
+   // fail the edge tests.
+   int startX = minX - minX % (int)Float::WIDTH;
+
+   for (int y = minY; y <= maxY; ++y) {
+      float centerY = y + 0.5f;
+      float row0 = edgeB.x * centerY + edgeC.x;
+      float row1 = edgeB.y * centerY + edgeC.y;
+      float row2 = edgeB.z * centerY + edgeC.z;
+      float rowDepth = depthB * centerY + depthC;
+      float* depthRow = this->_depths.data() + y * this->_stride;
+
+      for (int x = startX; x <= maxX; x += Float::WIDTH) {
+         Float centerX = broadcast((float)x) + load(laneOffsets);
+
+         Float outside = lessThan(a0 * centerX + broadcast(row0), zero) |
+          lessThan(a1 * centerX + broadcast(row1), zero) |
+          lessThan(a2 * centerX + broadcast(row2), zero);
+         if (bits(outside) == (1u << Float::WIDTH) - 1) {
+            continue;
+         }
+
+         Float depth = aDepth * centerX + broadcast(rowDepth);
+         Float current = load(depthRow + x);
+         store(depthRow + x, select(outside, current, min(current, depth)));
+      }
+   }
+}
+
+bool OcclusionBuffer::isOccluded(unsigned int level, unsigned int x,
+ unsigned int y, const PixelRect& rect, float depth) const {
+   const Level& texels = this->_levels[level];
+   unsigned int texel = y * texels.width + x;
+   if (texels.maximum[texel] < depth) {
+      return true;
+   }
+
+   // No finer texel can be farther forward than the nearest depth here.
+   if (texels.minimum[texel] >= depth || level == 0) {
+      return false;
+   }
+
+   const Level& finer = this->_levels[level - 1];
+   unsigned int shift = level - 1;
+   for (unsigned int childY = y * 2; childY <= y * 2 + 1; ++childY) {
+      if (childY >= finer.height || (int)childY < (rect.minY >> shift) ||
+       (int)childY > (rect.maxY >> shift)) {
+         continue;
+      }
+
+      for (unsigned int childX = x * 2; childX <= x * 2 + 1; ++childX) {
+         if (childX >= finer.width || (int)childX < (rect.minX >> shift) ||
+          (int)childX > (rect.maxX >> shift)) {
+            continue;
+         }
+
+         if (!this->isOccluded(level - 1, childX, childY, rect, depth)) {
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+/* static */ const float OcclusionBuffer::FAR_DEPTH = 1.0f;
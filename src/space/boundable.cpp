@@ -4,10 +4,80 @@
 using namespace crash::render;
 using namespace crash::space;
 
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+Boundable::Boundable(const Boundable& boundable) :
+   _collisionLayers(boundable._collisionLayers),
+    _collisionMask(boundable._collisionMask),
+    _isStatic(boundable._isStatic),
+    _isSleeping(boundable._isSleeping)
+{}
+
+Boundable::Boundable() :
+   _collisionLayers(DEFAULT_LAYER), _collisionMask(ALL_LAYERS),
+    _isStatic(false), _isSleeping(false)
+{}
+
+////////////////////////////////////////////////////////////////////////////////
+// Intersection.
+////////////////////////////////////////////////////////////////////////////////
+
 /* virtual */ bool Boundable::isVisible(const ViewFrustum& viewFrustum) {
    return this->getBoundingBox()->isVisible(viewFrustum);
 }
 
+/* virtual */ bool Boundable::isVisible(const ViewFrustum& viewFrustum,
+ unsigned int planeMask) {
+   return this->getBoundingBox()->isVisible(viewFrustum, planeMask);
+}
+
 /* virtual */ bool Boundable::isIntersecting(Boundable* boundable) {
    return this->getBoundingBox()->isIntersecting(boundable);
 }
+
+bool Boundable::isCollidable(const Boundable* other) const {
+   return (this->_collisionLayers & other->_collisionMask) != 0 &&
+    (other->_collisionLayers & this->_collisionMask) != 0 &&
+    !(this->_isStatic && other->_isStatic);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Collision filtering.
+////////////////////////////////////////////////////////////////////////////////
+
+void Boundable::setCollisionLayers(unsigned int layers) {
+   this->_collisionLayers = layers;
+}
+
+unsigned int Boundable::getCollisionLayers() const {
+   return this->_collisionLayers;
+}
+
+void Boundable::setCollisionMask(unsigned int mask) {
+   this->_collisionMask = mask;
+}
+
+unsigned int Boundable::getCollisionMask() const {
+   return this->_collisionMask;
+}
+
+void Boundable::setStatic(bool isStatic) {
+   this->_isStatic = isStatic;
+}
+
+bool Boundable::isStatic() const {
+   return this->_isStatic;
+}
+
+void Boundable::setSleeping(bool isSleeping) {
+   this->_isSleeping = isSleeping;
+}
+
+bool Boundable::isSleeping() const {
+   return this->_isSleeping;
+}
+
+/* static */ const unsigned int Boundable::DEFAULT_LAYER = 1;
+/* static */ const unsigned int Boundable::ALL_LAYERS = ~0u;
@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <limits>
+#include <glm/gtc/quaternion.hpp>
 #include <crash/common/plane.hpp>
 #include <crash/common/arithmetic.hpp>
+#include <crash/common/symbols.hpp>
 #include <crash/space/bounding_box.hpp>
+#include <crash/space/intersection_statistics.hpp>
 #include <crash/space/util.hpp>
 #include <crash/render/view_frustum.hpp>
 
@@ -13,17 +18,18 @@ using namespace crash::render;
 ////////////////////////////////////////////////////////////////////////////////
 
 BoundingBox::BoundingBox(const BoundingBox& boundingBox) :
-   _transformer(boundingBox._transformer),
+   Boundable(boundingBox),
+    _transformer(boundingBox._transformer),
     _radius(boost::none), _corners(boost::none),
     _faceNormals(boost::none), _diagonalDirections(boost::none),
-    _frustumPlaneIndex(0)
+    _extents(boost::none), _frustumPlaneIndex(0)
 {}
 
 BoundingBox::BoundingBox(const Transformer& transformer) :
    _transformer(transformer),
     _radius(boost::none), _corners(boost::none),
     _faceNormals(boost::none), _diagonalDirections(boost::none),
-    _frustumPlaneIndex(0)
+    _extents(boost::none), _frustumPlaneIndex(0)
 {}
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -57,16 +63,19 @@ glm::vec3 BoundingBox::getScaleVelocity() const {
 void BoundingBox::setPosition(const glm::vec3& position) {
    this->_transformer.setPosition(position);
    this->invalidate();
+   this->setSleeping(false);
 }
 
 void BoundingBox::setOrientation(const glm::quat& orientation) {
    this->_transformer.setOrientation(orientation);
    this->invalidate();
+   this->setSleeping(false);
 }
 
 void BoundingBox::setSize(const glm::vec3& size) {
    this->_transformer.setSize(size);
    this->invalidate();
+   this->setSleeping(false);
 }
 
 void BoundingBox::setTranslationalVelocity(
@@ -94,15 +103,28 @@ BoundingBox* BoundingBox::getBoundingBox() {
 }
 
 bool BoundingBox::isVisible(const ViewFrustum& viewFrustum) {
+   return this->isVisible(viewFrustum, ViewFrustum::ALL_PLANES);
+}
+
+bool BoundingBox::isVisible(const ViewFrustum& viewFrustum,
+ unsigned int planeMask) {
+   if (planeMask == 0) {
+      return true;
+   }
+
    auto corners = this->getCorners();
    auto diagonals = this->getDiagonalDirections();
-   auto frustumPlanes = viewFrustum.getPlanes();
+   const ViewFrustum::Planes& frustumPlanes = viewFrustum.getPlanes();
 
    for (unsigned int planeCount = 0; planeCount < ViewFrustum::NUM_PLANES;
     ++planeCount) {
       // Utilize temporal locality by starting at the last failing plane.
       unsigned int planeNdx = (this->_frustumPlaneIndex + planeCount) %
        ViewFrustum::NUM_PLANES;
+      if (!(planeMask & (1 << planeNdx))) {
+         continue;
+      }
+
       const Plane& plane = frustumPlanes[planeNdx];
 
       // Find the diagonal that is most orthogonal to the plane.
@@ -136,9 +158,126 @@ bool BoundingBox::isVisible(const ViewFrustum& viewFrustum) {
 }
 
 bool BoundingBox::isIntersecting(Boundable* boundable) {
+   int separatingAxis = NO_AXIS;
+   return this->isIntersecting(boundable, separatingAxis);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Spatial queries.
+////////////////////////////////////////////////////////////////////////////////
+
+boost::optional< float > BoundingBox::intersectRay(const Line& ray) {
+   glm::vec3 halfExtents = this->getSize() * 0.5f;
+   glm::mat4 rotation = glm::mat4_cast(this->getOrientation());
+   glm::vec3 offset = ray.point - this->getPosition();
+
+   // Clip the ray against each pair of parallel faces (slabs) in the local
+   // frame of this BoundingBox.
+   float entry = 0.0f;
+   float exit = std::numeric_limits< float >::max();
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      glm::vec3 direction = glm::vec3(rotation[axis]);
+      float origin = glm::dot(offset, direction);
+      float slope = glm::dot(ray.direction, direction);
+
+      if (std::abs(slope) < std::numeric_limits< float >::epsilon()) {
+         if (std::abs(origin) > halfExtents[axis]) {
+            return boost::none;
+         }
+         continue;
+      }
+
+      float near = (-halfExtents[axis] - origin) / slope;
+      float far = (halfExtents[axis] - origin) / slope;
+      if (near > far) {
+         std::swap(near, far);
+      }
+
+      entry = std::max(entry, near);
+      exit = std::min(exit, far);
+      if (entry > exit) {
+         return boost::none;
+      }
+   }
+
+   return entry;
+}
+
+bool BoundingBox::isIntersecting(Boundable* boundable, int& separatingAxis) {
    BoundingBox* boundingBox = boundable->getBoundingBox();
-   return this->intersectAsSpheres(*boundingBox) &&
-    this->intersectAsBoxes(*boundingBox);
+   if (!this->intersectAsSpheres(*boundingBox)) {
+      if (IntersectionStatistics::isCollecting()) {
+         IntersectionStatistics::collect(true, NO_AXIS);
+      }
+      return false;
+   }
+
+   bool intersecting = this->intersectAsBoxes(*boundingBox, separatingAxis);
+   if (IntersectionStatistics::isCollecting()) {
+      IntersectionStatistics::collect(false, separatingAxis);
+   }
+   return intersecting;
+}
+
+float BoundingBox::getDistance(const glm::vec3& point) {
+   glm::vec3 halfExtents = this->getSize() * 0.5f;
+   glm::mat4 rotation = glm::mat4_cast(this->getOrientation());
+   glm::vec3 offset = point - this->getPosition();
+
+   // Measure how far the point lies beyond each pair of parallel faces in the
+   // local frame of this BoundingBox.
+   glm::vec3 outside;
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      float projection = glm::dot(offset, glm::vec3(rotation[axis]));
+      outside[axis] = std::max(std::abs(projection) - halfExtents[axis], 0.0f);
+   }
+
+   return glm::length(outside);
+}
+
+boost::optional< float > BoundingBox::getTimeOfImpact(
+ const BoundingBox& boundingBox, float delta_t) const {
+   // Boxes rebuilt from the transforms alone share no memoized state with the
+   // boxes they stand in for.
+   BoundingBox aStart(this->_transformer);
+   BoundingBox bStart(boundingBox._transformer);
+   if (aStart.isIntersecting(&bStart)) {
+      return 0.0f;
+   }
+
+   if (delta_t <= 0.0f || (!aStart.isMoving() && !bStart.isMoving())) {
+      return boost::none;
+   }
+
+   return aStart.findImpact(bStart, aStart, bStart, 0.0f, delta_t, 0);
+}
+
+BoundingBox::Extents BoundingBox::getSweptExtents(float delta_t) {
+   BoundingBox end = this->getMoved(delta_t);
+
+   Extents start;
+   Extents finish;
+   if (this->getRotationalVelocity() == NO_ROTATION) {
+      start = this->getExtents();
+      finish = end.getExtents();
+   } else {
+      // A rotating box may point any way during the interval, so bound it by
+      // its circumscribed sphere instead.
+      glm::vec3 startRadius(glm::length(this->getSize()) * 0.5f);
+      glm::vec3 endRadius(glm::length(end.getSize()) * 0.5f);
+      start = {{this->getPosition() - startRadius,
+       this->getPosition() + startRadius}};
+      finish = {{end.getPosition() - endRadius,
+       end.getPosition() + endRadius}};
+   }
+
+   return {{glm::min(start[0], finish[0]), glm::max(start[1], finish[1])}};
+}
+
+BoundingBox BoundingBox::getMoved(float delta_t) const {
+   BoundingBox moved(*this);
+   moved.move(delta_t);
+   return moved;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -163,6 +302,7 @@ void BoundingBox::invalidate() {
    this->_corners = boost::none;
    this->_faceNormals = boost::none;
    this->_diagonalDirections = boost::none;
+   this->_extents = boost::none;
 }
 
 float BoundingBox::getRadius() {
@@ -197,6 +337,14 @@ const BoundingBox::DiagonalDirections& BoundingBox::getDiagonalDirections() {
    return this->_diagonalDirections.get();
 }
 
+const BoundingBox::Extents& BoundingBox::getExtents() {
+   if (!this->_extents) {
+      this->generateExtents();
+   }
+
+   return this->_extents.get();
+}
+
 void BoundingBox::generateRadius() {
    this->_radius = std::sqrt(glm::dot(this->getSize(), this->getSize()));
 }
@@ -248,6 +396,18 @@ void BoundingBox::generateDiagonalDirections() {
    this->_diagonalDirections = diagonals;
 }
 
+void BoundingBox::generateExtents() {
+   auto corners = this->getCorners();
+
+   Extents extents {{ corners[0], corners[0] }};
+   for (unsigned int ndx = 1; ndx < NUM_CORNERS; ++ndx) {
+      extents[0] = glm::min(extents[0], corners[ndx]);
+      extents[1] = glm::max(extents[1], corners[ndx]);
+   }
+
+   this->_extents = extents;
+}
+
 bool BoundingBox::intersectAsSpheres(BoundingBox& boundingBox) {
    float minimumDistance = this->getRadius() + boundingBox.getRadius();
    glm::vec3 centerDistance = this->getPosition() - boundingBox.getPosition();
@@ -256,7 +416,8 @@ bool BoundingBox::intersectAsSpheres(BoundingBox& boundingBox) {
     glm::dot(centerDistance, centerDistance));
 }
 
-bool BoundingBox::intersectAsBoxes(BoundingBox& boundingBox) {
+bool BoundingBox::intersectAsBoxes(BoundingBox& boundingBox,
+ int& separatingAxis) {
    BoundingBox& a = *this;
    BoundingBox& b = boundingBox;
 
@@ -270,11 +431,11 @@ bool BoundingBox::intersectAsBoxes(BoundingBox& boundingBox) {
    auto aNormals = a.getFaceNormals();
    auto bNormals = b.getFaceNormals();
 
-   glm::vec3 normalDots;
+   glm::vec3 aDots;
+   glm::vec3 bDots;
    CoefficientMatrix coefMatrix;
    CoefficientMatrix absCoefMatrix;
 
-   // Assess face normals from this Boundable.
    // If a set of parallel axes exist we can avoid checking normal cross
    // products later on.
    for (int aNdx = 0; aNdx < 3; ++aNdx) {
@@ -291,61 +452,75 @@ bool BoundingBox::intersectAsBoxes(BoundingBox& boundingBox) {
          }
       }
 
-      float aDotD = glm::dot(aNormals[aNdx], centerDistance);
-      normalDots[aNdx] = aDotD;
-
-      float interval = std::abs(aDotD);
-      float aRadius = aSize[aNdx];
-      float bRadius = 0.0f;
-      for (int bNdx = 0; bNdx < 3; ++bNdx) {
-         int index = linearize_index(glm::ivec2(aNdx, bNdx), glm::ivec2(3, 3));
-
-         bRadius += bSize[bNdx] * absCoefMatrix[index];
-      }
-
-      if (approxGreaterThan(interval, aRadius + bRadius)) {
-         return parallelPairExists;
-      }
+      aDots[aNdx] = glm::dot(aNormals[aNdx], centerDistance);
+      bDots[aNdx] = glm::dot(bNormals[aNdx], centerDistance);
    }
 
-   // Assess face normals from other BoundingBox.
-   // We don't need to look for parallel axes anymore.
-   for (int bNdx = 0; bNdx < 3; ++bNdx) {
-      float interval = std::abs(glm::dot(bNormals[bNdx], centerDistance));
-      float aRadius = 0.0f;
-      for (int aNdx = 0; aNdx < 3; ++aNdx) {
-         int index = linearize_index(glm::ivec2(aNdx, bNdx), glm::ivec2(3, 3));
+   // Cross products of parallel normals are degenerate, and the face normals
+   // alone are sufficient.
+   int numAxes = parallelPairExists ? 6 : NUM_SEPARATING_AXES;
 
-         aRadius += aSize[aNdx] * absCoefMatrix[index];
-      }
-      float bRadius = bSize[bNdx];
+   // Try the axis that separated these boxes last time first.
+   int hint = separatingAxis;
+   if (hint != NO_AXIS && hint < numAxes &&
+    BoundingBox::isSeparatingAxis(hint, aSize, bSize, aDots, bDots,
+    coefMatrix, absCoefMatrix)) {
+      return false;
+   }
 
-      if (approxGreaterThan(interval, aRadius + bRadius)) {
-         return parallelPairExists;
+   for (int axis = 0; axis < numAxes; ++axis) {
+      if (axis != hint && BoundingBox::isSeparatingAxis(axis, aSize, bSize,
+       aDots, bDots, coefMatrix, absCoefMatrix)) {
+         separatingAxis = axis;
+         return false;
       }
    }
 
-   if (parallelPairExists) {
-      return true;
-   }
+   separatingAxis = NO_AXIS;
+   return true;
+}
 
-   // Assess axes generated from face normal cross products.
-   for (int aNdx = 0; aNdx < 3; ++aNdx) {
+/* static */ bool BoundingBox::isSeparatingAxis(int axis,
+ const glm::vec3& aSize, const glm::vec3& bSize, const glm::vec3& aDots,
+ const glm::vec3& bDots, const CoefficientMatrix& coefMatrix,
+ const CoefficientMatrix& absCoefMatrix) {
+   float interval;
+   float aRadius;
+   float bRadius;
+
+   if (axis < 3) {
+      // Face normal of this BoundingBox.
+      int aNdx = axis;
+      interval = std::abs(aDots[aNdx]);
+      aRadius = aSize[aNdx];
+      bRadius = 0.0f;
       for (int bNdx = 0; bNdx < 3; ++bNdx) {
-         float interval = BoundingBox::centerDifferenceProjection(
-          aNdx, bNdx, normalDots, coefMatrix);
-         float aRadius = BoundingBox::thisIntersectionRadiusProjection(
-          aNdx, bNdx, aSize, absCoefMatrix);
-         float bRadius = BoundingBox::otherIntersectionRadiusProjection(
-          aNdx, bNdx, bSize, absCoefMatrix);
-
-         if (approxGreaterThan(interval, aRadius + bRadius)) {
-            return false;
-         }
+         int index = linearize_index(glm::ivec2(aNdx, bNdx), glm::ivec2(3, 3));
+         bRadius += bSize[bNdx] * absCoefMatrix[index];
       }
+   } else if (axis < 6) {
+      // Face normal of the other BoundingBox.
+      int bNdx = axis - 3;
+      interval = std::abs(bDots[bNdx]);
+      aRadius = 0.0f;
+      for (int aNdx = 0; aNdx < 3; ++aNdx) {
+         int index = linearize_index(glm::ivec2(aNdx, bNdx), glm::ivec2(3, 3));
+         aRadius += aSize[aNdx] * absCoefMatrix[index];
+      }
+      bRadius = bSize[bNdx];
+   } else {
+      // Cross product of a face normal from each.
+      int aNdx = (axis - 6) / 3;
+      int bNdx = (axis - 6) % 3;
+      interval = BoundingBox::centerDifferenceProjection(aNdx, bNdx, aDots,
+       coefMatrix);
+      aRadius = BoundingBox::thisIntersectionRadiusProjection(aNdx, bNdx,
+       aSize, absCoefMatrix);
+      bRadius = BoundingBox::otherIntersectionRadiusProjection(aNdx, bNdx,
+       bSize, absCoefMatrix);
    }
 
-   return true;
+   return approxGreaterThan(interval, aRadius + bRadius);
 }
 
 /* static */ float BoundingBox::centerDifferenceProjection(int aNdx, int bNdx,
@@ -393,5 +568,133 @@ bool BoundingBox::intersectAsBoxes(BoundingBox& boundingBox) {
    float aCoef = absCoefMatrix[aCoefIndex];
    float bCoef = absCoefMatrix[bCoefIndex];
 
-   return bSize[aSizeNdx] * aCoef + bSize[aSizeNdx] * bCoef;
+   return bSize[aSizeNdx] * aCoef + bSize[bSizeNdx] * bCoef;
+}
+
+boost::optional< float > BoundingBox::findImpact(
+ const BoundingBox& boundingBox, BoundingBox& aStart, BoundingBox& bStart,
+ float start, float end, unsigned int depth) const {
+   BoundingBox aEnd = this->getMoved(end);
+   BoundingBox bEnd = boundingBox.getMoved(end);
+   boost::optional< float > contact = BoundingBox::getSweptContact(aStart,
+    aEnd, bStart, bEnd, end - start);
+   if (!contact) {
+      return boost::none;
+   }
+
+   // The swept test is exact for boxes that only translate. Otherwise it
+   // grows tighter as the part it covers is halved.
+   bool isRigid = this->getRotationalVelocity() == NO_ROTATION &&
+    this->getScaleVelocity() == glm::vec3() &&
+    boundingBox.getRotationalVelocity() == NO_ROTATION &&
+    boundingBox.getScaleVelocity() == glm::vec3();
+   if (isRigid || depth == BoundingBox::MAX_IMPACT_DEPTH) {
+      return start + *contact * (end - start);
+   }
+
+   float middle = (start + end) * 0.5f;
+   boost::optional< float > impact = this->findImpact(boundingBox, aStart,
+    bStart, start, middle, depth + 1);
+   if (impact) {
+      return impact;
+   }
+
+   BoundingBox aMiddle = this->getMoved(middle);
+   BoundingBox bMiddle = boundingBox.getMoved(middle);
+   return this->findImpact(boundingBox, aMiddle, bMiddle, middle, end,
+    depth + 1);
+}
+
+/* static */ boost::optional< float > BoundingBox::getSweptContact(
+ BoundingBox& aStart, BoundingBox& aEnd, BoundingBox& bStart,
+ BoundingBox& bEnd, float duration) {
+   glm::mat4 aRotation = glm::mat4_cast(aStart.getOrientation());
+   glm::mat4 bRotation = glm::mat4_cast(bStart.getOrientation());
+   glm::vec3 aHalfSize = glm::max(glm::abs(aStart.getSize()),
+    glm::abs(aEnd.getSize())) * 0.5f;
+   glm::vec3 bHalfSize = glm::max(glm::abs(bStart.getSize()),
+    glm::abs(bEnd.getSize())) * 0.5f;
+   float aSlack = BoundingBox::getSweptSlack(aStart, aHalfSize, duration);
+   float bSlack = BoundingBox::getSweptSlack(bStart, bHalfSize, duration);
+
+   std::array< glm::vec3, NUM_SEPARATING_AXES > axes;
+   for (unsigned int ndx = 0; ndx < 3; ++ndx) {
+      axes[ndx] = glm::vec3(aRotation[ndx]);
+      axes[3 + ndx] = glm::vec3(bRotation[ndx]);
+   }
+   for (unsigned int aNdx = 0; aNdx < 3; ++aNdx) {
+      for (unsigned int bNdx = 0; bNdx < 3; ++bNdx) {
+         axes[6 + aNdx * 3 + bNdx] = glm::cross(axes[aNdx], axes[3 + bNdx]);
+      }
+   }
+
+   // Along each axis, the boxes overlap while the distance between their
+   // centers is within the sum of their radii. That distance changes
+   // linearly, so each axis admits a single span of the duration, and the
+   // boxes can only touch where every span overlaps.
+   glm::vec3 offset = bStart.getPosition() - aStart.getPosition();
+   glm::vec3 travel = (bEnd.getPosition() - bStart.getPosition()) -
+    (aEnd.getPosition() - aStart.getPosition());
+   float enter = 0.0f;
+   float exit = 1.0f;
+   for (glm::vec3 axis : axes) {
+      // Parallel face normals have no cross product to test.
+      float length = glm::length(axis);
+      if (length < std::numeric_limits< float >::epsilon()) {
+         continue;
+      }
+      axis = axis / length;
+
+      float radius =
+       BoundingBox::getSweptRadius(axis, aRotation, aHalfSize, aSlack) +
+       BoundingBox::getSweptRadius(axis, bRotation, bHalfSize, bSlack);
+      float distance = glm::dot(axis, offset);
+      float speed = glm::dot(axis, travel);
+      if (speed == 0.0f) {
+         if (std::abs(distance) > radius) {
+            return boost::none;
+         }
+         continue;
+      }
+
+      float first = (-radius - distance) / speed;
+      float last = (radius - distance) / speed;
+      if (first > last) {
+         std::swap(first, last);
+      }
+
+      enter = std::max(enter, first);
+      exit = std::min(exit, last);
+      if (enter > exit) {
+         return boost::none;
+      }
+   }
+
+   return enter;
+}
+
+/* static */ float BoundingBox::getSweptRadius(const glm::vec3& axis,
+ const glm::mat4& rotation, const glm::vec3& halfSize, float slack) {
+   float radius = slack;
+   for (unsigned int ndx = 0; ndx < 3; ++ndx) {
+      radius += std::abs(glm::dot(axis, glm::vec3(rotation[ndx]))) *
+       halfSize[ndx];
+   }
+   return radius;
+}
+
+/* static */ float BoundingBox::getSweptSlack(const BoundingBox& boundingBox,
+ const glm::vec3& halfSize, float duration) {
+   glm::quat rotationalVelocity = boundingBox.getRotationalVelocity();
+   if (rotationalVelocity == NO_ROTATION) {
+      return 0.0f;
+   }
+
+   // Whichever way the rotation is interpolated, it turns by at most
+   // 2 acos(w) per unit of time. A corner at distance r from the center
+   // turned by an angle a moves 2 r sin(a / 2).
+   float rate = 2.0f * std::acos(glm::clamp(rotationalVelocity.w, -1.0f,
+    1.0f));
+   float angle = std::min(rate * duration, pi);
+   return 2.0f * glm::length(halfSize) * std::sin(angle * 0.5f);
 }
@@ -0,0 +1,436 @@
+#include <algorithm>
+#include <bitset>
+#include <glm/gtc/quaternion.hpp>
+#include <crash/common/simd.hpp>
+#include <crash/space/boundable.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/bounding_box_array.hpp>
+#include <crash/space/intersection_statistics.hpp>
+#include <crash/render/view_frustum.hpp>
+
+using namespace crash::common;
+using namespace crash::space;
+using namespace crash::render;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+BoundingBoxArray::BoundingBoxArray(const BoundingBoxArray& boundingBoxArray) :
+   _boundables(boundingBoxArray._boundables),
+    _centers(boundingBoxArray._centers),
+    _halfExtents(boundingBoxArray._halfExtents),
+    _axes(boundingBoxArray._axes),
+    _radii(boundingBoxArray._radii)
+{}
+
+BoundingBoxArray::BoundingBoxArray() :
+   _boundables(), _centers(), _halfExtents(), _axes(), _radii()
+{}
+
+BoundingBoxArray::BoundingBoxArray(const std::vector< Boundable* >& boundables) :
+   BoundingBoxArray()
+{
+   this->reserve(boundables.size());
+   for (Boundable* boundable : boundables) {
+      this->add(boundable);
+   }
+}
+
+/* virtual */ BoundingBoxArray::~BoundingBoxArray() {}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data access.
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int BoundingBoxArray::getNumBoundables() const {
+   return this->_boundables.size();
+}
+
+Boundable* BoundingBoxArray::getBoundable(unsigned int index) const {
+   return this->_boundables[index];
+}
+
+glm::vec3 BoundingBoxArray::getCenter(unsigned int index) const {
+   return glm::vec3(this->_centers[0][index], this->_centers[1][index],
+    this->_centers[2][index]);
+}
+
+glm::vec3 BoundingBoxArray::getHalfExtents(unsigned int index) const {
+   return glm::vec3(this->_halfExtents[0][index],
+    this->_halfExtents[1][index], this->_halfExtents[2][index]);
+}
+
+glm::vec3 BoundingBoxArray::getAxis(unsigned int index,
+ unsigned int axis) const {
+   return glm::vec3(this->_axes[axis * 3 + 0][index],
+    this->_axes[axis * 3 + 1][index], this->_axes[axis * 3 + 2][index]);
+}
+
+unsigned int BoundingBoxArray::add(Boundable* boundable) {
+   unsigned int index = this->_boundables.size();
+
+   this->_boundables.push_back(boundable);
+   for (auto& component : this->_centers) {
+      component.push_back(0.0f);
+   }
+   for (auto& component : this->_halfExtents) {
+      component.push_back(0.0f);
+   }
+   for (auto& component : this->_axes) {
+      component.push_back(0.0f);
+   }
+   this->_radii.push_back(0.0f);
+
+   this->update(index);
+   return index;
+}
+
+void BoundingBoxArray::remove(unsigned int index) {
+   unsigned int last = this->_boundables.size() - 1;
+
+   this->_boundables[index] = this->_boundables[last];
+   this->_boundables.pop_back();
+   for (auto& component : this->_centers) {
+      component[index] = component[last];
+      component.pop_back();
+   }
+   for (auto& component : this->_halfExtents) {
+      component[index] = component[last];
+      component.pop_back();
+   }
+   for (auto& component : this->_axes) {
+      component[index] = component[last];
+      component.pop_back();
+   }
+   this->_radii[index] = this->_radii[last];
+   this->_radii.pop_back();
+}
+
+void BoundingBoxArray::update(unsigned int index) {
+   this->assign(index, this->_boundables[index]->getBoundingBox());
+}
+
+void BoundingBoxArray::update() {
+   for (unsigned int ndx = 0; ndx < this->_boundables.size(); ++ndx) {
+      this->update(ndx);
+   }
+}
+
+void BoundingBoxArray::reserve(unsigned int capacity) {
+   this->_boundables.reserve(capacity);
+   for (auto& component : this->_centers) {
+      component.reserve(capacity);
+   }
+   for (auto& component : this->_halfExtents) {
+      component.reserve(capacity);
+   }
+   for (auto& component : this->_axes) {
+      component.reserve(capacity);
+   }
+   this->_radii.reserve(capacity);
+}
+
+void BoundingBoxArray::clear() {
+   this->_boundables.clear();
+   for (auto& component : this->_centers) {
+      component.clear();
+   }
+   for (auto& component : this->_halfExtents) {
+      component.clear();
+   }
+   for (auto& component : this->_axes) {
+      component.clear();
+   }
+   this->_radii.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Batch queries.
+////////////////////////////////////////////////////////////////////////////////
+
+void BoundingBoxArray::cullAgainst(const ViewFrustum& viewFrustum,
+ Bitmask& visible) const {
+   using namespace crash::common::simd;
+
+   const unsigned int count = this->_boundables.size();
+   visible.assign((count + 31) / 32, 0);
+
+   // Pre-calculate the plane equations (n . x - offset) once per query.
+   const ViewFrustum::Planes& planes = viewFrustum.getPlanes();
+   std::array< glm::vec4, ViewFrustum::NUM_PLANES > equations;
+   for (unsigned int planeNdx = 0; planeNdx < ViewFrustum::NUM_PLANES;
+    ++planeNdx) {
+      const Plane& plane = planes[planeNdx];
+      equations[planeNdx] = glm::vec4(plane.normal,
+       glm::dot(plane.normal, plane.point));
+   }
+
+   const float* cx = this->_centers[0].data();
+   const float* cy = this->_centers[1].data();
+   const float* cz = this->_centers[2].data();
+   const float* hx = this->_halfExtents[0].data();
+   const float* hy = this->_halfExtents[1].data();
+   const float* hz = this->_halfExtents[2].data();
+   std::array< const float*, 9 > axes;
+   for (unsigned int ndx = 0; ndx < 9; ++ndx) {
+      axes[ndx] = this->_axes[ndx].data();
+   }
+
+   // A box is outside the frustum if it is entirely behind any one plane:
+   // the signed distance of its center is less than the negated radius of the
+   // box projected onto the plane normal.
+   unsigned int ndx = 0;
+   for (; ndx + Float::WIDTH <= count; ndx += Float::WIDTH) {
+      Float centerX = load(cx + ndx);
+      Float centerY = load(cy + ndx);
+      Float centerZ = load(cz + ndx);
+      Float extentX = load(hx + ndx);
+      Float extentY = load(hy + ndx);
+      Float extentZ = load(hz + ndx);
+      Float outside = broadcast(0.0f);
+
+      for (const glm::vec4& equation : equations) {
+         Float nx = broadcast(equation.x);
+         Float ny = broadcast(equation.y);
+         Float nz = broadcast(equation.z);
+
+         Float distance = nx * centerX + ny * centerY + nz * centerZ -
+          broadcast(equation.w);
+
+         Float radius =
+          extentX * abs(nx * load(axes[0] + ndx) + ny * load(axes[1] + ndx) +
+           nz * load(axes[2] + ndx)) +
+          extentY * abs(nx * load(axes[3] + ndx) + ny * load(axes[4] + ndx) +
+           nz * load(axes[5] + ndx)) +
+          extentZ * abs(nx * load(axes[6] + ndx) + ny * load(axes[7] + ndx) +
+           nz * load(axes[8] + ndx));
+
+         outside = outside | lessThan(distance + radius, broadcast(0.0f));
+      }
+
+      std::uint32_t inside = ~bits(outside) & ((1u << Float::WIDTH) - 1);
+      visible[ndx / 32] |= inside << (ndx % 32);
+   }
+
+   // Finish the remainder that does not fill a whole vector.
+   for (; ndx < count; ++ndx) {
+      bool outside = false;
+
+      for (const glm::vec4& equation : equations) {
+         glm::vec3 normal = glm::vec3(equation);
+
+         float distance = glm::dot(normal, this->getCenter(ndx)) - equation.w;
+
+         glm::vec3 halfExtents = this->getHalfExtents(ndx);
+         float radius = 0.0f;
+         for (unsigned int axis = 0; axis < 3; ++axis) {
+            radius += halfExtents[axis] *
+             std::abs(glm::dot(normal, this->getAxis(ndx, axis)));
+         }
+
+         if (distance + radius < 0.0f) {
+            outside = true;
+            break;
+         }
+      }
+
+      if (!outside) {
+         visible[ndx / 32] |= 1u << (ndx % 32);
+      }
+   }
+}
+
+void BoundingBoxArray::intersectPairs(const SlotPairs& pairs,
+ Bitmask& intersecting) const {
+   using namespace crash::common::simd;
+
+   // Component layout, as returned by getComponents():
+   //    0-2:  center
+   //    3-5:  half-extents
+   //    6-14: axes (axis * 3 + component)
+   //    15:   bounding sphere radius
+   static const unsigned int CENTER = 0;
+   static const unsigned int EXTENT = 3;
+   static const unsigned int AXIS = 6;
+   static const unsigned int RADIUS = 15;
+
+   // Guards the separating axis test against false separations when an edge
+   // of one box is parallel to an edge of the other and the cross product
+   // of the two is near zero.
+   static const float epsilon = 1.0e-6f;
+
+   const unsigned int count = pairs.size();
+   intersecting.assign((count + 31) / 32, 0);
+
+   const Components components = this->getComponents();
+
+   // Counts are gathered locally and added to the shared totals once.
+   const bool collecting = IntersectionStatistics::isCollecting();
+   IntersectionStatistics statistics;
+
+   // Lanes are gathered from arbitrary slots, so they are staged in local
+   // buffers before being loaded. A trailing partial block repeats its last
+   // pair; the extra lanes are masked off below.
+   float firstLanes[NUM_COMPONENTS][Float::WIDTH];
+   float secondLanes[NUM_COMPONENTS][Float::WIDTH];
+
+   for (unsigned int ndx = 0; ndx < count; ndx += Float::WIDTH) {
+      for (unsigned int lane = 0; lane < Float::WIDTH; ++lane) {
+         const SlotPair& pair = pairs[std::min(ndx + lane, count - 1)];
+         for (unsigned int c = 0; c < NUM_COMPONENTS; ++c) {
+            firstLanes[c][lane] = components[c][pair.first];
+            secondLanes[c][lane] = components[c][pair.second];
+         }
+      }
+
+      Float a[NUM_COMPONENTS];
+      Float b[NUM_COMPONENTS];
+      for (unsigned int c = 0; c < NUM_COMPONENTS; ++c) {
+         a[c] = load(firstLanes[c]);
+         b[c] = load(secondLanes[c]);
+      }
+
+      unsigned int laneMask = (count - ndx >= Float::WIDTH) ?
+       (1u << Float::WIDTH) - 1 : (1u << (count - ndx)) - 1;
+
+      // Reject pairs whose bounding spheres do not overlap.
+      Float dx = b[CENTER + 0] - a[CENTER + 0];
+      Float dy = b[CENTER + 1] - a[CENTER + 1];
+      Float dz = b[CENTER + 2] - a[CENTER + 2];
+      Float radii = a[RADIUS] + b[RADIUS];
+      Float spheres = lessThan(dx * dx + dy * dy + dz * dz, radii * radii);
+
+      if (collecting) {
+         statistics.numTests += std::bitset< 32 >(laneMask).count();
+         statistics.numSphereRejects +=
+          std::bitset< 32 >(laneMask & ~bits(spheres)).count();
+      }
+
+      laneMask &= bits(spheres);
+      if (!laneMask) {
+         continue;
+      }
+
+      // Rotation of b expressed in the frame of a, and its absolute value.
+      Float r[3][3];
+      Float absR[3][3];
+      for (unsigned int i = 0; i < 3; ++i) {
+         for (unsigned int j = 0; j < 3; ++j) {
+            r[i][j] =
+             a[AXIS + i * 3 + 0] * b[AXIS + j * 3 + 0] +
+             a[AXIS + i * 3 + 1] * b[AXIS + j * 3 + 1] +
+             a[AXIS + i * 3 + 2] * b[AXIS + j * 3 + 2];
+            absR[i][j] = abs(r[i][j]) + broadcast(epsilon);
+         }
+      }
+
+      // Translation between the centers expressed in the frame of a.
+      Float t[3];
+      for (unsigned int i = 0; i < 3; ++i) {
+         t[i] = dx * a[AXIS + i * 3 + 0] + dy * a[AXIS + i * 3 + 1] +
+          dz * a[AXIS + i * 3 + 2];
+      }
+
+      const Float* aExtent = a + EXTENT;
+      const Float* bExtent = b + EXTENT;
+      Float separated = broadcast(0.0f);
+
+      // Credit each lane to the first axis that separates it.
+      unsigned int counted = 0;
+      auto separate = [&](unsigned int axis, const Float& axisSeparated) {
+         separated = separated | axisSeparated;
+         if (collecting) {
+            unsigned int lanes = bits(axisSeparated) & laneMask & ~counted;
+            statistics.numSeparations[axis] += std::bitset< 32 >(lanes).count();
+            counted |= lanes;
+         }
+      };
+
+      // Face normals of a.
+      for (unsigned int i = 0; i < 3; ++i) {
+         Float aRadius = aExtent[i];
+         Float bRadius = bExtent[0] * absR[i][0] + bExtent[1] * absR[i][1] +
+          bExtent[2] * absR[i][2];
+         separate(i, greaterThan(abs(t[i]), aRadius + bRadius));
+      }
+
+      // Face normals of b.
+      for (unsigned int j = 0; j < 3; ++j) {
+         Float aRadius = aExtent[0] * absR[0][j] + aExtent[1] * absR[1][j] +
+          aExtent[2] * absR[2][j];
+         Float bRadius = bExtent[j];
+         Float interval = t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j];
+         separate(3 + j, greaterThan(abs(interval), aRadius + bRadius));
+      }
+
+      // Cross products of every pair of face normals.
+      for (unsigned int i = 0; i < 3; ++i) {
+         unsigned int i1 = (i + 1) % 3;
+         unsigned int i2 = (i + 2) % 3;
+         for (unsigned int j = 0; j < 3; ++j) {
+            unsigned int j1 = (j + 1) % 3;
+            unsigned int j2 = (j + 2) % 3;
+
+            Float aRadius = aExtent[i1] * absR[i2][j] +
+             aExtent[i2] * absR[i1][j];
+            Float bRadius = bExtent[j1] * absR[i][j2] +
+             bExtent[j2] * absR[i][j1];
+            Float interval = t[i2] * r[i1][j] - t[i1] * r[i2][j];
+            separate(6 + i * 3 + j,
+             greaterThan(abs(interval), aRadius + bRadius));
+         }
+      }
+
+      laneMask &= ~bits(separated);
+      intersecting[ndx / 32] |= laneMask << (ndx % 32);
+      if (collecting) {
+         statistics.numIntersections += std::bitset< 32 >(laneMask).count();
+      }
+   }
+
+   if (collecting) {
+      IntersectionStatistics::collect(statistics);
+   }
+}
+
+/* static */ bool BoundingBoxArray::isSet(const Bitmask& bitmask,
+ unsigned int index) {
+   return (bitmask[index / 32] >> (index % 32)) & 1u;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers.
+////////////////////////////////////////////////////////////////////////////////
+
+void BoundingBoxArray::assign(unsigned int index, BoundingBox* boundingBox) {
+   glm::vec3 position = boundingBox->getPosition();
+   glm::vec3 halfExtents = boundingBox->getSize() * 0.5f;
+   glm::mat4 rotation = glm::mat4_cast(boundingBox->getOrientation());
+
+   for (unsigned int component = 0; component < 3; ++component) {
+      this->_centers[component][index] = position[component];
+      this->_halfExtents[component][index] = halfExtents[component];
+   }
+
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      for (unsigned int component = 0; component < 3; ++component) {
+         this->_axes[axis * 3 + component][index] = rotation[axis][component];
+      }
+   }
+
+   this->_radii[index] = glm::length(halfExtents);
+}
+
+BoundingBoxArray::Components BoundingBoxArray::getComponents() const {
+   Components components;
+   for (unsigned int ndx = 0; ndx < 3; ++ndx) {
+      components[ndx] = this->_centers[ndx].data();
+      components[3 + ndx] = this->_halfExtents[ndx].data();
+   }
+   for (unsigned int ndx = 0; ndx < 9; ++ndx) {
+      components[6 + ndx] = this->_axes[ndx].data();
+   }
+   components[15] = this->_radii.data();
+   return components;
+}
@@ -0,0 +1,34 @@
+#include <algorithm>
+#include <crash/space/bounding_grid.hpp>
+
+using namespace crash::space;
+
+////////////////////////////////////////////////////////////////////////////////
+// DynamicCellPolicy.
+////////////////////////////////////////////////////////////////////////////////
+
+/* static */ bool DynamicCellPolicy::insert(Cell& cell, unsigned int member) {
+   cell.push_back(member);
+   return true;
+}
+
+/* static */ void DynamicCellPolicy::erase(Cell& cell, unsigned int member) {
+   auto itr = std::find(cell.begin(), cell.end(), member);
+   if (itr != cell.end()) {
+      *itr = cell.back();
+      cell.pop_back();
+   }
+}
+
+/* static */ void DynamicCellPolicy::clear(Cell& cell) {
+   cell.clear();
+}
+
+/* static */ unsigned int DynamicCellPolicy::size(const Cell& cell) {
+   return cell.size();
+}
+
+/* static */ unsigned int DynamicCellPolicy::get(const Cell& cell,
+ unsigned int ndx) {
+   return cell[ndx];
+}
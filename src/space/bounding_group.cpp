@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <crash/common/symbols.hpp>
 #include <crash/space/bounding_group.hpp>
 #include <crash/render/view_frustum.hpp>
@@ -11,7 +12,8 @@ using namespace crash::render;
 ////////////////////////////////////////////////////////////////////////////////
 
 BoundingGroup::BoundingGroup(const BoundingGroup& boundingGroup) :
-   _boundingBox(boundingGroup._boundingBox),
+   Boundable(boundingGroup),
+    _boundingBox(boundingGroup._boundingBox),
     _boundables(boundingGroup._boundables)
 {}
 
@@ -49,14 +51,17 @@ glm::vec3 BoundingGroup::getScaleVelocity() const {
 
 void BoundingGroup::setPosition(const glm::vec3& position) {
    this->_boundingBox.setPosition(position);
+   this->setSleeping(false);
 }
 
 void BoundingGroup::setOrientation(const glm::quat& orientation) {
    this->_boundingBox.setOrientation(orientation);
+   this->setSleeping(false);
 }
 
 void BoundingGroup::setSize(const glm::vec3& size) {
    this->_boundingBox.setSize(size);
+   this->setSleeping(false);
 }
 
 void BoundingGroup::setTranslationalVelocity(
@@ -85,16 +90,25 @@ BoundingBox* BoundingGroup::getBoundingBox() {
 ////////////////////////////////////////////////////////////////////////////////
 
 bool BoundingGroup::add(Boundable* boundingBox) {
-   return this->_boundables.insert(boundingBox).second;
+   auto itr = std::find(this->_boundables.begin(), this->_boundables.end(),
+    boundingBox);
+   if (itr != this->_boundables.end()) {
+      return false;
+   }
+
+   this->_boundables.push_back(boundingBox);
+   return true;
 }
 
 bool BoundingGroup::remove(Boundable* boundingBox) {
-   auto itr = this->_boundables.find(boundingBox);
+   auto itr = std::find(this->_boundables.begin(), this->_boundables.end(),
+    boundingBox);
    if (itr == this->_boundables.end()) {
       return false;
    }
 
-   this->_boundables.erase(itr);
+   *itr = this->_boundables.back();
+   this->_boundables.pop_back();
    return true;
 }
 
@@ -102,10 +116,32 @@ void BoundingGroup::clear() {
    this->_boundables.clear();
 }
 
-const std::set< Boundable* >& BoundingGroup::getBoundables() const {
+const std::vector< Boundable* >& BoundingGroup::getBoundables() const {
    return this->_boundables;
 }
 
+std::vector< Collision > BoundingGroup::getCandidateElements() const {
+   std::vector< Collision > queue;
+   auto begin = this->_boundables.begin();
+   auto end = this->_boundables.end();
+
+   for (auto itrA = begin; itrA != end; ++itrA) {
+      auto itrB = itrA;
+      while (++itrB != end) {
+         if ((*itrA)->isCollidable(*itrB)) {
+            queue.push_back(Collision::factory(*itrA, *itrB));
+         }
+      }
+   }
+
+   return queue;
+}
+
+unsigned int BoundingGroup::getNumCandidatePairs() const {
+   unsigned int size = this->_boundables.size();
+   return size * (size - 1) / 2;
+}
+
 std::vector< Collision > BoundingGroup::getCollidingElements() const {
    std::vector< Collision > queue;
    auto begin = this->_boundables.begin();
@@ -119,7 +155,7 @@ std::vector< Collision > BoundingGroup::getCollidingElements() const {
          auto a = *itrA;
          auto b = *itrB;
 
-         if (a->isIntersecting(b)) {
+         if (a->isCollidable(b) && a->isIntersecting(b)) {
             queue.push_back(Collision::factory(a, b));
          }
       }
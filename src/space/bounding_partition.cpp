@@ -1,4 +1,10 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/gtc/quaternion.hpp>
+#include <crash/common/plane.hpp>
 #include <crash/common/symbols.hpp>
+#include <crash/render/view_frustum.hpp>
 #include <crash/space/bounding_partition.hpp>
 #include <crash/space/util.hpp>
 
@@ -11,15 +17,54 @@ using namespace crash::render;
 ////////////////////////////////////////////////////////////////////////////////
 
 BoundingPartition::BoundingPartition(const BoundingPartition& spatialManager) :
-   _boundingBox(spatialManager._boundingBox),
+   Boundable(spatialManager),
+    _boundingBox(spatialManager._boundingBox),
     _partitions(spatialManager._partitions),
+    _hierarchical(spatialManager._hierarchical),
+    _sweepInterval(spatialManager._sweepInterval),
+    _levels(spatialManager._levels),
     _boundingGroups(spatialManager._boundingGroups),
-    _numBoundables(spatialManager._numBoundables)
+    _cells(spatialManager._cells),
+    _outside(spatialManager._outside),
+    _overhanging(spatialManager._overhanging),
+    _numOccupied(spatialManager._numOccupied),
+    _numMembers(spatialManager._numMembers),
+    _boundables(spatialManager._boundables),
+    _cellRanges(spatialManager._cellRanges),
+    _stamps(spatialManager._stamps),
+    _freeSlots(spatialManager._freeSlots),
+    _slots(spatialManager._slots),
+    _stamp(spatialManager._stamp),
+    _narrowphase(),
+    _candidates(),
+    _colliding(),
+    _threadPool(spatialManager._threadPool),
+    _deterministic(spatialManager._deterministic),
+    _workers(),
+    _buffers(),
+    _visibleBuffers(),
+    _planeMasks(),
+    _neighbors(),
+    _queryStatistics(),
+    _autoPartition(spatialManager._autoPartition),
+    _maxMembers(spatialManager._maxMembers),
+    _minOccupied(spatialManager._minOccupied),
+    _migrationBudget(spatialManager._migrationBudget),
+    _rebalanceCalls(0),
+    _splitMembers(spatialManager._splitMembers),
+    _pending(),
+    _migrated(0)
 {}
 
 BoundingPartition::BoundingPartition(const Transformer& transformer,
  const glm::ivec3& partitions) :
-   _boundingBox(transformer), _numBoundables(0)
+   _boundingBox(transformer), _hierarchical(false), _sweepInterval(0.0f),
+    _numOccupied(0), _numMembers(0), _stamp(0),
+    _narrowphase(), _candidates(), _colliding(), _threadPool(nullptr),
+    _deterministic(true), _workers(), _buffers(), _visibleBuffers(),
+    _planeMasks(), _neighbors(), _queryStatistics(), _autoPartition(false),
+    _maxMembers(8.0f), _minOccupied(0.25f), _migrationBudget(256),
+    _rebalanceCalls(0), _splitMembers(0.0f), _pending(), _migrated(0)
 {
    this->partition(transformer, partitions);
 }
@@ -54,14 +99,17 @@ glm::vec3 BoundingPartition::getScaleVelocity() const {
 
 void BoundingPartition::setPosition(const glm::vec3& position) {
    this->_boundingBox.setPosition(position);
+   this->setSleeping(false);
 }
 
 void BoundingPartition::setOrientation(const glm::quat& orientation) {
    this->_boundingBox.setOrientation(orientation);
+   this->setSleeping(false);
 }
 
 void BoundingPartition::setSize(const glm::vec3& size) {
    this->_boundingBox.setSize(size);
+   this->setSleeping(false);
 }
 
 void BoundingPartition::setTranslationalVelocity(
@@ -95,24 +143,49 @@ void BoundingPartition::resize(const Transformer& transformer,
    std::vector< Boundable* > boundables = this->getBoundables();
 
    this->partition(transformer, partitions);
-
-   for (Boundable* boundable : boundables) {
-      this->add(boundable);
-   }
+   this->build(boundables);
 }
 
 void BoundingPartition::partition(const Transformer& transformer,
  const glm::ivec3& partitions) {
-   this->_numBoundables = 0;
+   this->layOut(transformer, partitions);
+   this->buildGroups(this->getNumGroups());
+}
+
+void BoundingPartition::layOut(const Transformer& transformer,
+ const glm::ivec3& partitions) {
+   this->clear();
 
    this->_boundingBox.setTransformer(transformer);
    this->_partitions = partitions;
 
-   unsigned int totalPartitions = this->_partitions.x * this->_partitions.y *
-    this->_partitions.z;
+   // Each coarser level halves the groups along every axis, rounding up,
+   // until a single group covers the partition.
+   this->_levels.clear();
+   unsigned int totalPartitions = 0;
+   glm::ivec3 levelPartitions = partitions;
+   while (true) {
+      Level level = { levelPartitions, totalPartitions, 0 };
+      this->_levels.push_back(level);
+      totalPartitions += levelPartitions.x * levelPartitions.y *
+       levelPartitions.z;
+
+      if (!this->_hierarchical ||
+       glm::all(glm::lessThanEqual(levelPartitions, glm::ivec3(1)))) {
+         break;
+      }
+      levelPartitions = (levelPartitions + glm::ivec3(1)) / glm::ivec3(2);
+   }
+
    this->_boundingGroups.clear();
    this->_boundingGroups.reserve(totalPartitions);
+   this->_cells.clear();
+   this->_cells.reserve(totalPartitions);
+}
 
+bool BoundingPartition::buildGroups(unsigned int count) {
+   const Transformer& transformer = this->_boundingBox.getTransformer();
+   const glm::ivec3& partitions = this->_partitions;
    glm::vec3 size = transformer.getSize();
    glm::vec3 dimensions = glm::vec3(
       size.x / (float)partitions.x,
@@ -120,116 +193,331 @@ void BoundingPartition::partition(const Transformer& transformer,
       size.z / (float)partitions.z
    );
 
-   glm::vec3 corner = transformer.getPosition() - (size * 0.5f);
+   // Groups are laid out in the local space of the partition, so their
+   // offsets from its center must be rotated along with them. Groups of
+   // coarser levels are clipped to the sides of the partition.
+   glm::vec3 corner = -(size * 0.5f);
    glm::quat orientation = transformer.getOrientation();
-   for (unsigned int ndx = 0; ndx < totalPartitions; ++ndx) {
-      glm::ivec3 index = vectorize_index(ndx, this->_partitions);
-      glm::vec3 relativePosition = glm::vec3(
-         index.x * dimensions.x,
-         index.y * dimensions.y,
-         index.z * dimensions.z
-      );
-      glm::vec3 position = corner + (dimensions * 0.5f) + relativePosition;
+   unsigned int end = std::min(this->_boundingGroups.size() + count,
+    (std::size_t)this->getNumGroups());
+   unsigned int level = 0;
+   while (this->_boundingGroups.size() < end) {
+      unsigned int group = this->_boundingGroups.size();
+      while (level + 1 < this->_levels.size() &&
+       group >= this->_levels[level + 1].offset) {
+         ++level;
+      }
+
+      const glm::ivec3& levelPartitions = this->_levels[level].partitions;
+      glm::ivec3 scale = glm::ivec3(1 << level);
+      glm::ivec3 index = vectorize_index(group - this->_levels[level].offset,
+       levelPartitions);
+      glm::vec3 minimum = glm::vec3(index * scale);
+      glm::vec3 maximum = glm::vec3(glm::min((index + glm::ivec3(1)) * scale,
+       partitions));
+
+      glm::vec3 position = transformer.getPosition() + orientation *
+       (corner + (minimum + maximum) * 0.5f * dimensions);
 
       this->_boundingGroups.push_back(BoundingGroup(Transformer(
-       position, orientation, dimensions,
+       position, orientation, (maximum - minimum) * dimensions,
        glm::vec3(), NO_ROTATION, glm::vec3())));
+      this->_cells.push_back(Cell());
    }
+
+   return this->_boundingGroups.size() == this->getNumGroups();
+}
+
+unsigned int BoundingPartition::getNumGroups() const {
+   const Level& coarsest = this->_levels.back();
+   return coarsest.offset + coarsest.partitions.x * coarsest.partitions.y *
+    coarsest.partitions.z;
 }
 
-bool BoundingPartition::add(Boundable* boundingBox) {
-   this->_boundingBoxes.erase(boundingBox);
+void BoundingPartition::build(const std::vector< Boundable* >& boundables) {
+   this->clear();
+
+   this->_boundables.reserve(boundables.size());
+   this->_slots.reserve(boundables.size());
+   for (Boundable* boundable : boundables) {
+      unsigned int slot = this->_boundables.size();
+      if (this->_slots.insert(std::make_pair(boundable, slot)).second) {
+         this->_boundables.push_back(boundable);
+      }
+   }
+
+   unsigned int numSlots = this->_boundables.size();
+   this->_cellRanges.resize(numSlots);
+   this->_stamps.assign(numSlots, 0);
 
-   bool added = false;
+   this->runRanges(numSlots, [this](unsigned int begin, unsigned int end) {
+      for (unsigned int slot = begin; slot < end; ++slot) {
+         this->_cellRanges[slot] = this->getCellRange(this->_boundables[slot]);
+      }
+   });
 
-   for (BoundingGroup& group : this->_boundingGroups) {
-      if (group.isIntersecting(boundingBox)) {
-         added |= group.add(boundingBox);
+   // Count the members of every cell, and turn the counts into the offset of
+   // each cell within a single array of members.
+   unsigned int numCells = this->_cells.size();
+   std::vector< unsigned int > offsets(numCells + 1, 0);
+   for (unsigned int slot = 0; slot < numSlots; ++slot) {
+      const CellRange& range = this->_cellRanges[slot];
+      if (range.isEmpty()) {
+         this->_outside.push_back(slot);
+      } else {
+         ++this->_levels[range.level].numBoundables;
+         this->forEachCellIndex(range, [&offsets](unsigned int cell) {
+            ++offsets[cell + 1];
+         });
+      }
+      if (range.overhanging) {
+         this->_overhanging.push_back(slot);
+      }
+   }
+   for (unsigned int cell = 0; cell < numCells; ++cell) {
+      if (offsets[cell + 1] > 0) {
+         ++this->_numOccupied;
+      }
+      offsets[cell + 1] += offsets[cell];
+   }
+   this->_numMembers = offsets[numCells];
+
+   // Scatter the slots in order, so every cell lists them as add() would.
+   std::vector< unsigned int > members(offsets[numCells]);
+   std::vector< unsigned int > cursors(offsets.begin(), offsets.end() - 1);
+   for (unsigned int slot = 0; slot < numSlots; ++slot) {
+      const CellRange& range = this->_cellRanges[slot];
+      if (!range.isEmpty()) {
+         this->forEachCellIndex(range,
+          [&members, &cursors, slot](unsigned int cell) {
+            members[cursors[cell]++] = slot;
+         });
+      }
+   }
+
+   this->runRanges(numCells,
+    [this, &members, &offsets](unsigned int begin, unsigned int end) {
+      for (unsigned int cell = begin; cell < end; ++cell) {
+         this->_cells[cell].assign(members.begin() + offsets[cell],
+          members.begin() + offsets[cell + 1]);
       }
+   });
+}
+
+void BoundingPartition::setHierarchical(bool hierarchical) {
+   if (hierarchical == this->_hierarchical) {
+      return;
    }
 
-   if (!added) {
-      this->_boundingBoxes.insert(boundingBox);
+   this->_hierarchical = hierarchical;
+   this->resize(this->_boundingBox.getTransformer(), this->_partitions);
+}
+
+bool BoundingPartition::getHierarchical() const {
+   return this->_hierarchical;
+}
+
+unsigned int BoundingPartition::getNumLevels() const {
+   return this->_levels.size();
+}
+
+void BoundingPartition::setSweepInterval(float sweepInterval) {
+   if (sweepInterval == this->_sweepInterval) {
+      return;
    }
 
-   ++this->_numBoundables;
-   return added;
+   this->_sweepInterval = sweepInterval;
+   this->build(this->getBoundables());
 }
 
-bool BoundingPartition::remove(Boundable* boundingBox) {
-   bool removed = false;
+float BoundingPartition::getSweepInterval() const {
+   return this->_sweepInterval;
+}
 
-   for (BoundingGroup& group : this->_boundingGroups) {
-      removed |= group.remove(boundingBox);
+bool BoundingPartition::add(Boundable* boundable) {
+   if (this->_slots.find(boundable) != this->_slots.end()) {
+      return false;
    }
 
-   if (!removed) {
-      auto itr = this->_boundingBoxes.find(boundingBox);
-      if (itr != this->_boundingBoxes.end()) {
-         this->_boundingBoxes.erase(itr);
-         removed = true;
-      }
+   unsigned int slot;
+   if (this->_freeSlots.empty()) {
+      slot = this->_boundables.size();
+      this->_boundables.push_back(nullptr);
+      this->_cellRanges.push_back(EMPTY_RANGE);
+      this->_stamps.push_back(0);
+   } else {
+      slot = this->_freeSlots.back();
+      this->_freeSlots.pop_back();
+   }
+   this->_slots.insert(std::make_pair(boundable, slot));
+
+   CellRange range = this->getCellRange(boundable);
+   if (range.isEmpty()) {
+      this->_outside.push_back(slot);
+   } else {
+      this->addToRange(slot, range, EMPTY_RANGE);
+      ++this->_levels[range.level].numBoundables;
+   }
+   if (range.overhanging) {
+      this->_overhanging.push_back(slot);
+   }
+
+   this->_boundables[slot] = boundable;
+   this->_cellRanges[slot] = range;
+   this->_stamps[slot] = 0;
+
+   // Slots past the migration are moved to the new grid by rebalance().
+   if (this->_pending && slot < this->_migrated) {
+      this->_pending->add(boundable);
+   }
+   return true;
+}
+
+bool BoundingPartition::remove(Boundable* boundable) {
+   auto itr = this->_slots.find(boundable);
+   if (itr == this->_slots.end()) {
+      return false;
    }
 
-   if (removed) {
-      --this->_numBoundables;
+   unsigned int slot = itr->second;
+   this->_slots.erase(itr);
+
+   const CellRange& range = this->_cellRanges[slot];
+   if (range.isEmpty()) {
+      BoundingPartition::removeFromCell(this->_outside, slot);
+   } else {
+      this->removeFromRange(slot, range, EMPTY_RANGE);
+      --this->_levels[range.level].numBoundables;
+   }
+   if (range.overhanging) {
+      BoundingPartition::removeFromCell(this->_overhanging, slot);
    }
 
-   return removed;
+   this->_boundables[slot] = nullptr;
+   this->_freeSlots.push_back(slot);
+
+   if (this->_pending && slot < this->_migrated) {
+      this->_pending->remove(boundable);
+   }
+   return true;
 }
 
 bool BoundingPartition::update(Boundable* boundable) {
-   this->remove(boundable);
-   return this->add(boundable);
+   auto itr = this->_slots.find(boundable);
+   if (itr == this->_slots.end()) {
+      return this->add(boundable);
+   }
+
+   unsigned int slot = itr->second;
+   if (this->_pending && slot < this->_migrated) {
+      this->_pending->update(boundable);
+   }
+
+   CellRange previous = this->_cellRanges[slot];
+   CellRange current = this->getCellRange(boundable);
+   if (current == previous) {
+      return false;
+   }
+
+   if (previous.isEmpty()) {
+      BoundingPartition::removeFromCell(this->_outside, slot);
+   } else {
+      this->removeFromRange(slot, previous, current);
+      --this->_levels[previous.level].numBoundables;
+   }
+
+   if (current.isEmpty()) {
+      this->_outside.push_back(slot);
+   } else {
+      this->addToRange(slot, current, previous);
+      ++this->_levels[current.level].numBoundables;
+   }
+
+   if (previous.overhanging && !current.overhanging) {
+      BoundingPartition::removeFromCell(this->_overhanging, slot);
+   } else if (current.overhanging && !previous.overhanging) {
+      this->_overhanging.push_back(slot);
+   }
+
+   this->_cellRanges[slot] = current;
+   return true;
 }
 
 void BoundingPartition::clear() {
-   for (BoundingGroup& group : this->_boundingGroups) {
-      group.clear();
+   for (Cell& cell : this->_cells) {
+      cell.clear();
    }
+   for (Level& level : this->_levels) {
+      level.numBoundables = 0;
+   }
+   this->_numOccupied = 0;
+   this->_numMembers = 0;
 
-   this->_boundingBoxes.clear();
+   this->_outside.clear();
+   this->_overhanging.clear();
+   this->_boundables.clear();
+   this->_cellRanges.clear();
+   this->_stamps.clear();
+   this->_freeSlots.clear();
+   this->_slots.clear();
 
-   this->_numBoundables = 0;
+   // There is nothing left to move to a new grid.
+   this->_pending.reset();
+   this->_migrated = 0;
 }
 
 unsigned int BoundingPartition::getNumBoundables() const {
-   return this->_numBoundables;
-}
-
-unsigned int BoundingPartition::getNumBoundingGroups() const {
-   return this->_boundingGroups.size();
+   return this->_slots.size();
 }
 
 std::vector< Boundable* > BoundingPartition::getBoundables() const {
    std::vector< Boundable* > accumulator;
-   std::set< Boundable* > mark;
-
-   accumulator.reserve(this->_numBoundables);
+   accumulator.reserve(this->_slots.size());
 
-   for (Boundable* boundable : this->_boundingBoxes) {
-      auto itr = mark.find(boundable);
-      if (itr == mark.end()) {
+   for (Boundable* boundable : this->_boundables) {
+      if (boundable != nullptr) {
          accumulator.push_back(boundable);
-         mark.insert(boundable);
       }
    }
 
-   for (const BoundingGroup& group : this->_boundingGroups) {
-      for (Boundable* boundable : group.getBoundables()) {
-         auto itr = mark.find(boundable);
-         if (itr == mark.end()) {
-            accumulator.push_back(boundable);
-            mark.insert(boundable);
-         }
+   return accumulator;
+}
+
+void BoundingPartition::forEachBoundable(
+ const BoundableVisitor& visitor) const {
+   for (Boundable* boundable : this->_boundables) {
+      if (boundable != nullptr) {
+         visitor(boundable);
       }
    }
+}
 
-   return accumulator;
+unsigned int BoundingPartition::getNumBoundingGroups() const {
+   return this->_boundingGroups.size();
 }
 
 std::vector< BoundingGroup > BoundingPartition::getBoundingGroups() const {
-   return this->_boundingGroups;
+   std::vector< BoundingGroup > groups = this->_boundingGroups;
+
+   for (unsigned int ndx = 0; ndx < groups.size(); ++ndx) {
+      for (unsigned int slot : this->_cells[ndx]) {
+         groups[ndx].add(this->_boundables[slot]);
+      }
+   }
+
+   return groups;
+}
+
+const BoundingGroup& BoundingPartition::getBoundingGroup(
+ unsigned int ndx) const {
+   return this->_boundingGroups[ndx];
+}
+
+void BoundingPartition::forEachInCell(unsigned int ndx,
+ const BoundableVisitor& visitor) const {
+   for (unsigned int slot : this->_cells[ndx]) {
+      visitor(this->_boundables[slot]);
+   }
 }
 
 const glm::ivec3& BoundingPartition::getPartitions() const {
@@ -249,47 +537,1356 @@ std::vector< BoundingGroup > BoundingPartition::getContainingBoundingGroups(
    return groups;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Statistics.
+////////////////////////////////////////////////////////////////////////////////
+
+BoundingPartition::Occupancy BoundingPartition::getOccupancy() const {
+   Occupancy occupancy;
+   occupancy.numCells = this->_cells.size();
+   occupancy.numOccupied = 0;
+   occupancy.maxMembers = 0;
+   occupancy.meanMembers = 0.0f;
+   occupancy.numOutside = this->_outside.size();
+   occupancy.numOverhanging = this->_overhanging.size();
+   occupancy.numCellPairs = 0;
+
+   unsigned int numMembers = 0;
+   for (const Cell& cell : this->_cells) {
+      if (cell.empty()) {
+         continue;
+      }
+
+      unsigned int size = cell.size();
+      ++occupancy.numOccupied;
+      occupancy.maxMembers = std::max(occupancy.maxMembers, size);
+      occupancy.numCellPairs += size * (size - 1) / 2;
+      numMembers += size;
+   }
+
+   if (occupancy.numOccupied > 0) {
+      occupancy.meanMembers = (float)numMembers / occupancy.numOccupied;
+   }
+   return occupancy;
+}
+
+std::vector< unsigned int > BoundingPartition::getMemberHistogram() const {
+   std::vector< unsigned int > histogram;
+
+   for (const Cell& cell : this->_cells) {
+      if (cell.size() >= histogram.size()) {
+         histogram.resize(cell.size() + 1, 0);
+      }
+      ++histogram[cell.size()];
+   }
+
+   return histogram;
+}
+
+const BoundingPartition::QueryStatistics&
+ BoundingPartition::getQueryStatistics() const {
+   return this->_queryStatistics;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Rebalancing.
+////////////////////////////////////////////////////////////////////////////////
+
+void BoundingPartition::setAutoPartition(bool autoPartition) {
+   this->_autoPartition = autoPartition;
+   if (!autoPartition) {
+      this->_pending.reset();
+      this->_migrated = 0;
+   }
+}
+
+bool BoundingPartition::getAutoPartition() const {
+   return this->_autoPartition;
+}
+
+void BoundingPartition::setOccupancyLimits(float maxMembers,
+ float minOccupied) {
+   this->_maxMembers = maxMembers;
+   this->_minOccupied = minOccupied;
+}
+
+float BoundingPartition::getMaxMembers() const {
+   return this->_maxMembers;
+}
+
+float BoundingPartition::getMinOccupied() const {
+   return this->_minOccupied;
+}
+
+void BoundingPartition::setMigrationBudget(unsigned int budget) {
+   this->_migrationBudget = std::max(budget, 1u);
+}
+
+unsigned int BoundingPartition::getMigrationBudget() const {
+   return this->_migrationBudget;
+}
+
+bool BoundingPartition::rebalance() {
+   if (!this->_autoPartition) {
+      return false;
+   }
+
+   if (!this->_pending) {
+      if (++this->_rebalanceCalls < BoundingPartition::REBALANCE_INTERVAL) {
+         return false;
+      }
+      this->_rebalanceCalls = 0;
+
+      // Groups are free to be split again once they are within the limits.
+      float meanMembers = this->getMeanMembers();
+      if (meanMembers <= this->_maxMembers) {
+         this->_splitMembers = 0.0f;
+      }
+
+      glm::ivec3 partitions = this->getBalancedPartitions();
+      if (partitions == this->_partitions) {
+         return false;
+      }
+
+      bool isSplit = partitions.x * partitions.y * partitions.z >
+       this->_partitions.x * this->_partitions.y * this->_partitions.z;
+      this->_splitMembers = isSplit ? meanMembers : 0.0f;
+
+      // The new grid starts as a single group, and its groups are then built
+      // a few at a time like its members are moved.
+      const Transformer& transformer = this->_boundingBox.getTransformer();
+      this->_pending.reset(new BoundingPartition(transformer,
+       glm::ivec3(1)));
+      this->_pending->setHierarchical(this->_hierarchical);
+      this->_pending->setSweepInterval(this->_sweepInterval);
+      this->_pending->layOut(transformer, partitions);
+      this->_migrated = 0;
+   }
+
+   if (!this->_pending->buildGroups(this->_migrationBudget *
+    BoundingPartition::GROUPS_PER_MIGRATION)) {
+      return false;
+   }
+
+   unsigned int end = std::min< std::size_t >(
+    this->_migrated + this->_migrationBudget, this->_boundables.size());
+   for (; this->_migrated < end; ++this->_migrated) {
+      Boundable* boundable = this->_boundables[this->_migrated];
+      if (boundable != nullptr) {
+         this->_pending->add(boundable);
+      }
+   }
+
+   if (this->_migrated < this->_boundables.size()) {
+      return false;
+   }
+
+   this->adopt(*this->_pending);
+   this->_pending.reset();
+   this->_migrated = 0;
+   return true;
+}
+
+bool BoundingPartition::isRebalancing() const {
+   return (bool)this->_pending;
+}
+
+std::vector< Collision > BoundingPartition::getCandidateElements() const {
+   std::vector< Collision > candidates;
+   this->getCandidateElements(0, this->_cells.size(), candidates);
+   return candidates;
+}
+
 std::vector< Collision > BoundingPartition::getCollidingElements() const {
+   QueryTimer timer(this->_queryStatistics.collisionTime);
    std::vector< Collision > accumulator;
-   std::set< Collision > mark;
-
-   for (const BoundingGroup& group : this->_boundingGroups) {
-      for (auto collision : group.getCollidingElements()) {
-         auto itr = mark.find(collision);
-         if (itr == mark.end()) {
-            accumulator.push_back(collision);
-            mark.insert(collision);
+
+   if (this->_threadPool == nullptr ||
+    this->_threadPool->getNumThreads() == 1) {
+      this->_candidates.clear();
+      this->getCandidateElements(0, this->_cells.size(), this->_candidates);
+      this->_narrowphase.collide(this->_candidates, accumulator,
+       this->_sweepInterval);
+
+      this->_queryStatistics.numCandidates = this->_candidates.size();
+      this->_queryStatistics.numColliding = accumulator.size();
+      return accumulator;
+   }
+
+   unsigned int numBuffers = this->getCollidingElementsParallel();
+
+   unsigned int size = 0;
+   for (unsigned int ndx = 0; ndx < numBuffers; ++ndx) {
+      size += this->_buffers[ndx].size();
+   }
+
+   accumulator.reserve(size);
+   for (unsigned int ndx = 0; ndx < numBuffers; ++ndx) {
+      accumulator.insert(accumulator.end(), this->_buffers[ndx].begin(),
+       this->_buffers[ndx].end());
+   }
+
+   return accumulator;
+}
+
+void BoundingPartition::forEachPair(const CollisionVisitor& visitor) const {
+   QueryTimer timer(this->_queryStatistics.collisionTime);
+
+   if (this->_threadPool != nullptr && this->_threadPool->getNumThreads() > 1) {
+      unsigned int numBuffers = this->getCollidingElementsParallel();
+      for (unsigned int ndx = 0; ndx < numBuffers; ++ndx) {
+         for (const Collision& collision : this->_buffers[ndx]) {
+            visitor(collision);
          }
       }
+      return;
    }
 
-   return accumulator;
+   this->_candidates.clear();
+   this->getCandidateElements(0, this->_cells.size(), this->_candidates);
+   this->_narrowphase.collide(this->_candidates, this->_colliding,
+    this->_sweepInterval);
+
+   this->_queryStatistics.numCandidates = this->_candidates.size();
+   this->_queryStatistics.numColliding = this->_colliding.size();
+   for (const Collision& collision : this->_colliding) {
+      visitor(collision);
+   }
 }
 
 std::vector< Boundable* > BoundingPartition::getVisibleElements(
  const ViewFrustum& viewFrustum) {
    std::vector< Boundable* > accumulator;
-   std::set< Boundable* > mark;
+   this->forEachVisible(viewFrustum, [&accumulator](Boundable* boundable) {
+      accumulator.push_back(boundable);
+   });
+   return accumulator;
+}
 
-   for (Boundable* boundable : this->_boundingBoxes) {
-      auto itr = mark.find(boundable);
-      if (itr == mark.end() && boundable->isVisible(viewFrustum)) {
-         accumulator.push_back(boundable);
-         mark.insert(boundable);
+void BoundingPartition::forEachVisible(const ViewFrustum& viewFrustum,
+ const BoundableVisitor& visitor) {
+   QueryTimer timer(this->_queryStatistics.visibilityTime);
+   unsigned int& numVisible = this->_queryStatistics.numVisible;
+   numVisible = 0;
+
+   for (unsigned int slot : this->_outside) {
+      Boundable* boundable = this->_boundables[slot];
+      if (boundable->isVisible(viewFrustum)) {
+         visitor(boundable);
+         ++numVisible;
+      }
+   }
+
+   this->_planeMasks.resize(this->_cells.size());
+
+   if (this->_threadPool != nullptr && this->_threadPool->getNumThreads() > 1) {
+      unsigned int numBuffers = this->getVisibleElementsParallel(viewFrustum);
+      for (unsigned int ndx = 0; ndx < numBuffers; ++ndx) {
+         for (Boundable* boundable : this->_visibleBuffers[ndx]) {
+            visitor(boundable);
+         }
+         numVisible += this->_visibleBuffers[ndx].size();
+      }
+      return;
+   }
+
+   unsigned int parentMask = this->classifyPartition(viewFrustum);
+   this->classifyCells(0, this->_cells.size(), viewFrustum, parentMask);
+
+   // A Boundable in several visible groups is only tested by the first of
+   // them to reach it.
+   unsigned int stamp = this->nextStamp();
+   for (unsigned int ndx = 0; ndx < this->_cells.size(); ++ndx) {
+      if (this->_planeMasks[ndx] & CULLED) {
+         continue;
+      }
+
+      for (unsigned int slot : this->_cells[ndx]) {
+         if (this->_stamps[slot] == stamp) {
+            continue;
+         }
+         this->_stamps[slot] = stamp;
+
+         int owner;
+         unsigned int planeMask =
+          this->inspectRange(this->_cellRanges[slot], owner);
+
+         Boundable* boundable = this->_boundables[slot];
+         if (boundable->isVisible(viewFrustum, planeMask)) {
+            visitor(boundable);
+            ++numVisible;
+         }
+      }
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Parallelism.
+////////////////////////////////////////////////////////////////////////////////
+
+void BoundingPartition::setThreadPool(ThreadPool* threadPool) {
+   this->_threadPool = threadPool;
+}
+
+ThreadPool* BoundingPartition::getThreadPool() const {
+   return this->_threadPool;
+}
+
+void BoundingPartition::setDeterministic(bool deterministic) {
+   this->_deterministic = deterministic;
+}
+
+bool BoundingPartition::getDeterministic() const {
+   return this->_deterministic;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Queries.
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector< RayHit > BoundingPartition::raycast(const Line& ray,
+ float maxDistance) {
+   return this->raycast(ray, maxDistance,
+    std::numeric_limits< unsigned int >::max());
+}
+
+std::vector< RayHit > BoundingPartition::raycast(const Line& ray,
+ float maxDistance, unsigned int maxHits) {
+   QueryTimer timer(this->_queryStatistics.raycastTime);
+   this->_queryStatistics.numRayHits = 0;
+
+   std::vector< RayHit > hits;
+   if (maxHits == 0) {
+      return hits;
+   }
+
+   Line normalized(ray.point, glm::normalize(ray.direction));
+   unsigned int stamp = this->nextStamp();
+
+   // Only the cells within the partition are walked, so anything that reaches
+   // outside of them is tested directly.
+   for (unsigned int slot : this->_outside) {
+      this->castRay(slot, stamp, normalized, maxDistance, hits);
+   }
+   for (unsigned int slot : this->_overhanging) {
+      this->castRay(slot, stamp, normalized, maxDistance, hits);
+   }
+
+   // Walk the ray through the grid in the local space of the partition,
+   // scaled so that every cell is a unit cube and the minimum corner is at the
+   // origin. A distance t along the ray is at point + direction * t.
+   glm::quat inverse = glm::conjugate(this->_boundingBox.getOrientation());
+   glm::vec3 dimensions = this->_boundingBox.getSize() /
+    glm::vec3(this->_partitions);
+   glm::vec3 point = this->toGridSpace(normalized.point);
+   glm::vec3 direction = (inverse * normalized.direction) / dimensions;
+
+   // Clip the ray to the grid.
+   float entry = 0.0f;
+   float exit = maxDistance;
+   for (unsigned int axis = 0; axis < 3 && entry <= exit; ++axis) {
+      if (std::abs(direction[axis]) <
+       std::numeric_limits< float >::epsilon()) {
+         if (point[axis] < 0.0f || point[axis] >= this->_partitions[axis]) {
+            exit = -1.0f;
+         }
+         continue;
+      }
+
+      float near = -point[axis] / direction[axis];
+      float far = (this->_partitions[axis] - point[axis]) / direction[axis];
+      if (near > far) {
+         std::swap(near, far);
+      }
+      entry = std::max(entry, near);
+      exit = std::min(exit, far);
+   }
+
+   // Coarse levels hold few Boundables, which are tested first so that the
+   // walks through finer levels may stop sooner.
+   if (entry <= exit) {
+      for (unsigned int level = this->_levels.size(); level-- > 0;) {
+         if (this->_levels[level].numBoundables > 0) {
+            this->castRayThroughLevel(level, point, direction, entry, exit,
+             stamp, normalized, maxDistance, maxHits, hits);
+         }
       }
    }
 
-   for (BoundingGroup& group : this->_boundingGroups) {
-      if (group.isVisible(viewFrustum)) {
-         for (Boundable* boundingBox : group.getVisibleElements(viewFrustum)) {
-            auto itr = mark.find(boundingBox);
-            if (itr == mark.end()) {
-               accumulator.push_back(boundingBox);
-               mark.insert(boundingBox);
+   std::sort(hits.begin(), hits.end());
+   if (hits.size() > maxHits) {
+      hits.erase(hits.begin() + maxHits, hits.end());
+   }
+
+   this->_queryStatistics.numRayHits = hits.size();
+   return hits;
+}
+
+std::vector< RayHit > BoundingPartition::segmentCast(const glm::vec3& start,
+ const glm::vec3& end, unsigned int maxHits) {
+   glm::vec3 direction = end - start;
+   float length = glm::length(direction);
+   if (length < std::numeric_limits< float >::epsilon()) {
+      return std::vector< RayHit >();
+   }
+
+   return this->raycast(Line(start, direction), length, maxHits);
+}
+
+void BoundingPartition::queryRadius(const glm::vec3& center, float radius,
+ std::vector< Boundable* >& results) {
+   QueryTimer timer(this->_queryStatistics.radiusTime);
+   results.clear();
+   unsigned int stamp = this->nextStamp();
+
+   glm::vec3 dimensions = this->_boundingBox.getSize() /
+    glm::vec3(this->_partitions);
+   glm::vec3 point = this->toGridSpace(center);
+   glm::vec3 reach = glm::vec3(radius) / dimensions;
+   CellRange range = this->getCellRange(point - reach, point + reach);
+
+   // Only a sphere that reaches past the sides of the partition can touch
+   // anything outside of it.
+   if (range.isEmpty() || range.overhanging) {
+      for (const Cell* cell : { &this->_outside, &this->_overhanging }) {
+         for (unsigned int slot : *cell) {
+            if (this->_stamps[slot] == stamp) {
+               continue;
+            }
+            this->_stamps[slot] = stamp;
+
+            Boundable* boundable = this->_boundables[slot];
+            if (boundable->getBoundingBox()->getDistance(center) <= radius) {
+               results.push_back(boundable);
             }
          }
       }
    }
 
-   return accumulator;
+   if (range.isEmpty()) {
+      return;
+   }
+
+   for (unsigned int level = 0; level < this->_levels.size(); ++level) {
+      if (this->_levels[level].numBoundables == 0) {
+         continue;
+      }
+
+      CellRange levelRange = range.atLevel(level);
+      glm::ivec3 index;
+      for (index.z = levelRange.minimum.z; index.z <= levelRange.maximum.z;
+       ++index.z) {
+         for (index.y = levelRange.minimum.y;
+          index.y <= levelRange.maximum.y; ++index.y) {
+            for (index.x = levelRange.minimum.x;
+             index.x <= levelRange.maximum.x; ++index.x) {
+               const Cell& cell =
+                this->_cells[this->getCellIndex(index, level)];
+               for (unsigned int slot : cell) {
+                  if (this->_stamps[slot] == stamp) {
+                     continue;
+                  }
+                  this->_stamps[slot] = stamp;
+
+                  Boundable* boundable = this->_boundables[slot];
+                  if (boundable->getBoundingBox()->getDistance(center) <=
+                   radius) {
+                     results.push_back(boundable);
+                  }
+               }
+            }
+         }
+      }
+   }
 }
+
+void BoundingPartition::queryNearest(const glm::vec3& center,
+ unsigned int numNeighbors, std::vector< Boundable* >& results) {
+   QueryTimer timer(this->_queryStatistics.nearestTime);
+   results.clear();
+   if (numNeighbors == 0 || this->_slots.empty()) {
+      return;
+   }
+
+   this->_neighbors.clear();
+   unsigned int stamp = this->nextStamp();
+
+   // The nearest point of anything reaching outside of the partition may lie
+   // outside of every cell, so it is always measured.
+   for (unsigned int slot : this->_outside) {
+      this->measureNeighbor(slot, stamp, center);
+   }
+   for (unsigned int slot : this->_overhanging) {
+      this->measureNeighbor(slot, stamp, center);
+   }
+
+   // Coarse levels hold few Boundables, which are measured first so that the
+   // searches of finer levels may stop sooner.
+   for (unsigned int level = this->_levels.size(); level-- > 0;) {
+      if (this->_levels[level].numBoundables > 0) {
+         this->measureLevel(level, center, numNeighbors, stamp);
+      }
+   }
+
+   unsigned int numResults = std::min< std::size_t >(numNeighbors,
+    this->_neighbors.size());
+   std::partial_sort(this->_neighbors.begin(),
+    this->_neighbors.begin() + numResults, this->_neighbors.end());
+
+   results.reserve(numResults);
+   for (unsigned int ndx = 0; ndx < numResults; ++ndx) {
+      results.push_back(this->_boundables[this->_neighbors[ndx].second]);
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers.
+////////////////////////////////////////////////////////////////////////////////
+
+bool BoundingPartition::CellRange::isEmpty() const {
+   return glm::any(glm::greaterThan(this->minimum, this->maximum));
+}
+
+bool BoundingPartition::CellRange::contains(const glm::ivec3& index) const {
+   return glm::all(glm::greaterThanEqual(index, this->minimum)) &&
+    glm::all(glm::lessThanEqual(index, this->maximum));
+}
+
+bool BoundingPartition::CellRange::operator==(const CellRange& other) const {
+   if (this->isEmpty() || other.isEmpty()) {
+      return this->isEmpty() == other.isEmpty();
+   }
+
+   return this->minimum == other.minimum && this->maximum == other.maximum &&
+    this->overhanging == other.overhanging && this->level == other.level;
+}
+
+BoundingPartition::CellRange BoundingPartition::CellRange::atLevel(
+ unsigned int level) const {
+   // Every group of a level covers exactly two groups of the next finer level
+   // along each axis.
+   int shift = level - this->level;
+
+   CellRange range = *this;
+   range.minimum = glm::ivec3(this->minimum.x >> shift,
+    this->minimum.y >> shift, this->minimum.z >> shift);
+   range.maximum = glm::ivec3(this->maximum.x >> shift,
+    this->maximum.y >> shift, this->maximum.z >> shift);
+   range.level = level;
+   return range;
+}
+
+BoundingPartition::CellRange BoundingPartition::getCellRange(
+ Boundable* boundable) {
+   BoundingBox* boundingBox = boundable->getBoundingBox();
+   glm::vec3 position = boundingBox->getPosition();
+   glm::quat orientation = boundingBox->getOrientation();
+   glm::vec3 halfSize = boundingBox->getSize() * 0.5f;
+
+   // A moving box is replaced by the world-space extents it sweeps through.
+   if (this->_sweepInterval > 0.0f && boundingBox->isMoving()) {
+      BoundingBox::Extents extents =
+       boundingBox->getSweptExtents(this->_sweepInterval);
+      position = (extents[0] + extents[1]) * 0.5f;
+      orientation = NO_ROTATION;
+      halfSize = (extents[1] - extents[0]) * 0.5f;
+   }
+
+   // Express the box in the local space of the partition, where groups are
+   // axis-aligned and the minimum corner is at -size / 2. The extents of the
+   // rotated box along each local axis are the projections of its half-sizes.
+   glm::quat inverse = glm::conjugate(this->_boundingBox.getOrientation());
+   glm::vec3 center = inverse * (position - this->_boundingBox.getPosition());
+   glm::mat4 rotation = glm::mat4_cast(inverse * orientation);
+
+   glm::vec3 halfExtents;
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      halfExtents[axis] =
+       glm::abs(rotation[0][axis]) * halfSize[0] +
+       glm::abs(rotation[1][axis]) * halfSize[1] +
+       glm::abs(rotation[2][axis]) * halfSize[2];
+   }
+
+   glm::vec3 size = this->_boundingBox.getSize();
+   glm::vec3 dimensions = size / glm::vec3(this->_partitions);
+   glm::vec3 minimum = (center - halfExtents + size * 0.5f) / dimensions;
+   glm::vec3 maximum = (center + halfExtents + size * 0.5f) / dimensions;
+
+   CellRange range = this->getCellRange(minimum, maximum);
+   if (range.isEmpty()) {
+      return range;
+   }
+
+   // The groups of each level are twice as large as those of the last, so
+   // the finest level at which the extents fit within a group spans at most
+   // two groups along each axis.
+   glm::vec3 extents = maximum - minimum;
+   float extent = std::max(extents.x, std::max(extents.y, extents.z));
+   unsigned int level = 0;
+   while (level + 1 < this->_levels.size() && (float)(1 << level) < extent) {
+      ++level;
+   }
+
+   return range.atLevel(level);
+}
+
+BoundingPartition::CellRange BoundingPartition::getCellRange(
+ const glm::vec3& minimum, const glm::vec3& maximum) const {
+   CellRange range;
+   range.overhanging = false;
+   range.level = 0;
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      if (maximum[axis] < 0.0f || minimum[axis] >= this->_partitions[axis]) {
+         return EMPTY_RANGE;
+      }
+
+      range.overhanging |= minimum[axis] < 0.0f ||
+       maximum[axis] >= this->_partitions[axis];
+
+      range.minimum[axis] = std::max((int)std::floor(minimum[axis]), 0);
+      range.maximum[axis] = std::min((int)std::floor(maximum[axis]),
+       this->_partitions[axis] - 1);
+   }
+
+   return range;
+}
+
+glm::vec3 BoundingPartition::toGridSpace(const glm::vec3& point) const {
+   glm::quat inverse = glm::conjugate(this->_boundingBox.getOrientation());
+   glm::vec3 size = this->_boundingBox.getSize();
+   glm::vec3 dimensions = size / glm::vec3(this->_partitions);
+   return (inverse * (point - this->_boundingBox.getPosition()) +
+    size * 0.5f) / dimensions;
+}
+
+unsigned int BoundingPartition::getCellIndex(const glm::ivec3& index,
+ unsigned int level) const {
+   const Level& cellLevel = this->_levels[level];
+   return cellLevel.offset + linearize_index(index, cellLevel.partitions);
+}
+
+void BoundingPartition::addToRange(unsigned int slot, const CellRange& range,
+ const CellRange& exclude) {
+   // Cells of different levels never coincide.
+   bool sameLevel = exclude.level == range.level;
+
+   glm::ivec3 index;
+   for (index.z = range.minimum.z; index.z <= range.maximum.z; ++index.z) {
+      for (index.y = range.minimum.y; index.y <= range.maximum.y; ++index.y) {
+         for (index.x = range.minimum.x; index.x <= range.maximum.x;
+          ++index.x) {
+            if (!sameLevel || !exclude.contains(index)) {
+               Cell& cell = this->_cells[this->getCellIndex(index,
+                range.level)];
+               if (cell.empty()) {
+                  ++this->_numOccupied;
+               }
+               cell.push_back(slot);
+               ++this->_numMembers;
+            }
+         }
+      }
+   }
+}
+
+void BoundingPartition::removeFromRange(unsigned int slot,
+ const CellRange& range, const CellRange& exclude) {
+   bool sameLevel = exclude.level == range.level;
+
+   glm::ivec3 index;
+   for (index.z = range.minimum.z; index.z <= range.maximum.z; ++index.z) {
+      for (index.y = range.minimum.y; index.y <= range.maximum.y; ++index.y) {
+         for (index.x = range.minimum.x; index.x <= range.maximum.x;
+          ++index.x) {
+            if (!sameLevel || !exclude.contains(index)) {
+               Cell& cell = this->_cells[this->getCellIndex(index,
+                range.level)];
+               BoundingPartition::removeFromCell(cell, slot);
+               if (cell.empty()) {
+                  --this->_numOccupied;
+               }
+               --this->_numMembers;
+            }
+         }
+      }
+   }
+}
+
+template < typename Visitor >
+void BoundingPartition::forEachCellIndex(const CellRange& range,
+ const Visitor& visitor) const {
+   glm::ivec3 index;
+   for (index.z = range.minimum.z; index.z <= range.maximum.z; ++index.z) {
+      for (index.y = range.minimum.y; index.y <= range.maximum.y; ++index.y) {
+         for (index.x = range.minimum.x; index.x <= range.maximum.x;
+          ++index.x) {
+            visitor(this->getCellIndex(index, range.level));
+         }
+      }
+   }
+}
+
+template < typename Task >
+void BoundingPartition::runRanges(unsigned int numItems, const Task& task) {
+   if (numItems == 0) {
+      return;
+   }
+
+   if (this->_threadPool == nullptr ||
+    this->_threadPool->getNumThreads() == 1) {
+      task(0, numItems);
+      return;
+   }
+
+   unsigned int numTasks = std::min(numItems,
+    this->_threadPool->getNumThreads() * BoundingPartition::TASKS_PER_THREAD);
+   unsigned int itemsPerTask = (numItems + numTasks - 1) / numTasks;
+
+   this->_threadPool->run(numTasks,
+    [&task, numItems, itemsPerTask](unsigned int index, unsigned int) {
+      unsigned int begin = std::min(index * itemsPerTask, numItems);
+      unsigned int end = std::min(begin + itemsPerTask, numItems);
+      task(begin, end);
+   });
+}
+
+void BoundingPartition::getCandidateElements(unsigned int begin,
+ unsigned int end, std::vector< Collision >& candidates) const {
+   for (unsigned int level = 0; level < this->_levels.size(); ++level) {
+      const Level& cellLevel = this->_levels[level];
+      unsigned int levelEnd = (level + 1 < this->_levels.size()) ?
+       this->_levels[level + 1].offset : this->_cells.size();
+
+      // Pairs that share several cells are only reported by the cell at the
+      // minimum corner of the range both of them overlap.
+      for (unsigned int ndx = std::max(begin, cellLevel.offset);
+       ndx < std::min(end, levelEnd); ++ndx) {
+         // Only a cell of the coarsest level has no partners beyond its
+         // own members.
+         const Cell& cell = this->_cells[ndx];
+         if (cell.empty() ||
+          (cell.size() < 2 && level + 1 == this->_levels.size())) {
+            continue;
+         }
+
+         glm::ivec3 index =
+          vectorize_index(ndx - cellLevel.offset, cellLevel.partitions);
+
+         for (unsigned int a = 0; a < cell.size(); ++a) {
+            const CellRange& aRange = this->_cellRanges[cell[a]];
+            for (unsigned int b = a + 1; b < cell.size(); ++b) {
+               const CellRange& bRange = this->_cellRanges[cell[b]];
+               if (glm::max(aRange.minimum, bRange.minimum) != index) {
+                  continue;
+               }
+
+               Boundable* aBoundable = this->_boundables[cell[a]];
+               Boundable* bBoundable = this->_boundables[cell[b]];
+               if (aBoundable->isCollidable(bBoundable)) {
+                  candidates.push_back(Collision::factory(aBoundable,
+                   bBoundable));
+               }
+            }
+
+            // Each Boundable looks for coarser partners from its first cell.
+            if (aRange.minimum == index) {
+               this->getCoarserCandidateElements(cell[a], candidates);
+            }
+         }
+      }
+   }
+}
+
+void BoundingPartition::getCoarserCandidateElements(unsigned int slot,
+ std::vector< Collision >& candidates) const {
+   const CellRange& range = this->_cellRanges[slot];
+   Boundable* boundable = this->_boundables[slot];
+
+   for (unsigned int level = range.level + 1; level < this->_levels.size();
+    ++level) {
+      if (this->_levels[level].numBoundables == 0) {
+         continue;
+      }
+
+      // As within a level, a pair is only reported by the cell at the minimum
+      // corner of the range both of them overlap.
+      CellRange coarse = range.atLevel(level);
+      glm::ivec3 index;
+      for (index.z = coarse.minimum.z; index.z <= coarse.maximum.z;
+       ++index.z) {
+         for (index.y = coarse.minimum.y; index.y <= coarse.maximum.y;
+          ++index.y) {
+            for (index.x = coarse.minimum.x; index.x <= coarse.maximum.x;
+             ++index.x) {
+               const Cell& cell =
+                this->_cells[this->getCellIndex(index, level)];
+               for (unsigned int other : cell) {
+                  const CellRange& otherRange = this->_cellRanges[other];
+                  if (glm::max(coarse.minimum, otherRange.minimum) != index ||
+                   !boundable->isCollidable(this->_boundables[other])) {
+                     continue;
+                  }
+
+                  candidates.push_back(Collision::factory(boundable,
+                   this->_boundables[other]));
+               }
+            }
+         }
+      }
+   }
+}
+
+unsigned int BoundingPartition::getCollidingElementsParallel() const {
+   unsigned int numThreads = this->_threadPool->getNumThreads();
+   unsigned int numCells = this->_cells.size();
+   if (numCells == 0) {
+      this->_queryStatistics.numCandidates = 0;
+      this->_queryStatistics.numColliding = 0;
+      return 0;
+   }
+
+   unsigned int numTasks = std::min(numCells,
+    numThreads * BoundingPartition::TASKS_PER_THREAD);
+   unsigned int cellsPerTask = (numCells + numTasks - 1) / numTasks;
+
+   // A buffer per task preserves the serial order when concatenated, while a
+   // buffer per thread keeps fewer, larger buffers.
+   unsigned int numBuffers = this->_deterministic ? numTasks : numThreads;
+   if (this->_workers.size() < numThreads) {
+      this->_workers.resize(numThreads);
+   }
+   if (this->_buffers.size() < numBuffers) {
+      this->_buffers.resize(numBuffers);
+   }
+   for (unsigned int ndx = 0; ndx < numBuffers; ++ndx) {
+      this->_buffers[ndx].clear();
+   }
+   for (unsigned int ndx = 0; ndx < numThreads; ++ndx) {
+      this->_workers[ndx].numCandidates = 0;
+   }
+
+   this->_threadPool->run(numTasks,
+    [this, numCells, cellsPerTask](unsigned int task, unsigned int thread) {
+      Worker& worker = this->_workers[thread];
+      unsigned int begin = task * cellsPerTask;
+      unsigned int end = std::min(begin + cellsPerTask, numCells);
+
+      worker.candidates.clear();
+      this->getCandidateElements(begin, end, worker.candidates);
+      worker.narrowphase.collide(worker.candidates, worker.colliding,
+       this->_sweepInterval);
+      worker.numCandidates += worker.candidates.size();
+
+      std::vector< Collision >& buffer =
+       this->_buffers[this->_deterministic ? task : thread];
+      buffer.insert(buffer.end(), worker.colliding.begin(),
+       worker.colliding.end());
+   });
+
+   this->_queryStatistics.numCandidates = 0;
+   this->_queryStatistics.numColliding = 0;
+   for (unsigned int ndx = 0; ndx < numThreads; ++ndx) {
+      this->_queryStatistics.numCandidates += this->_workers[ndx].numCandidates;
+   }
+   for (unsigned int ndx = 0; ndx < numBuffers; ++ndx) {
+      this->_queryStatistics.numColliding += this->_buffers[ndx].size();
+   }
+
+   return numBuffers;
+}
+
+/* static */ unsigned int BoundingPartition::classifyBox(
+ const glm::vec3& center, const glm::vec3 halfAxes[3],
+ const ViewFrustum& viewFrustum, unsigned int parentMask) {
+   const ViewFrustum::Planes& planes = viewFrustum.getPlanes();
+
+   unsigned int planeMask = 0;
+   for (unsigned int ndx = 0; ndx < ViewFrustum::NUM_PLANES; ++ndx) {
+      if (!(parentMask & (1 << ndx))) {
+         continue;
+      }
+
+      const Plane& plane = planes[ndx];
+      float radius =
+       std::abs(glm::dot(plane.normal, halfAxes[0])) +
+       std::abs(glm::dot(plane.normal, halfAxes[1])) +
+       std::abs(glm::dot(plane.normal, halfAxes[2]));
+      float distance = plane.distance(center);
+
+      if (distance < -radius) {
+         return CULLED | ViewFrustum::ALL_PLANES;
+      } else if (distance < radius) {
+         planeMask |= (1 << ndx);
+      }
+   }
+
+   return planeMask;
+}
+
+unsigned int BoundingPartition::classifyPartition(
+ const ViewFrustum& viewFrustum) {
+   glm::mat4 rotation = glm::mat4_cast(this->_boundingBox.getOrientation());
+   glm::vec3 halfSize = this->_boundingBox.getSize() * 0.5f;
+   glm::vec3 halfAxes[3];
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      halfAxes[axis] = glm::vec3(rotation[axis]) * halfSize[axis];
+   }
+
+   return BoundingPartition::classifyBox(this->_boundingBox.getPosition(),
+    halfAxes, viewFrustum, ViewFrustum::ALL_PLANES);
+}
+
+bool BoundingPartition::isOutermost(unsigned int ndx) const {
+   unsigned int level = 0;
+   while (level + 1 < this->_levels.size() &&
+    ndx >= this->_levels[level + 1].offset) {
+      ++level;
+   }
+
+   const Level& cellLevel = this->_levels[level];
+   glm::ivec3 index = vectorize_index(ndx - cellLevel.offset,
+    cellLevel.partitions);
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      if (index[axis] == 0 || index[axis] == cellLevel.partitions[axis] - 1) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void BoundingPartition::classifyCells(unsigned int begin, unsigned int end,
+ const ViewFrustum& viewFrustum, unsigned int parentMask) {
+   // Every cell shares the orientation of the partition. Cells differ in
+   // size between levels and where coarse cells are clipped to its sides.
+   glm::mat4 rotation = glm::mat4_cast(this->_boundingBox.getOrientation());
+   glm::vec3 halfAxes[3];
+
+   for (unsigned int ndx = begin; ndx < end; ++ndx) {
+      if (this->_cells[ndx].empty()) {
+         this->_planeMasks[ndx] = CULLED | ViewFrustum::ALL_PLANES;
+         continue;
+      }
+
+      unsigned int planeMask = parentMask;
+      if (!(parentMask & CULLED)) {
+         const BoundingGroup& group = this->_boundingGroups[ndx];
+         glm::vec3 halfSize = group.getSize() * 0.5f;
+         for (unsigned int axis = 0; axis < 3; ++axis) {
+            halfAxes[axis] = glm::vec3(rotation[axis]) * halfSize[axis];
+         }
+
+         planeMask = BoundingPartition::classifyBox(group.getPosition(),
+          halfAxes, viewFrustum, parentMask);
+      }
+
+      if ((planeMask & CULLED) && this->isOutermost(ndx)) {
+         planeMask = ViewFrustum::ALL_PLANES;
+      }
+      this->_planeMasks[ndx] = planeMask;
+   }
+}
+
+unsigned int BoundingPartition::inspectRange(const CellRange& range,
+ int& owner) const {
+   unsigned int planeMask = range.overhanging ? ViewFrustum::ALL_PLANES : 0;
+   owner = -1;
+
+   glm::ivec3 index;
+   for (index.z = range.minimum.z; index.z <= range.maximum.z; ++index.z) {
+      for (index.y = range.minimum.y; index.y <= range.maximum.y; ++index.y) {
+         for (index.x = range.minimum.x; index.x <= range.maximum.x;
+          ++index.x) {
+            int ndx = this->getCellIndex(index, range.level);
+            unsigned int cellMask = this->_planeMasks[ndx];
+
+            if (owner < 0 && !(cellMask & CULLED)) {
+               owner = ndx;
+            }
+            planeMask |= cellMask & ViewFrustum::ALL_PLANES;
+
+            if (owner >= 0 && planeMask == ViewFrustum::ALL_PLANES) {
+               return planeMask;
+            }
+         }
+      }
+   }
+
+   return planeMask;
+}
+
+int BoundingPartition::findOwner(const CellRange& range) const {
+   glm::ivec3 index;
+   for (index.z = range.minimum.z; index.z <= range.maximum.z; ++index.z) {
+      for (index.y = range.minimum.y; index.y <= range.maximum.y; ++index.y) {
+         for (index.x = range.minimum.x; index.x <= range.maximum.x;
+          ++index.x) {
+            int ndx = this->getCellIndex(index, range.level);
+            if (!(this->_planeMasks[ndx] & CULLED)) {
+               return ndx;
+            }
+         }
+      }
+   }
+
+   return -1;
+}
+
+void BoundingPartition::getVisibleElements(unsigned int begin,
+ unsigned int end, const ViewFrustum& viewFrustum,
+ std::vector< Boundable* >& visible) {
+   for (unsigned int ndx = begin; ndx < end; ++ndx) {
+      if (this->_planeMasks[ndx] & CULLED) {
+         continue;
+      }
+
+      // Only the owning cell pays for combining the masks of the range.
+      for (unsigned int slot : this->_cells[ndx]) {
+         const CellRange& range = this->_cellRanges[slot];
+         if (this->findOwner(range) != (int)ndx) {
+            continue;
+         }
+
+         int owner;
+         unsigned int planeMask = this->inspectRange(range, owner);
+
+         Boundable* boundable = this->_boundables[slot];
+         if (boundable->isVisible(viewFrustum, planeMask)) {
+            visible.push_back(boundable);
+         }
+      }
+   }
+}
+
+unsigned int BoundingPartition::getVisibleElementsParallel(
+ const ViewFrustum& viewFrustum) {
+   unsigned int numCells = this->_cells.size();
+   if (numCells == 0) {
+      return 0;
+   }
+
+   unsigned int numTasks = std::min(numCells,
+    this->_threadPool->getNumThreads() * BoundingPartition::TASKS_PER_THREAD);
+   unsigned int cellsPerTask = (numCells + numTasks - 1) / numTasks;
+   unsigned int parentMask = this->classifyPartition(viewFrustum);
+
+   this->_threadPool->run(numTasks,
+    [this, &viewFrustum, numCells, cellsPerTask, parentMask](
+    unsigned int task, unsigned int) {
+      unsigned int begin = task * cellsPerTask;
+      unsigned int end = std::min(begin + cellsPerTask, numCells);
+      this->classifyCells(begin, end, viewFrustum, parentMask);
+   });
+
+   // Every Boundable is tested by the one cell that owns it, so no two tasks
+   // touch the same Boundable. A buffer per task keeps the serial order.
+   if (this->_visibleBuffers.size() < numTasks) {
+      this->_visibleBuffers.resize(numTasks);
+   }
+
+   this->_threadPool->run(numTasks,
+    [this, &viewFrustum, numCells, cellsPerTask](unsigned int task,
+    unsigned int) {
+      unsigned int begin = task * cellsPerTask;
+      unsigned int end = std::min(begin + cellsPerTask, numCells);
+
+      std::vector< Boundable* >& buffer = this->_visibleBuffers[task];
+      buffer.clear();
+      this->getVisibleElements(begin, end, viewFrustum, buffer);
+   });
+
+   return numTasks;
+}
+
+void BoundingPartition::castRay(unsigned int slot, unsigned int stamp,
+ const Line& ray, float maxDistance, std::vector< RayHit >& hits) {
+   if (this->_stamps[slot] == stamp) {
+      return;
+   }
+   this->_stamps[slot] = stamp;
+
+   Boundable* boundable = this->_boundables[slot];
+   auto distance = boundable->getBoundingBox()->intersectRay(ray);
+   if (distance && distance.get() <= maxDistance) {
+      hits.push_back(RayHit(boundable, distance.get()));
+   }
+}
+
+void BoundingPartition::castRayThroughLevel(unsigned int level,
+ const glm::vec3& point, const glm::vec3& direction, float entry, float exit,
+ unsigned int stamp, const Line& ray, float maxDistance, unsigned int maxHits,
+ std::vector< RayHit >& hits) {
+   // Every group of a level is 2^level groups of level 0 wide.
+   const glm::ivec3& partitions = this->_levels[level].partitions;
+   float scale = 1.0f / (float)(1 << level);
+   glm::vec3 levelPoint = point * scale;
+   glm::vec3 levelDirection = direction * scale;
+
+   glm::ivec3 index;
+   glm::ivec3 step;
+   glm::vec3 next;
+   glm::vec3 delta;
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      float start = levelPoint[axis] + levelDirection[axis] * entry;
+      index[axis] = std::min(std::max((int)std::floor(start), 0),
+       partitions[axis] - 1);
+
+      if (std::abs(levelDirection[axis]) <
+       std::numeric_limits< float >::epsilon()) {
+         step[axis] = 0;
+         next[axis] = std::numeric_limits< float >::max();
+         delta[axis] = std::numeric_limits< float >::max();
+      } else {
+         step[axis] = (levelDirection[axis] > 0.0f) ? 1 : -1;
+         float boundary = index[axis] + ((step[axis] > 0) ? 1 : 0);
+         next[axis] = (boundary - levelPoint[axis]) / levelDirection[axis];
+         delta[axis] = std::abs(1.0f / levelDirection[axis]);
+      }
+   }
+
+   while (true) {
+      int ndx = this->getCellIndex(index, level);
+      for (unsigned int slot : this->_cells[ndx]) {
+         this->castRay(slot, stamp, ray, maxDistance, hits);
+      }
+
+      unsigned int axis = (next.x < next.y) ?
+       ((next.x < next.z) ? 0 : 2) : ((next.y < next.z) ? 1 : 2);
+      float cellExit = std::min(next[axis], exit);
+
+      // Every point nearer than the exit from this cell has been covered, so
+      // nothing left in this level can be nearer than the hits before it.
+      if (hits.size() >= maxHits) {
+         unsigned int numFinal = std::count_if(hits.begin(), hits.end(),
+          [cellExit](const RayHit& hit) {
+            return hit.distance < cellExit;
+         });
+         if (numFinal >= maxHits) {
+            break;
+         }
+      }
+
+      if (next[axis] > exit) {
+         break;
+      }
+
+      index[axis] += step[axis];
+      next[axis] += delta[axis];
+      if (index[axis] < 0 || index[axis] >= partitions[axis]) {
+         break;
+      }
+   }
+}
+
+void BoundingPartition::measureNeighbor(unsigned int slot, unsigned int stamp,
+ const glm::vec3& center) {
+   if (this->_stamps[slot] == stamp) {
+      return;
+   }
+   this->_stamps[slot] = stamp;
+
+   float distance =
+    this->_boundables[slot]->getBoundingBox()->getDistance(center);
+   this->_neighbors.push_back(Neighbor(distance, slot));
+}
+
+void BoundingPartition::measureLevel(unsigned int level,
+ const glm::vec3& center, unsigned int numNeighbors, unsigned int stamp) {
+   // Every group of a level is 2^level groups of level 0 wide.
+   const glm::ivec3& partitions = this->_levels[level].partitions;
+   float scale = (float)(1 << level);
+   glm::vec3 dimensions = this->_boundingBox.getSize() /
+    glm::vec3(this->_partitions) * scale;
+   glm::vec3 point = this->toGridSpace(center) / scale;
+   glm::ivec3 origin = glm::ivec3(std::floor(point.x), std::floor(point.y),
+    std::floor(point.z));
+
+   // Skip the rings that lie entirely outside of the partition, and stop at
+   // the ring that covers all of it.
+   int firstRing = 0;
+   int lastRing = 0;
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      firstRing = std::max(firstRing, std::max(-origin[axis],
+       origin[axis] - (partitions[axis] - 1)));
+      lastRing = std::max(lastRing, std::max(origin[axis],
+       (partitions[axis] - 1) - origin[axis]));
+   }
+
+   for (int ring = firstRing; ring <= lastRing; ++ring) {
+      this->measureRing(level, origin, ring, stamp, center);
+
+      // Every cell not yet visited lies outside of the cube of rings visited
+      // so far, so nothing in it is nearer than the faces of that cube.
+      float bound = std::numeric_limits< float >::max();
+      for (unsigned int axis = 0; axis < 3; ++axis) {
+         float below = point[axis] - (origin[axis] - ring);
+         float above = (origin[axis] + ring + 1) - point[axis];
+         bound = std::min(bound, std::min(below, above) * dimensions[axis]);
+      }
+
+      if (this->_neighbors.size() >= numNeighbors) {
+         unsigned int numFinal = std::count_if(this->_neighbors.begin(),
+          this->_neighbors.end(), [bound](const Neighbor& neighbor) {
+            return neighbor.first <= bound;
+         });
+         if (numFinal >= numNeighbors) {
+            return;
+         }
+      }
+   }
+}
+
+void BoundingPartition::measureRing(unsigned int level,
+ const glm::ivec3& origin, int ring, unsigned int stamp,
+ const glm::vec3& center) {
+   glm::ivec3 lower = glm::max(origin - glm::ivec3(ring), glm::ivec3(0));
+   glm::ivec3 upper = glm::min(origin + glm::ivec3(ring),
+    this->_levels[level].partitions - glm::ivec3(1));
+
+   // Rows on the top, bottom, front, or back of the ring lie on it entirely.
+   // Every other row only meets it at its two ends, so the cells between them
+   // are skipped.
+   glm::ivec3 index;
+   for (index.z = lower.z; index.z <= upper.z; ++index.z) {
+      for (index.y = lower.y; index.y <= upper.y; ++index.y) {
+         bool isFace = std::abs(index.z - origin.z) == ring ||
+          std::abs(index.y - origin.y) == ring;
+
+         for (index.x = lower.x; index.x <= upper.x; ++index.x) {
+            if (!isFace && std::abs(index.x - origin.x) != ring) {
+               index.x = std::max(index.x, origin.x + ring - 1);
+               continue;
+            }
+
+            int ndx = this->getCellIndex(index, level);
+            for (unsigned int slot : this->_cells[ndx]) {
+               this->measureNeighbor(slot, stamp, center);
+            }
+         }
+      }
+   }
+}
+
+unsigned int BoundingPartition::nextStamp() const {
+   // Stamps are only compared for equality, so on wrapping around every slot
+   // is reset to a value that no later query will use.
+   if (++this->_stamp == 0) {
+      std::fill(this->_stamps.begin(), this->_stamps.end(), 0);
+      this->_stamp = 1;
+   }
+
+   return this->_stamp;
+}
+
+float BoundingPartition::getMeanMembers() const {
+   if (this->_numOccupied == 0) {
+      return 0.0f;
+   }
+   return (float)this->_numMembers / this->_numOccupied;
+}
+
+glm::ivec3 BoundingPartition::getBalancedPartitions() const {
+   if (this->_numOccupied == 0) {
+      return this->_partitions;
+   }
+
+   // Scaling the groups along every axis by some factor scales their volume,
+   // and roughly their number of members, by its cube. Groups are sized for
+   // half of the greatest mean so that small changes do not swing them back.
+   float meanMembers = this->getMeanMembers();
+   float target = this->_maxMembers * 0.5f;
+   float scale = std::cbrt(meanMembers / target);
+
+   glm::ivec3 partitions = this->_partitions;
+   if (meanMembers > this->_maxMembers) {
+      // Boundables clustered more tightly than any group share every group
+      // they fall in, so a split that did not lower the mean is not repeated.
+      if (this->_splitMembers > 0.0f && meanMembers >= this->_splitMembers) {
+         return this->_partitions;
+      }
+
+      for (unsigned int axis = 0; axis < 3; ++axis) {
+         partitions[axis] = std::min((int)std::ceil(partitions[axis] * scale),
+          BoundingPartition::MAX_PARTITIONS);
+      }
+
+      // Boundables outside of every group gain nothing from smaller groups,
+      // and groups beyond a few per remaining Boundable would mostly be
+      // empty. The axis split the most is trimmed first.
+      unsigned int numInside = this->getNumBoundables() -
+       this->_outside.size();
+      int maxCells = std::max(numInside *
+       BoundingPartition::MAX_CELLS_PER_BOUNDABLE, 1u);
+      while (partitions.x * partitions.y * partitions.z > maxCells) {
+         int axis = -1;
+         for (unsigned int ndx = 0; ndx < 3; ++ndx) {
+            if (partitions[ndx] > this->_partitions[ndx] &&
+             (axis < 0 || partitions[ndx] > partitions[axis])) {
+               axis = ndx;
+            }
+         }
+         if (axis < 0) {
+            break;
+         }
+         --partitions[axis];
+      }
+   } else if ((float)this->_numOccupied / this->_cells.size() <
+    this->_minOccupied && scale < 1.0f) {
+      // Groups that are mostly empty are only merged while the merged groups
+      // would stay below the target, lest they be split again.
+      for (unsigned int axis = 0; axis < 3; ++axis) {
+         partitions[axis] = std::max((int)std::floor(partitions[axis] * scale),
+          1);
+      }
+   }
+
+   return partitions;
+}
+
+void BoundingPartition::adopt(BoundingPartition& other) {
+   std::swap(this->_partitions, other._partitions);
+   this->_levels.swap(other._levels);
+   this->_boundingGroups.swap(other._boundingGroups);
+   this->_cells.swap(other._cells);
+   this->_outside.swap(other._outside);
+   this->_overhanging.swap(other._overhanging);
+   std::swap(this->_numOccupied, other._numOccupied);
+   std::swap(this->_numMembers, other._numMembers);
+   this->_boundables.swap(other._boundables);
+   this->_cellRanges.swap(other._cellRanges);
+   this->_stamps.swap(other._stamps);
+   this->_freeSlots.swap(other._freeSlots);
+   this->_slots.swap(other._slots);
+   std::swap(this->_stamp, other._stamp);
+}
+
+BoundingPartition::QueryTimer::QueryTimer(float& duration) :
+   _duration(duration), _start(std::chrono::steady_clock::now())
+{}
+
+BoundingPartition::QueryTimer::~QueryTimer() {
+   this->_duration = std::chrono::duration< float >(
+    std::chrono::steady_clock::now() - this->_start).count();
+}
+
+/* static */ void BoundingPartition::removeFromCell(Cell& cell,
+ unsigned int slot) {
+   auto itr = std::find(cell.begin(), cell.end(), slot);
+   if (itr != cell.end()) {
+      *itr = cell.back();
+      cell.pop_back();
+   }
+}
+
+/* static */ const unsigned int BoundingPartition::TASKS_PER_THREAD = 4;
+/* static */ const unsigned int BoundingPartition::REBALANCE_INTERVAL = 30;
+/* static */ const int BoundingPartition::MAX_PARTITIONS = 128;
+/* static */ const unsigned int BoundingPartition::MAX_CELLS_PER_BOUNDABLE = 4;
+/* static */ const unsigned int BoundingPartition::GROUPS_PER_MIGRATION = 8;
+/* static */ const unsigned int BoundingPartition::CULLED =
+ 1 << ViewFrustum::NUM_PLANES;
+
+/* static */ const BoundingPartition::CellRange
+ BoundingPartition::EMPTY_RANGE = {
+   glm::ivec3(0), glm::ivec3(-1), false, 0
+};
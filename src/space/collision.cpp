@@ -3,7 +3,7 @@
 using namespace crash::space;
 
 Collision::Collision(Boundable* first, Boundable* second) :
-   _first(first), _second(second)
+   _first(first), _second(second), _timeOfImpact(0.0f)
 {}
 
 /* virtual */ Collision::~Collision() {}
@@ -16,6 +16,14 @@ Boundable* Collision::getSecond() const {
    return this->_second;
 }
 
+float Collision::getTimeOfImpact() const {
+   return this->_timeOfImpact;
+}
+
+void Collision::setTimeOfImpact(float timeOfImpact) {
+   this->_timeOfImpact = timeOfImpact;
+}
+
 bool Collision::operator<(const Collision& other) const {
    return (this->_first == other._first) ? (this->_second < other._second) :
     (this->_first < other._first);
@@ -0,0 +1,574 @@
+#include <algorithm>
+#include <limits>
+#include <crash/render/view_frustum.hpp>
+#include <crash/space/boundable.hpp>
+#include <crash/space/dynamic_tree.hpp>
+#include <crash/space/util.hpp>
+
+using namespace crash::common;
+using namespace crash::space;
+using namespace crash::render;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+DynamicTree::DynamicTree(const DynamicTree& dynamicTree) :
+   _margin(dynamicTree._margin),
+    _root(dynamicTree._root),
+    _freeList(dynamicTree._freeList),
+    _nodes(dynamicTree._nodes),
+    _leaves(dynamicTree._leaves),
+    _narrowphase(),
+    _colliding()
+{}
+
+DynamicTree::DynamicTree() :
+   DynamicTree(DynamicTree::DEFAULT_MARGIN)
+{}
+
+DynamicTree::DynamicTree(float margin) :
+   _margin(margin), _root(NULL_NODE), _freeList(NULL_NODE), _nodes(),
+    _leaves(), _narrowphase(), _colliding()
+{}
+
+/* virtual */ DynamicTree::~DynamicTree() {}
+
+////////////////////////////////////////////////////////////////////////////////
+// SpatialIndex interface.
+////////////////////////////////////////////////////////////////////////////////
+
+bool DynamicTree::add(Boundable* boundable) {
+   if (this->_leaves.find(boundable) != this->_leaves.end()) {
+      return false;
+   }
+
+   int leaf = this->allocateNode();
+   Node& node = this->_nodes[leaf];
+   node.extents = this->getFattenedExtents(boundable);
+   node.boundable = boundable;
+   node.height = 0;
+
+   this->insertLeaf(leaf);
+   this->_leaves.insert(std::make_pair(boundable, leaf));
+   return true;
+}
+
+bool DynamicTree::remove(Boundable* boundable) {
+   auto itr = this->_leaves.find(boundable);
+   if (itr == this->_leaves.end()) {
+      return false;
+   }
+
+   int leaf = itr->second;
+   this->_leaves.erase(itr);
+
+   this->removeLeaf(leaf);
+   this->freeNode(leaf);
+   return true;
+}
+
+bool DynamicTree::update(Boundable* boundable) {
+   auto itr = this->_leaves.find(boundable);
+   if (itr == this->_leaves.end()) {
+      return this->add(boundable);
+   }
+
+   int leaf = itr->second;
+   const BoundingBox::Extents& extents =
+    boundable->getBoundingBox()->getExtents();
+   if (DynamicTree::contains(this->_nodes[leaf].extents, extents)) {
+      return false;
+   }
+
+   this->removeLeaf(leaf);
+   this->_nodes[leaf].extents = this->getFattenedExtents(boundable);
+   this->insertLeaf(leaf);
+   return true;
+}
+
+void DynamicTree::clear() {
+   this->_root = NULL_NODE;
+   this->_freeList = NULL_NODE;
+   this->_nodes.clear();
+   this->_leaves.clear();
+}
+
+unsigned int DynamicTree::getNumBoundables() const {
+   return this->_leaves.size();
+}
+
+std::vector< Boundable* > DynamicTree::getBoundables() const {
+   std::vector< Boundable* > accumulator;
+   accumulator.reserve(this->_leaves.size());
+
+   for (const Node& node : this->_nodes) {
+      if (node.height == 0) {
+         accumulator.push_back(node.boundable);
+      }
+   }
+
+   return accumulator;
+}
+
+void DynamicTree::forEachBoundable(const BoundableVisitor& visitor) const {
+   for (const Node& node : this->_nodes) {
+      if (node.height == 0) {
+         visitor(node.boundable);
+      }
+   }
+}
+
+std::vector< Collision > DynamicTree::getCandidateElements() const {
+   std::vector< Collision > candidates;
+   if (this->_root == NULL_NODE) {
+      return candidates;
+   }
+
+   std::vector< int > stack;
+
+   // Query the tree with the extents of every leaf. A pair is only reported
+   // from the leaf with the lower index so that each is found once.
+   for (int leaf = 0; leaf < (int)this->_nodes.size(); ++leaf) {
+      const Node& query = this->_nodes[leaf];
+      if (query.height != 0) {
+         continue;
+      }
+
+      stack.push_back(this->_root);
+      while (!stack.empty()) {
+         int index = stack.back();
+         stack.pop_back();
+
+         const Node& node = this->_nodes[index];
+         if (!extents_overlap(node.extents, query.extents)) {
+            continue;
+         }
+
+         if (node.isLeaf()) {
+            if (index > leaf && query.boundable->isCollidable(node.boundable)) {
+               candidates.push_back(Collision::factory(query.boundable,
+                node.boundable));
+            }
+         } else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+         }
+      }
+   }
+
+   return candidates;
+}
+
+std::vector< Collision > DynamicTree::getCollidingElements() const {
+   std::vector< Collision > accumulator;
+   this->_narrowphase.collide(this->getCandidateElements(), accumulator);
+   return accumulator;
+}
+
+void DynamicTree::forEachPair(const CollisionVisitor& visitor) const {
+   this->_narrowphase.collide(this->getCandidateElements(), this->_colliding);
+   for (const Collision& collision : this->_colliding) {
+      visitor(collision);
+   }
+}
+
+std::vector< Boundable* > DynamicTree::getVisibleElements(
+ const ViewFrustum& viewFrustum) {
+   std::vector< Boundable* > accumulator;
+   this->forEachVisible(viewFrustum, [&accumulator](Boundable* boundable) {
+      accumulator.push_back(boundable);
+   });
+   return accumulator;
+}
+
+void DynamicTree::forEachVisible(const ViewFrustum& viewFrustum,
+ const BoundableVisitor& visitor) {
+   if (this->_root == NULL_NODE) {
+      return;
+   }
+
+   std::vector< int > stack;
+   stack.push_back(this->_root);
+   while (!stack.empty()) {
+      int index = stack.back();
+      stack.pop_back();
+
+      const Node& node = this->_nodes[index];
+      if (!extents_visible(node.extents, viewFrustum)) {
+         continue;
+      }
+
+      if (node.isLeaf()) {
+         if (node.boundable->isVisible(viewFrustum)) {
+            visitor(node.boundable);
+         }
+      } else {
+         stack.push_back(node.child1);
+         stack.push_back(node.child2);
+      }
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Queries.
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector< RayHit > DynamicTree::raycast(const Line& ray,
+ float maxDistance) {
+   std::vector< RayHit > hits;
+   if (this->_root == NULL_NODE) {
+      return hits;
+   }
+
+   Line normalized(ray.point, glm::normalize(ray.direction));
+
+   std::vector< int > stack;
+   stack.push_back(this->_root);
+   while (!stack.empty()) {
+      int index = stack.back();
+      stack.pop_back();
+
+      const Node& node = this->_nodes[index];
+      if (!DynamicTree::intersectRay(node.extents, normalized, maxDistance)) {
+         continue;
+      }
+
+      if (node.isLeaf()) {
+         auto distance =
+          node.boundable->getBoundingBox()->intersectRay(normalized);
+         if (distance && distance.get() <= maxDistance) {
+            hits.push_back(RayHit(node.boundable, distance.get()));
+         }
+      } else {
+         stack.push_back(node.child1);
+         stack.push_back(node.child2);
+      }
+   }
+
+   std::sort(hits.begin(), hits.end());
+   return hits;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data access.
+////////////////////////////////////////////////////////////////////////////////
+
+float DynamicTree::getMargin() const {
+   return this->_margin;
+}
+
+unsigned int DynamicTree::getHeight() const {
+   if (this->_root == NULL_NODE) {
+      return 0;
+   }
+
+   return this->_nodes[this->_root].height + 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers.
+////////////////////////////////////////////////////////////////////////////////
+
+bool DynamicTree::Node::isLeaf() const {
+   return this->child1 == NULL_NODE;
+}
+
+int DynamicTree::allocateNode() {
+   int index;
+   if (this->_freeList == NULL_NODE) {
+      index = this->_nodes.size();
+      this->_nodes.push_back(Node());
+   } else {
+      index = this->_freeList;
+      this->_freeList = this->_nodes[index].parent;
+   }
+
+   Node& node = this->_nodes[index];
+   node.boundable = nullptr;
+   node.parent = NULL_NODE;
+   node.child1 = NULL_NODE;
+   node.child2 = NULL_NODE;
+   node.height = 0;
+   return index;
+}
+
+void DynamicTree::freeNode(int index) {
+   Node& node = this->_nodes[index];
+   node.boundable = nullptr;
+   node.parent = this->_freeList;
+   node.height = -1;
+   this->_freeList = index;
+}
+
+void DynamicTree::insertLeaf(int leaf) {
+   if (this->_root == NULL_NODE) {
+      this->_root = leaf;
+      this->_nodes[leaf].parent = NULL_NODE;
+      return;
+   }
+
+   // Descend towards the sibling that minimizes the added surface area. The
+   // cost of pairing with a node is the area of the new parent, plus the
+   // increase in area inherited by every ancestor of that node.
+   const BoundingBox::Extents extents = this->_nodes[leaf].extents;
+   int index = this->_root;
+   while (!this->_nodes[index].isLeaf()) {
+      const Node& node = this->_nodes[index];
+
+      float area = DynamicTree::surfaceArea(node.extents);
+      float combinedArea = DynamicTree::surfaceArea(
+       DynamicTree::combine(node.extents, extents));
+
+      float cost = 2.0f * combinedArea;
+      float inheritanceCost = 2.0f * (combinedArea - area);
+
+      float childCosts[2];
+      int children[2] = { node.child1, node.child2 };
+      for (unsigned int ndx = 0; ndx < 2; ++ndx) {
+         const Node& child = this->_nodes[children[ndx]];
+         float childArea = DynamicTree::surfaceArea(
+          DynamicTree::combine(child.extents, extents));
+         if (!child.isLeaf()) {
+            childArea -= DynamicTree::surfaceArea(child.extents);
+         }
+         childCosts[ndx] = childArea + inheritanceCost;
+      }
+
+      if (cost < childCosts[0] && cost < childCosts[1]) {
+         break;
+      }
+
+      index = (childCosts[0] < childCosts[1]) ? children[0] : children[1];
+   }
+
+   int sibling = index;
+   int oldParent = this->_nodes[sibling].parent;
+   int newParent = this->allocateNode();
+
+   this->_nodes[newParent].parent = oldParent;
+   this->_nodes[newParent].extents = DynamicTree::combine(extents,
+    this->_nodes[sibling].extents);
+   this->_nodes[newParent].height = this->_nodes[sibling].height + 1;
+   this->_nodes[newParent].child1 = sibling;
+   this->_nodes[newParent].child2 = leaf;
+   this->_nodes[sibling].parent = newParent;
+   this->_nodes[leaf].parent = newParent;
+
+   if (oldParent == NULL_NODE) {
+      this->_root = newParent;
+   } else if (this->_nodes[oldParent].child1 == sibling) {
+      this->_nodes[oldParent].child1 = newParent;
+   } else {
+      this->_nodes[oldParent].child2 = newParent;
+   }
+
+   this->refit(this->_nodes[leaf].parent);
+}
+
+void DynamicTree::removeLeaf(int leaf) {
+   if (leaf == this->_root) {
+      this->_root = NULL_NODE;
+      return;
+   }
+
+   int parent = this->_nodes[leaf].parent;
+   int grandParent = this->_nodes[parent].parent;
+   int sibling = (this->_nodes[parent].child1 == leaf) ?
+    this->_nodes[parent].child2 : this->_nodes[parent].child1;
+
+   if (grandParent == NULL_NODE) {
+      this->_root = sibling;
+      this->_nodes[sibling].parent = NULL_NODE;
+      this->freeNode(parent);
+      return;
+   }
+
+   if (this->_nodes[grandParent].child1 == parent) {
+      this->_nodes[grandParent].child1 = sibling;
+   } else {
+      this->_nodes[grandParent].child2 = sibling;
+   }
+   this->_nodes[sibling].parent = grandParent;
+   this->freeNode(parent);
+
+   this->refit(grandParent);
+}
+
+void DynamicTree::refit(int index) {
+   while (index != NULL_NODE) {
+      index = this->balance(index);
+
+      Node& node = this->_nodes[index];
+      const Node& child1 = this->_nodes[node.child1];
+      const Node& child2 = this->_nodes[node.child2];
+
+      node.height = 1 + std::max(child1.height, child2.height);
+      node.extents = DynamicTree::combine(child1.extents, child2.extents);
+
+      index = node.parent;
+   }
+}
+
+int DynamicTree::balance(int iA) {
+   Node& a = this->_nodes[iA];
+   if (a.isLeaf() || a.height < 2) {
+      return iA;
+   }
+
+   int iB = a.child1;
+   int iC = a.child2;
+   Node& b = this->_nodes[iB];
+   Node& c = this->_nodes[iC];
+
+   int difference = c.height - b.height;
+
+   // Rotate C up.
+   if (difference > 1) {
+      int iF = c.child1;
+      int iG = c.child2;
+      Node& f = this->_nodes[iF];
+      Node& g = this->_nodes[iG];
+
+      c.child1 = iA;
+      c.parent = a.parent;
+      a.parent = iC;
+
+      if (c.parent == NULL_NODE) {
+         this->_root = iC;
+      } else if (this->_nodes[c.parent].child1 == iA) {
+         this->_nodes[c.parent].child1 = iC;
+      } else {
+         this->_nodes[c.parent].child2 = iC;
+      }
+
+      if (f.height > g.height) {
+         c.child2 = iF;
+         a.child2 = iG;
+         g.parent = iA;
+         a.extents = DynamicTree::combine(b.extents, g.extents);
+         c.extents = DynamicTree::combine(a.extents, f.extents);
+         a.height = 1 + std::max(b.height, g.height);
+         c.height = 1 + std::max(a.height, f.height);
+      } else {
+         c.child2 = iG;
+         a.child2 = iF;
+         f.parent = iA;
+         a.extents = DynamicTree::combine(b.extents, f.extents);
+         c.extents = DynamicTree::combine(a.extents, g.extents);
+         a.height = 1 + std::max(b.height, f.height);
+         c.height = 1 + std::max(a.height, g.height);
+      }
+
+      return iC;
+   }
+
+   // Rotate B up.
+   if (difference < -1) {
+      int iD = b.child1;
+      int iE = b.child2;
+      Node& d = this->_nodes[iD];
+      Node& e = this->_nodes[iE];
+
+      b.child1 = iA;
+      b.parent = a.parent;
+      a.parent = iB;
+
+      if (b.parent == NULL_NODE) {
+         this->_root = iB;
+      } else if (this->_nodes[b.parent].child1 == iA) {
+         this->_nodes[b.parent].child1 = iB;
+      } else {
+         this->_nodes[b.parent].child2 = iB;
+      }
+
+      if (d.height > e.height) {
+         b.child2 = iD;
+         a.child1 = iE;
+         e.parent = iA;
+         a.extents = DynamicTree::combine(c.extents, e.extents);
+         b.extents = DynamicTree::combine(a.extents, d.extents);
+         a.height = 1 + std::max(c.height, e.height);
+         b.height = 1 + std::max(a.height, d.height);
+      } else {
+         b.child2 = iE;
+         a.child1 = iD;
+         d.parent = iA;
+         a.extents = DynamicTree::combine(c.extents, d.extents);
+         b.extents = DynamicTree::combine(a.extents, e.extents);
+         a.height = 1 + std::max(c.height, d.height);
+         b.height = 1 + std::max(a.height, e.height);
+      }
+
+      return iB;
+   }
+
+   return iA;
+}
+
+BoundingBox::Extents DynamicTree::getFattenedExtents(
+ Boundable* boundable) const {
+   const BoundingBox::Extents& extents =
+    boundable->getBoundingBox()->getExtents();
+   glm::vec3 margin = glm::vec3(this->_margin);
+   return BoundingBox::Extents {{ extents[0] - margin, extents[1] + margin }};
+}
+
+/* static */ BoundingBox::Extents DynamicTree::combine(
+ const BoundingBox::Extents& a, const BoundingBox::Extents& b) {
+   return BoundingBox::Extents {{
+      glm::min(a[0], b[0]),
+      glm::max(a[1], b[1]),
+   }};
+}
+
+/* static */ float DynamicTree::surfaceArea(
+ const BoundingBox::Extents& extents) {
+   glm::vec3 size = extents[1] - extents[0];
+   return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+/* static */ bool DynamicTree::contains(const BoundingBox::Extents& outer,
+ const BoundingBox::Extents& inner) {
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      if (inner[0][axis] < outer[0][axis] || inner[1][axis] > outer[1][axis]) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+/* static */ bool DynamicTree::intersectRay(
+ const BoundingBox::Extents& extents, const Line& ray, float maxDistance) {
+   float entry = 0.0f;
+   float exit = maxDistance;
+
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      float origin = ray.point[axis];
+      float slope = ray.direction[axis];
+
+      if (std::abs(slope) < std::numeric_limits< float >::epsilon()) {
+         if (origin < extents[0][axis] || origin > extents[1][axis]) {
+            return false;
+         }
+         continue;
+      }
+
+      float near = (extents[0][axis] - origin) / slope;
+      float far = (extents[1][axis] - origin) / slope;
+      if (near > far) {
+         std::swap(near, far);
+      }
+
+      entry = std::max(entry, near);
+      exit = std::min(exit, far);
+      if (entry > exit) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+/* static */ const float DynamicTree::DEFAULT_MARGIN = 0.1f;
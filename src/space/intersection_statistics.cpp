@@ -0,0 +1,120 @@
+#include <atomic>
+#include <crash/space/intersection_statistics.hpp>
+
+using namespace crash::space;
+
+namespace {
+
+// The totals shared by every thread. Counters are only added to, so relaxed
+// ordering suffices; a snapshot taken during a query may be mid-update.
+std::atomic< bool > enabled(false);
+std::atomic< unsigned long > totalTests(0);
+std::atomic< unsigned long > totalSphereRejects(0);
+std::array< std::atomic< unsigned long >,
+ BoundingBox::NUM_SEPARATING_AXES > totalSeparations;
+std::atomic< unsigned long > totalIntersections(0);
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+IntersectionStatistics::IntersectionStatistics(
+ const IntersectionStatistics& statistics) :
+   numTests(statistics.numTests),
+    numSphereRejects(statistics.numSphereRejects),
+    numSeparations(statistics.numSeparations),
+    numIntersections(statistics.numIntersections)
+{}
+
+IntersectionStatistics::IntersectionStatistics() :
+   numTests(0), numSphereRejects(0), numSeparations(), numIntersections(0)
+{
+   this->numSeparations.fill(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data access.
+////////////////////////////////////////////////////////////////////////////////
+
+float IntersectionStatistics::getSphereRejectRate() const {
+   if (this->numTests == 0) {
+      return 0.0f;
+   }
+
+   return (float)this->numSphereRejects / this->numTests;
+}
+
+IntersectionStatistics& IntersectionStatistics::operator+=(
+ const IntersectionStatistics& other) {
+   this->numTests += other.numTests;
+   this->numSphereRejects += other.numSphereRejects;
+   for (unsigned int axis = 0; axis < this->numSeparations.size(); ++axis) {
+      this->numSeparations[axis] += other.numSeparations[axis];
+   }
+   this->numIntersections += other.numIntersections;
+   return *this;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Collection.
+////////////////////////////////////////////////////////////////////////////////
+
+/* static */ void IntersectionStatistics::setCollecting(bool collecting) {
+   enabled.store(collecting, std::memory_order_relaxed);
+}
+
+/* static */ bool IntersectionStatistics::isCollecting() {
+   return enabled.load(std::memory_order_relaxed);
+}
+
+/* static */ IntersectionStatistics IntersectionStatistics::getCollected() {
+   IntersectionStatistics statistics;
+   statistics.numTests = totalTests.load(std::memory_order_relaxed);
+   statistics.numSphereRejects =
+    totalSphereRejects.load(std::memory_order_relaxed);
+   for (unsigned int axis = 0; axis < totalSeparations.size(); ++axis) {
+      statistics.numSeparations[axis] =
+       totalSeparations[axis].load(std::memory_order_relaxed);
+   }
+   statistics.numIntersections =
+    totalIntersections.load(std::memory_order_relaxed);
+   return statistics;
+}
+
+/* static */ void IntersectionStatistics::resetCollected() {
+   totalTests.store(0, std::memory_order_relaxed);
+   totalSphereRejects.store(0, std::memory_order_relaxed);
+   for (std::atomic< unsigned long >& count : totalSeparations) {
+      count.store(0, std::memory_order_relaxed);
+   }
+   totalIntersections.store(0, std::memory_order_relaxed);
+}
+
+/* static */ void IntersectionStatistics::collect(
+ const IntersectionStatistics& statistics) {
+   totalTests.fetch_add(statistics.numTests, std::memory_order_relaxed);
+   totalSphereRejects.fetch_add(statistics.numSphereRejects,
+    std::memory_order_relaxed);
+   for (unsigned int axis = 0; axis < totalSeparations.size(); ++axis) {
+      if (statistics.numSeparations[axis] > 0) {
+         totalSeparations[axis].fetch_add(statistics.numSeparations[axis],
+          std::memory_order_relaxed);
+      }
+   }
+   totalIntersections.fetch_add(statistics.numIntersections,
+    std::memory_order_relaxed);
+}
+
+/* static */ void IntersectionStatistics::collect(bool sphereReject,
+ int separatingAxis) {
+   totalTests.fetch_add(1, std::memory_order_relaxed);
+   if (sphereReject) {
+      totalSphereRejects.fetch_add(1, std::memory_order_relaxed);
+   } else if (separatingAxis == BoundingBox::NO_AXIS) {
+      totalIntersections.fetch_add(1, std::memory_order_relaxed);
+   } else {
+      totalSeparations[separatingAxis].fetch_add(1, std::memory_order_relaxed);
+   }
+}
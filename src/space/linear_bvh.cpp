@@ -0,0 +1,536 @@
+#include <algorithm>
+#include <limits>
+#include <crash/common/thread_pool.hpp>
+#include <crash/render/view_frustum.hpp>
+#include <crash/space/boundable.hpp>
+#include <crash/space/linear_bvh.hpp>
+#include <crash/space/util.hpp>
+
+using namespace crash::common;
+using namespace crash::space;
+using namespace crash::render;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+LinearBVH::LinearBVH(const LinearBVH& linearBVH) :
+   _boundables(linearBVH._boundables),
+    _indices(linearBVH._indices),
+    _threadPool(linearBVH._threadPool),
+    _isStale(true),
+    _nodes(),
+    _extents(),
+    _primitives(),
+    _sortBuffer(),
+    _candidateBuffers(),
+    _narrowphase(),
+    _candidates(),
+    _colliding()
+{}
+
+LinearBVH::LinearBVH() :
+   _boundables(), _indices(), _threadPool(nullptr), _isStale(false), _nodes(),
+    _extents(), _primitives(), _sortBuffer(), _candidateBuffers(),
+    _narrowphase(), _candidates(), _colliding()
+{}
+
+/* virtual */ LinearBVH::~LinearBVH() {}
+
+////////////////////////////////////////////////////////////////////////////////
+// SpatialIndex interface.
+////////////////////////////////////////////////////////////////////////////////
+
+bool LinearBVH::add(Boundable* boundable) {
+   if (this->_indices.find(boundable) != this->_indices.end()) {
+      return false;
+   }
+
+   this->_indices.insert(std::make_pair(boundable, this->_boundables.size()));
+   this->_boundables.push_back(boundable);
+   this->_isStale = true;
+   return true;
+}
+
+bool LinearBVH::remove(Boundable* boundable) {
+   auto itr = this->_indices.find(boundable);
+   if (itr == this->_indices.end()) {
+      return false;
+   }
+
+   unsigned int index = itr->second;
+   this->_indices.erase(itr);
+
+   Boundable* moved = this->_boundables.back();
+   this->_boundables[index] = moved;
+   this->_boundables.pop_back();
+   if (moved != boundable) {
+      this->_indices[moved] = index;
+   }
+
+   this->_isStale = true;
+   return true;
+}
+
+bool LinearBVH::update(Boundable* boundable) {
+   if (this->_indices.find(boundable) == this->_indices.end()) {
+      return this->add(boundable);
+   }
+
+   this->_isStale = true;
+   return false;
+}
+
+void LinearBVH::clear() {
+   this->_boundables.clear();
+   this->_indices.clear();
+   this->_nodes.clear();
+   this->_extents.clear();
+   this->_primitives.clear();
+   this->_isStale = false;
+}
+
+unsigned int LinearBVH::getNumBoundables() const {
+   return this->_boundables.size();
+}
+
+std::vector< Boundable* > LinearBVH::getBoundables() const {
+   return this->_boundables;
+}
+
+void LinearBVH::forEachBoundable(const BoundableVisitor& visitor) const {
+   for (Boundable* boundable : this->_boundables) {
+      visitor(boundable);
+   }
+}
+
+std::vector< Collision > LinearBVH::getCandidateElements() const {
+   this->refresh();
+
+   unsigned int numLeaves = this->_primitives.size();
+   unsigned int maxTasks = (this->_threadPool == nullptr) ? 1 :
+    this->_threadPool->getNumThreads() * LinearBVH::TASKS_PER_THREAD;
+   if (this->_candidateBuffers.size() < maxTasks) {
+      this->_candidateBuffers.resize(maxTasks);
+   }
+
+   // Every leaf only reports pairs with the leaves after it, so each task
+   // fills its own buffer and the buffers are joined in order.
+   unsigned int numTasks = this->runRanges(numLeaves,
+    [this](unsigned int task, unsigned int begin, unsigned int end) {
+      std::vector< Collision >& buffer = this->_candidateBuffers[task];
+      buffer.clear();
+      this->getCandidateElements(begin, end, buffer);
+   });
+
+   std::size_t numCandidates = 0;
+   for (unsigned int task = 0; task < numTasks; ++task) {
+      numCandidates += this->_candidateBuffers[task].size();
+   }
+
+   std::vector< Collision > candidates;
+   candidates.reserve(numCandidates);
+   for (unsigned int task = 0; task < numTasks; ++task) {
+      const std::vector< Collision >& buffer = this->_candidateBuffers[task];
+      candidates.insert(candidates.end(), buffer.begin(), buffer.end());
+   }
+
+   return candidates;
+}
+
+std::vector< Collision > LinearBVH::getCollidingElements() const {
+   std::vector< Collision > accumulator;
+   this->_narrowphase.collide(this->getCandidateElements(), accumulator);
+   return accumulator;
+}
+
+void LinearBVH::forEachPair(const CollisionVisitor& visitor) const {
+   this->_narrowphase.collide(this->getCandidateElements(), this->_colliding);
+   for (const Collision& collision : this->_colliding) {
+      visitor(collision);
+   }
+}
+
+std::vector< Boundable* > LinearBVH::getVisibleElements(
+ const ViewFrustum& viewFrustum) {
+   std::vector< Boundable* > accumulator;
+   this->forEachVisible(viewFrustum, [&accumulator](Boundable* boundable) {
+      accumulator.push_back(boundable);
+   });
+   return accumulator;
+}
+
+void LinearBVH::forEachVisible(const ViewFrustum& viewFrustum,
+ const BoundableVisitor& visitor) {
+   this->refresh();
+   if (this->_nodes.empty()) {
+      return;
+   }
+
+   std::vector< unsigned int > stack;
+   stack.push_back(0);
+   while (!stack.empty()) {
+      unsigned int index = stack.back();
+      stack.pop_back();
+
+      const Node& node = this->_nodes[index];
+      if (!extents_visible(node.extents, viewFrustum)) {
+         continue;
+      }
+
+      if (this->isLeaf(index)) {
+         if (node.boundable->isVisible(viewFrustum)) {
+            visitor(node.boundable);
+         }
+      } else {
+         stack.push_back(node.child2);
+         stack.push_back(node.child1);
+      }
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Construction.
+////////////////////////////////////////////////////////////////////////////////
+
+void LinearBVH::build() {
+   this->_isStale = true;
+   this->refresh();
+}
+
+bool LinearBVH::isStale() const {
+   return this->_isStale;
+}
+
+void LinearBVH::setThreadPool(ThreadPool* threadPool) {
+   this->_threadPool = threadPool;
+}
+
+ThreadPool* LinearBVH::getThreadPool() const {
+   return this->_threadPool;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data access.
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int LinearBVH::getNumNodes() const {
+   this->refresh();
+   return this->_nodes.size();
+}
+
+unsigned int LinearBVH::getHeight() const {
+   this->refresh();
+   if (this->_nodes.empty()) {
+      return 0;
+   }
+
+   unsigned int height = 0;
+   std::vector< std::pair< unsigned int, unsigned int > > stack;
+   stack.push_back(std::make_pair(0u, 1u));
+   while (!stack.empty()) {
+      unsigned int index = stack.back().first;
+      unsigned int depth = stack.back().second;
+      stack.pop_back();
+
+      height = std::max(height, depth);
+      if (!this->isLeaf(index)) {
+         const Node& node = this->_nodes[index];
+         stack.push_back(std::make_pair(node.child1, depth + 1));
+         stack.push_back(std::make_pair(node.child2, depth + 1));
+      }
+   }
+
+   return height;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers.
+////////////////////////////////////////////////////////////////////////////////
+
+void LinearBVH::refresh() const {
+   if (!this->_isStale) {
+      return;
+   }
+   this->_isStale = false;
+
+   unsigned int numLeaves = this->_boundables.size();
+   this->_extents.resize(numLeaves);
+   this->_primitives.resize(numLeaves);
+   if (numLeaves == 0) {
+      this->_nodes.clear();
+      return;
+   }
+
+   this->runRanges(numLeaves,
+    [this](unsigned int, unsigned int begin, unsigned int end) {
+      for (unsigned int index = begin; index < end; ++index) {
+         this->_extents[index] =
+          this->_boundables[index]->getBoundingBox()->getExtents();
+      }
+   });
+
+   // Codes are quantized within the bounds of the centers of the scene.
+   glm::vec3 minimum(std::numeric_limits< float >::max());
+   glm::vec3 maximum(-std::numeric_limits< float >::max());
+   for (const BoundingBox::Extents& extents : this->_extents) {
+      glm::vec3 center = (extents[0] + extents[1]) * 0.5f;
+      minimum = glm::min(minimum, center);
+      maximum = glm::max(maximum, center);
+   }
+   glm::vec3 scale = 1.0f / glm::max(maximum - minimum,
+    glm::vec3(std::numeric_limits< float >::epsilon()));
+
+   this->runRanges(numLeaves,
+    [this, &minimum, &scale](unsigned int, unsigned int begin,
+    unsigned int end) {
+      for (unsigned int index = begin; index < end; ++index) {
+         const BoundingBox::Extents& extents = this->_extents[index];
+         glm::vec3 center = (extents[0] + extents[1]) * 0.5f;
+
+         Primitive& primitive = this->_primitives[index];
+         primitive.code = LinearBVH::getMortonCode((center - minimum) * scale);
+         primitive.index = index;
+      }
+   });
+
+   this->sortPrimitives();
+
+   this->_nodes.resize(2 * numLeaves - 1);
+   this->runRanges(numLeaves,
+    [this, numLeaves](unsigned int, unsigned int begin, unsigned int end) {
+      for (unsigned int position = begin; position < end; ++position) {
+         unsigned int index = this->_primitives[position].index;
+         Node& leaf = this->_nodes[numLeaves - 1 + position];
+         leaf.extents = this->_extents[index];
+         leaf.child1 = 0;
+         leaf.child2 = 0;
+         leaf.boundable = this->_boundables[index];
+      }
+   });
+
+   this->runRanges(numLeaves - 1,
+    [this](unsigned int, unsigned int begin, unsigned int end) {
+      for (unsigned int index = begin; index < end; ++index) {
+         this->emitNode(index);
+      }
+   });
+
+   this->refitNodes();
+}
+
+template < typename Task >
+unsigned int LinearBVH::runRanges(unsigned int numItems,
+ const Task& task) const {
+   if (numItems == 0) {
+      return 0;
+   }
+
+   if (this->_threadPool == nullptr ||
+    this->_threadPool->getNumThreads() == 1) {
+      task(0, 0, numItems);
+      return 1;
+   }
+
+   unsigned int numTasks = std::min(numItems,
+    this->_threadPool->getNumThreads() * LinearBVH::TASKS_PER_THREAD);
+   unsigned int itemsPerTask = (numItems + numTasks - 1) / numTasks;
+
+   this->_threadPool->run(numTasks,
+    [&task, numItems, itemsPerTask](unsigned int index, unsigned int) {
+      unsigned int begin = std::min(index * itemsPerTask, numItems);
+      unsigned int end = std::min(begin + itemsPerTask, numItems);
+      task(index, begin, end);
+   });
+
+   return numTasks;
+}
+
+void LinearBVH::sortPrimitives() const {
+   // A least significant digit radix sort over three 10-bit digits. Each pass
+   // is stable, so equal codes keep the order of their Boundables.
+   static const unsigned int DIGIT_BITS = 10;
+   static const unsigned int NUM_BUCKETS = 1 << DIGIT_BITS;
+
+   std::vector< Primitive >& source = this->_primitives;
+   std::vector< Primitive >& target = this->_sortBuffer;
+   target.resize(source.size());
+
+   std::vector< unsigned int > offsets(NUM_BUCKETS);
+   for (unsigned int shift = 0; shift < 30; shift += DIGIT_BITS) {
+      std::fill(offsets.begin(), offsets.end(), 0);
+      for (const Primitive& primitive : source) {
+         ++offsets[(primitive.code >> shift) & (NUM_BUCKETS - 1)];
+      }
+
+      unsigned int total = 0;
+      for (unsigned int& offset : offsets) {
+         unsigned int count = offset;
+         offset = total;
+         total += count;
+      }
+
+      for (const Primitive& primitive : source) {
+         target[offsets[(primitive.code >> shift) & (NUM_BUCKETS - 1)]++] =
+          primitive;
+      }
+      source.swap(target);
+   }
+}
+
+void LinearBVH::emitNode(unsigned int index) const {
+   int numLeaves = this->_primitives.size();
+   int first = index;
+
+   // The node covers a range of leaves extending from its own position in the
+   // direction that shares the longer prefix.
+   int direction = (this->getCommonPrefix(first, first + 1) >
+    this->getCommonPrefix(first, first - 1)) ? 1 : -1;
+   int minimumPrefix = this->getCommonPrefix(first, first - direction);
+
+   int maximumLength = 2;
+   while (this->getCommonPrefix(first, first + maximumLength * direction) >
+    minimumPrefix) {
+      maximumLength *= 2;
+   }
+
+   int length = 0;
+   for (int step = maximumLength / 2; step >= 1; step /= 2) {
+      if (this->getCommonPrefix(first, first + (length + step) * direction) >
+       minimumPrefix) {
+         length += step;
+      }
+   }
+   int last = first + length * direction;
+
+   // The range is split where the shared prefix first grows shorter.
+   int nodePrefix = this->getCommonPrefix(first, last);
+   int split = 0;
+   int step = length;
+   do {
+      step = (step + 1) / 2;
+      if (this->getCommonPrefix(first, first + (split + step) * direction) >
+       nodePrefix) {
+         split += step;
+      }
+   } while (step > 1);
+   int gamma = first + split * direction + std::min(direction, 0);
+
+   Node& node = this->_nodes[index];
+   node.child1 = (std::min(first, last) == gamma) ?
+    numLeaves - 1 + gamma : gamma;
+   node.child2 = (std::max(first, last) == gamma + 1) ?
+    numLeaves - 1 + gamma + 1 : gamma + 1;
+   node.boundable = nullptr;
+}
+
+void LinearBVH::refitNodes() const {
+   // Every parent precedes its children in a preorder traversal, so visiting
+   // the traversal backwards refits children before their parents.
+   std::vector< unsigned int > order;
+   std::vector< unsigned int > stack;
+   order.reserve(this->_primitives.size());
+   stack.push_back(0);
+   while (!stack.empty()) {
+      unsigned int index = stack.back();
+      stack.pop_back();
+
+      if (!this->isLeaf(index)) {
+         order.push_back(index);
+         stack.push_back(this->_nodes[index].child1);
+         stack.push_back(this->_nodes[index].child2);
+      }
+   }
+
+   for (auto itr = order.rbegin(); itr != order.rend(); ++itr) {
+      Node& node = this->_nodes[*itr];
+      const BoundingBox::Extents& a = this->_nodes[node.child1].extents;
+      const BoundingBox::Extents& b = this->_nodes[node.child2].extents;
+      node.extents[0] = glm::min(a[0], b[0]);
+      node.extents[1] = glm::max(a[1], b[1]);
+   }
+}
+
+int LinearBVH::getCommonPrefix(int first, int second) const {
+   if (second < 0 || second >= (int)this->_primitives.size()) {
+      return -1;
+   }
+
+   std::uint32_t a = this->_primitives[first].code;
+   std::uint32_t b = this->_primitives[second].code;
+   if (a == b) {
+      return 32 + LinearBVH::countLeadingZeros(std::uint32_t(first ^ second));
+   }
+   return LinearBVH::countLeadingZeros(a ^ b);
+}
+
+void LinearBVH::getCandidateElements(unsigned int begin, unsigned int end,
+ std::vector< Collision >& candidates) const {
+   unsigned int firstLeaf = this->_primitives.size() - 1;
+   std::vector< unsigned int > stack;
+
+   for (unsigned int leaf = firstLeaf + begin; leaf < firstLeaf + end;
+    ++leaf) {
+      const Node& query = this->_nodes[leaf];
+
+      stack.push_back(0);
+      while (!stack.empty()) {
+         unsigned int index = stack.back();
+         stack.pop_back();
+
+         const Node& node = this->_nodes[index];
+         if (!extents_overlap(node.extents, query.extents)) {
+            continue;
+         }
+
+         if (this->isLeaf(index)) {
+            if (index > leaf && query.boundable->isCollidable(node.boundable)) {
+               candidates.push_back(Collision::factory(query.boundable,
+                node.boundable));
+            }
+         } else {
+            stack.push_back(node.child2);
+            stack.push_back(node.child1);
+         }
+      }
+   }
+}
+
+bool LinearBVH::isLeaf(unsigned int node) const {
+   return node + 1 >= this->_primitives.size();
+}
+
+/* static */ std::uint32_t LinearBVH::expandBits(std::uint32_t value) {
+   value &= 0x000003FF;
+   value = (value | (value << 16)) & 0x030000FF;
+   value = (value | (value << 8)) & 0x0300F00F;
+   value = (value | (value << 4)) & 0x030C30C3;
+   value = (value | (value << 2)) & 0x09249249;
+   return value;
+}
+
+/* static */ std::uint32_t LinearBVH::getMortonCode(
+ const glm::vec3& position) {
+   glm::vec3 scaled = glm::clamp(position * 1024.0f, glm::vec3(0.0f),
+    glm::vec3(1023.0f));
+   return (LinearBVH::expandBits(std::uint32_t(scaled.x)) << 2) |
+    (LinearBVH::expandBits(std::uint32_t(scaled.y)) << 1) |
+    LinearBVH::expandBits(std::uint32_t(scaled.z));
+}
+
+/* static */ int LinearBVH::countLeadingZeros(std::uint32_t value) {
+   if (value == 0) {
+      return 32;
+   }
+
+   int count = 0;
+   for (int shift = 16; shift > 0; shift /= 2) {
+      if ((value >> (32 - shift)) == 0) {
+         count += shift;
+         value <<= shift;
+      }
+   }
+   return count;
+}
+
+/* static */ const unsigned int LinearBVH::TASKS_PER_THREAD = 4;
@@ -0,0 +1,93 @@
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/narrowphase.hpp>
+
+using namespace crash::space;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+Narrowphase::Narrowphase(const Narrowphase& narrowphase) :
+   _boundingBoxes(narrowphase._boundingBoxes),
+    _pairs(narrowphase._pairs),
+    _intersecting(narrowphase._intersecting),
+    _slots(narrowphase._slots)
+{}
+
+Narrowphase::Narrowphase() :
+   _boundingBoxes(), _pairs(), _intersecting(), _slots()
+{}
+
+/* virtual */ Narrowphase::~Narrowphase() {}
+
+////////////////////////////////////////////////////////////////////////////////
+// Queries.
+////////////////////////////////////////////////////////////////////////////////
+
+void Narrowphase::collide(const std::vector< Collision >& candidates,
+ std::vector< Collision >& colliding) {
+   this->collide(candidates, colliding, 0.0f);
+}
+
+void Narrowphase::collide(const std::vector< Collision >& candidates,
+ std::vector< Collision >& colliding, float delta_t) {
+   this->_boundingBoxes.clear();
+   this->_pairs.clear();
+   this->_slots.clear();
+
+   this->_pairs.reserve(candidates.size());
+   for (const Collision& candidate : candidates) {
+      this->_pairs.push_back(BoundingBoxArray::SlotPair(
+       this->getSlot(candidate.getFirst()),
+       this->getSlot(candidate.getSecond())));
+   }
+
+   this->_boundingBoxes.intersectPairs(this->_pairs, this->_intersecting);
+
+   colliding.clear();
+   for (unsigned int ndx = 0; ndx < candidates.size(); ++ndx) {
+      if (BoundingBoxArray::isSet(this->_intersecting, ndx)) {
+         colliding.push_back(candidates[ndx]);
+         continue;
+      }
+
+      // Pairs apart now may still pass through one another while moving.
+      if (delta_t <= 0.0f) {
+         continue;
+      }
+
+      boost::optional< float > impact = this->getTimeOfImpact(
+       candidates[ndx], delta_t);
+      if (impact) {
+         colliding.push_back(candidates[ndx]);
+         colliding.back().setTimeOfImpact(*impact);
+      }
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers.
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int Narrowphase::getSlot(Boundable* boundable) {
+   auto itr = this->_slots.find(boundable);
+   if (itr != this->_slots.end()) {
+      return itr->second;
+   }
+
+   unsigned int slot = this->_boundingBoxes.add(boundable);
+   this->_slots.insert(std::make_pair(boundable, slot));
+   return slot;
+}
+
+boost::optional< float > Narrowphase::getTimeOfImpact(
+ const Collision& candidate, float delta_t) const {
+   Boundable* first = candidate.getFirst();
+   Boundable* second = candidate.getSecond();
+   if (!first->isMoving() && !second->isMoving()) {
+      return boost::none;
+   }
+
+   return first->getBoundingBox()->getTimeOfImpact(
+    *second->getBoundingBox(), delta_t);
+}
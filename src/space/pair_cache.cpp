@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <crash/space/boundable.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/pair_cache.hpp>
+
+using namespace crash::space;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+PairCache::PairCache(const PairCache& pairCache) :
+   _entries(pairCache._entries),
+    _update(pairCache._update),
+    _begun(pairCache._begun),
+    _staying(pairCache._staying),
+    _ended(pairCache._ended)
+{}
+
+PairCache::PairCache() :
+   _entries(), _update(0), _begun(), _staying(), _ended()
+{}
+
+/* virtual */ PairCache::~PairCache() {}
+
+////////////////////////////////////////////////////////////////////////////////
+// Caching.
+////////////////////////////////////////////////////////////////////////////////
+
+void PairCache::update(const std::vector< Collision >& candidates) {
+   this->update(candidates, 0.0f);
+}
+
+void PairCache::update(const std::vector< Collision >& candidates,
+ float delta_t) {
+   this->_begun.clear();
+   this->_staying.clear();
+   this->_ended.clear();
+   ++this->_update;
+
+   for (const Collision& candidate : candidates) {
+      // Broadphases may report a pair in either order between updates.
+      Key key(std::minmax(candidate.getFirst(), candidate.getSecond()));
+      auto itr = this->_entries.find(key);
+      if (itr == this->_entries.end()) {
+         Entry entry = { BoundingBox::NO_AXIS, 0, false };
+         itr = this->_entries.insert(std::make_pair(key, entry)).first;
+      }
+
+      Entry& entry = itr->second;
+      entry.update = this->_update;
+
+      Collision collision = candidate;
+      collision.setTimeOfImpact(0.0f);
+
+      // The separating axis hint is only meaningful in the order it was
+      // found in.
+      BoundingBox* boundingBox = key.first->getBoundingBox();
+      bool colliding = boundingBox->isIntersecting(key.second,
+       entry.separatingAxis);
+
+      // Pairs apart now may still pass through one another while moving.
+      if (!colliding && delta_t > 0.0f && (key.first->isMoving() ||
+       key.second->isMoving())) {
+         boost::optional< float > impact = boundingBox->getTimeOfImpact(
+          *key.second->getBoundingBox(), delta_t);
+         if (impact) {
+            colliding = true;
+            collision.setTimeOfImpact(*impact);
+         }
+      }
+
+      if (colliding && entry.colliding) {
+         this->_staying.push_back(collision);
+      } else if (colliding) {
+         this->_begun.push_back(collision);
+      } else if (entry.colliding) {
+         this->_ended.push_back(collision);
+      }
+      entry.colliding = colliding;
+   }
+
+   // Pairs the broadphase no longer reports are too far apart to collide.
+   for (auto itr = this->_entries.begin(); itr != this->_entries.end();) {
+      if (itr->second.update == this->_update) {
+         ++itr;
+         continue;
+      }
+
+      if (itr->second.colliding) {
+         this->_ended.push_back(Collision::factory(itr->first.first,
+          itr->first.second));
+      }
+      itr = this->_entries.erase(itr);
+   }
+}
+
+void PairCache::remove(Boundable* boundable) {
+   for (auto itr = this->_entries.begin(); itr != this->_entries.end();) {
+      if (itr->first.first == boundable || itr->first.second == boundable) {
+         itr = this->_entries.erase(itr);
+      } else {
+         ++itr;
+      }
+   }
+}
+
+void PairCache::clear() {
+   this->_entries.clear();
+   this->_begun.clear();
+   this->_staying.clear();
+   this->_ended.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data access.
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector< Collision >& PairCache::getBegun() const {
+   return this->_begun;
+}
+
+const std::vector< Collision >& PairCache::getStaying() const {
+   return this->_staying;
+}
+
+const std::vector< Collision >& PairCache::getEnded() const {
+   return this->_ended;
+}
+
+std::vector< Collision > PairCache::getColliding() const {
+   std::vector< Collision > accumulator;
+   accumulator.reserve(this->_begun.size() + this->_staying.size());
+   accumulator.insert(accumulator.end(), this->_begun.begin(),
+    this->_begun.end());
+   accumulator.insert(accumulator.end(), this->_staying.begin(),
+    this->_staying.end());
+   return accumulator;
+}
+
+unsigned int PairCache::getNumPairs() const {
+   return this->_entries.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers.
+////////////////////////////////////////////////////////////////////////////////
+
+std::size_t PairCache::KeyHash::operator()(const Key& key) const {
+   std::size_t a = std::hash< Boundable* >()(key.first);
+   std::size_t b = std::hash< Boundable* >()(key.second);
+   return a ^ (b + 0x9e3779b9 + (a << 6) + (a >> 2));
+}
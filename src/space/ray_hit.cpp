@@ -0,0 +1,15 @@
+#include <crash/space/ray_hit.hpp>
+
+using namespace crash::space;
+
+RayHit::RayHit(const RayHit& rayHit) :
+   RayHit(rayHit.boundable, rayHit.distance)
+{}
+
+RayHit::RayHit(Boundable* boundable, float distance) :
+   boundable(boundable), distance(distance)
+{}
+
+bool RayHit::operator<(const RayHit& other) const {
+   return this->distance < other.distance;
+}
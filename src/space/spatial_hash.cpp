@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <cmath>
+#include <crash/render/view_frustum.hpp>
+#include <crash/space/boundable.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/spatial_hash.hpp>
+#include <crash/space/util.hpp>
+
+using namespace crash::common;
+using namespace crash::space;
+using namespace crash::render;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+SpatialHash::SpatialHash(const SpatialHash& spatialHash) :
+   _cellSize(spatialHash._cellSize),
+    _cells(spatialHash._cells),
+    _oversized(spatialHash._oversized),
+    _proxies(spatialHash._proxies),
+    _freeProxies(spatialHash._freeProxies),
+    _proxyIndices(spatialHash._proxyIndices),
+    _stamps(spatialHash._proxies.size(), 0),
+    _stamp(0),
+    _narrowphase(),
+    _candidates(),
+    _colliding()
+{}
+
+SpatialHash::SpatialHash(float cellSize) :
+   _cellSize(cellSize), _cells(), _oversized(), _proxies(), _freeProxies(),
+    _proxyIndices(), _stamps(), _stamp(0), _narrowphase(), _candidates(),
+    _colliding()
+{}
+
+/* virtual */ SpatialHash::~SpatialHash() {}
+
+////////////////////////////////////////////////////////////////////////////////
+// SpatialIndex interface.
+////////////////////////////////////////////////////////////////////////////////
+
+bool SpatialHash::add(Boundable* boundable) {
+   if (this->_proxyIndices.find(boundable) != this->_proxyIndices.end()) {
+      return false;
+   }
+
+   unsigned int index;
+   if (this->_freeProxies.empty()) {
+      index = this->_proxies.size();
+      this->_proxies.push_back(Proxy());
+      this->_stamps.push_back(0);
+   } else {
+      index = this->_freeProxies.back();
+      this->_freeProxies.pop_back();
+   }
+   this->_proxyIndices.insert(std::make_pair(boundable, index));
+
+   Proxy& proxy = this->_proxies[index];
+   proxy.boundable = boundable;
+   proxy.range = this->getCellRange(boundable);
+   this->insert(index);
+   return true;
+}
+
+bool SpatialHash::remove(Boundable* boundable) {
+   auto itr = this->_proxyIndices.find(boundable);
+   if (itr == this->_proxyIndices.end()) {
+      return false;
+   }
+
+   unsigned int index = itr->second;
+   this->_proxyIndices.erase(itr);
+
+   this->erase(index);
+   this->_proxies[index].boundable = nullptr;
+   this->_freeProxies.push_back(index);
+   return true;
+}
+
+bool SpatialHash::update(Boundable* boundable) {
+   auto itr = this->_proxyIndices.find(boundable);
+   if (itr == this->_proxyIndices.end()) {
+      return this->add(boundable);
+   }
+
+   unsigned int index = itr->second;
+   CellRange range = this->getCellRange(boundable);
+   if (range == this->_proxies[index].range) {
+      return false;
+   }
+
+   bool oversized = (range.getNumCells() > MAX_CELLS);
+   if (oversized || this->_proxies[index].oversized) {
+      this->erase(index);
+      this->_proxies[index].range = range;
+      this->insert(index);
+      return true;
+   }
+
+   // Boundables usually move a fraction of a cell, so most of the cells they
+   // overlap are shared by the old and new ranges and need not be touched.
+   CellRange previous = this->_proxies[index].range;
+   this->removeFromRange(index, previous, range);
+   this->addToRange(index, range, previous);
+   this->_proxies[index].range = range;
+   return true;
+}
+
+void SpatialHash::clear() {
+   this->_cells.clear();
+   this->_oversized.clear();
+   this->_proxies.clear();
+   this->_freeProxies.clear();
+   this->_proxyIndices.clear();
+   this->_stamps.clear();
+   this->_stamp = 0;
+}
+
+unsigned int SpatialHash::getNumBoundables() const {
+   return this->_proxyIndices.size();
+}
+
+std::vector< Boundable* > SpatialHash::getBoundables() const {
+   std::vector< Boundable* > accumulator;
+   accumulator.reserve(this->_proxyIndices.size());
+
+   for (const Proxy& proxy : this->_proxies) {
+      if (proxy.boundable != nullptr) {
+         accumulator.push_back(proxy.boundable);
+      }
+   }
+
+   return accumulator;
+}
+
+void SpatialHash::forEachBoundable(const BoundableVisitor& visitor) const {
+   for (const Proxy& proxy : this->_proxies) {
+      if (proxy.boundable != nullptr) {
+         visitor(proxy.boundable);
+      }
+   }
+}
+
+std::vector< Collision > SpatialHash::getCandidateElements() const {
+   std::vector< Collision > candidates;
+   this->getCandidateElements(candidates);
+   return candidates;
+}
+
+std::vector< Collision > SpatialHash::getCollidingElements() const {
+   std::vector< Collision > accumulator;
+   this->_candidates.clear();
+   this->getCandidateElements(this->_candidates);
+   this->_narrowphase.collide(this->_candidates, accumulator);
+   return accumulator;
+}
+
+void SpatialHash::forEachPair(const CollisionVisitor& visitor) const {
+   this->_candidates.clear();
+   this->getCandidateElements(this->_candidates);
+   this->_narrowphase.collide(this->_candidates, this->_colliding);
+   for (const Collision& collision : this->_colliding) {
+      visitor(collision);
+   }
+}
+
+std::vector< Boundable* > SpatialHash::getVisibleElements(
+ const ViewFrustum& viewFrustum) {
+   std::vector< Boundable* > accumulator;
+   this->forEachVisible(viewFrustum, [&accumulator](Boundable* boundable) {
+      accumulator.push_back(boundable);
+   });
+   return accumulator;
+}
+
+void SpatialHash::forEachVisible(const ViewFrustum& viewFrustum,
+ const BoundableVisitor& visitor) {
+   // Stamps only need to be cleared when the counter wraps around.
+   if (++this->_stamp == 0) {
+      std::fill(this->_stamps.begin(), this->_stamps.end(), 0);
+      this->_stamp = 1;
+   }
+
+   for (const auto& cell : this->_cells) {
+      if (this->isCulled(cell.first, viewFrustum)) {
+         continue;
+      }
+
+      for (unsigned int index : cell.second) {
+         if (this->_stamps[index] == this->_stamp) {
+            continue;
+         }
+         this->_stamps[index] = this->_stamp;
+
+         Boundable* boundable = this->_proxies[index].boundable;
+         if (boundable->isVisible(viewFrustum)) {
+            visitor(boundable);
+         }
+      }
+   }
+
+   for (unsigned int index : this->_oversized) {
+      Boundable* boundable = this->_proxies[index].boundable;
+      if (boundable->isVisible(viewFrustum)) {
+         visitor(boundable);
+      }
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data access.
+////////////////////////////////////////////////////////////////////////////////
+
+float SpatialHash::getCellSize() const {
+   return this->_cellSize;
+}
+
+unsigned int SpatialHash::getNumCells() const {
+   return this->_cells.size();
+}
+
+unsigned int SpatialHash::getNumOversized() const {
+   return this->_oversized.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Type definitions.
+////////////////////////////////////////////////////////////////////////////////
+
+bool SpatialHash::CellRange::isEmpty() const {
+   return glm::any(glm::greaterThan(this->minimum, this->maximum));
+}
+
+bool SpatialHash::CellRange::contains(const glm::ivec3& index) const {
+   return glm::all(glm::lessThanEqual(this->minimum, index)) &&
+    glm::all(glm::lessThanEqual(index, this->maximum));
+}
+
+bool SpatialHash::CellRange::operator==(const CellRange& other) const {
+   return this->minimum == other.minimum && this->maximum == other.maximum;
+}
+
+double SpatialHash::CellRange::getNumCells() const {
+   if (this->isEmpty()) {
+      return 0.0;
+   }
+
+   double count = 1.0;
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      count *= double(this->maximum[axis]) - double(this->minimum[axis]) + 1.0;
+   }
+   return count;
+}
+
+std::size_t SpatialHash::CellHash::operator()(const glm::ivec3& index) const {
+   return (std::size_t(index.x) * 73856093u) ^
+    (std::size_t(index.y) * 19349663u) ^
+    (std::size_t(index.z) * 83492791u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers.
+////////////////////////////////////////////////////////////////////////////////
+
+SpatialHash::CellRange SpatialHash::getCellRange(Boundable* boundable) const {
+   const BoundingBox::Extents& extents =
+    boundable->getBoundingBox()->getExtents();
+
+   CellRange range;
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      range.minimum[axis] =
+       int(std::floor(extents[0][axis] / this->_cellSize));
+      range.maximum[axis] =
+       int(std::floor(extents[1][axis] / this->_cellSize));
+   }
+   return range;
+}
+
+void SpatialHash::addToRange(unsigned int proxy, const CellRange& range,
+ const CellRange& exclude) {
+   glm::ivec3 index;
+   for (index.x = range.minimum.x; index.x <= range.maximum.x; ++index.x) {
+      for (index.y = range.minimum.y; index.y <= range.maximum.y; ++index.y) {
+         for (index.z = range.minimum.z; index.z <= range.maximum.z;
+          ++index.z) {
+            if (!exclude.contains(index)) {
+               this->_cells[index].push_back(proxy);
+            }
+         }
+      }
+   }
+}
+
+void SpatialHash::removeFromRange(unsigned int proxy, const CellRange& range,
+ const CellRange& exclude) {
+   glm::ivec3 index;
+   for (index.x = range.minimum.x; index.x <= range.maximum.x; ++index.x) {
+      for (index.y = range.minimum.y; index.y <= range.maximum.y; ++index.y) {
+         for (index.z = range.minimum.z; index.z <= range.maximum.z;
+          ++index.z) {
+            if (exclude.contains(index)) {
+               continue;
+            }
+
+            auto itr = this->_cells.find(index);
+            if (itr == this->_cells.end()) {
+               continue;
+            }
+
+            SpatialHash::removeFromCell(itr->second, proxy);
+            if (itr->second.empty()) {
+               this->_cells.erase(itr);
+            }
+         }
+      }
+   }
+}
+
+void SpatialHash::insert(unsigned int proxy) {
+   Proxy& target = this->_proxies[proxy];
+   target.oversized = (target.range.getNumCells() > MAX_CELLS);
+
+   if (target.oversized) {
+      this->_oversized.push_back(proxy);
+   } else {
+      this->addToRange(proxy, target.range, EMPTY_RANGE);
+   }
+}
+
+void SpatialHash::erase(unsigned int proxy) {
+   const Proxy& target = this->_proxies[proxy];
+
+   if (target.oversized) {
+      SpatialHash::removeFromCell(this->_oversized, proxy);
+   } else {
+      this->removeFromRange(proxy, target.range, EMPTY_RANGE);
+   }
+}
+
+void SpatialHash::getCandidateElements(
+ std::vector< Collision >& candidates) const {
+   // A pair of Boundables shares every cell in the intersection of their
+   // ranges. Only the cell at the minimum corner of that intersection reports
+   // the pair, so that it is reported once.
+   for (const auto& cell : this->_cells) {
+      const Cell& members = cell.second;
+      for (unsigned int i = 0; i < members.size(); ++i) {
+         const Proxy& a = this->_proxies[members[i]];
+         for (unsigned int j = i + 1; j < members.size(); ++j) {
+            const Proxy& b = this->_proxies[members[j]];
+            if (glm::max(a.range.minimum, b.range.minimum) == cell.first &&
+             a.boundable->isCollidable(b.boundable)) {
+               candidates.push_back(Collision::factory(a.boundable,
+                b.boundable));
+            }
+         }
+      }
+   }
+
+   // Oversized Boundables are paired with every other Boundable.
+   for (unsigned int i = 0; i < this->_oversized.size(); ++i) {
+      const Proxy& a = this->_proxies[this->_oversized[i]];
+      for (unsigned int j = i + 1; j < this->_oversized.size(); ++j) {
+         const Proxy& b = this->_proxies[this->_oversized[j]];
+         if (a.boundable->isCollidable(b.boundable)) {
+            candidates.push_back(Collision::factory(a.boundable,
+             b.boundable));
+         }
+      }
+
+      for (const Proxy& b : this->_proxies) {
+         if (b.boundable != nullptr && !b.oversized &&
+          a.boundable->isCollidable(b.boundable)) {
+            candidates.push_back(Collision::factory(a.boundable,
+             b.boundable));
+         }
+      }
+   }
+}
+
+bool SpatialHash::isCulled(const glm::ivec3& index,
+ const ViewFrustum& viewFrustum) const {
+   glm::vec3 halfSize(this->_cellSize * 0.5f);
+   glm::vec3 center = (glm::vec3(index) + glm::vec3(0.5f)) * this->_cellSize;
+   return !box_visible(center, halfSize, viewFrustum);
+}
+
+/* static */ void SpatialHash::removeFromCell(Cell& cell, unsigned int proxy) {
+   auto itr = std::find(cell.begin(), cell.end(), proxy);
+   if (itr != cell.end()) {
+      *itr = cell.back();
+      cell.pop_back();
+   }
+}
+
+/* static */ const unsigned int SpatialHash::MAX_CELLS = 64;
+/* static */ const SpatialHash::CellRange SpatialHash::EMPTY_RANGE = {
+   glm::ivec3(1), glm::ivec3(0)
+};
@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <limits>
+#include <crash/space/boundable.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/sweep_and_prune.hpp>
+
+using namespace crash::space;
+using namespace crash::render;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructors.
+////////////////////////////////////////////////////////////////////////////////
+
+SweepAndPrune::SweepAndPrune(const SweepAndPrune& sweepAndPrune) :
+   _endpoints(sweepAndPrune._endpoints),
+    _proxies(sweepAndPrune._proxies),
+    _freeProxies(sweepAndPrune._freeProxies),
+    _proxyIndices(sweepAndPrune._proxyIndices),
+    _overlappingPairs(sweepAndPrune._overlappingPairs),
+    _narrowphase(),
+    _colliding()
+{}
+
+SweepAndPrune::SweepAndPrune() :
+   _endpoints(), _proxies(), _freeProxies(), _proxyIndices(),
+    _overlappingPairs(), _narrowphase(), _colliding()
+{}
+
+/* virtual */ SweepAndPrune::~SweepAndPrune() {}
+
+////////////////////////////////////////////////////////////////////////////////
+// SpatialIndex interface.
+////////////////////////////////////////////////////////////////////////////////
+
+bool SweepAndPrune::add(Boundable* boundable) {
+   if (this->_proxyIndices.find(boundable) != this->_proxyIndices.end()) {
+      return false;
+   }
+
+   unsigned int index;
+   if (this->_freeProxies.empty()) {
+      index = this->_proxies.size();
+      this->_proxies.push_back(Proxy());
+   } else {
+      index = this->_freeProxies.back();
+      this->_freeProxies.pop_back();
+   }
+   this->_proxyIndices.insert(std::make_pair(boundable, index));
+
+   Proxy& proxy = this->_proxies[index];
+   proxy.boundable = boundable;
+   this->refreshExtents(proxy);
+
+   // Append both endpoints to the end of every list and sort them into place.
+   // Overlap on all three axes is judged from the extents themselves, so pairs
+   // only need to be tracked while sorting the final axis.
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      Endpoints& endpoints = this->_endpoints[axis];
+      bool track = (axis == 2);
+
+      endpoints.push_back(Endpoint{ proxy.minimum[axis], index, false });
+      this->setEndpoint(axis, endpoints.size() - 1);
+      endpoints.push_back(Endpoint{ proxy.maximum[axis], index, true });
+      this->setEndpoint(axis, endpoints.size() - 1);
+
+      this->sortDown(axis, this->_proxies[index].minimumEndpoints[axis], track);
+      this->sortDown(axis, this->_proxies[index].maximumEndpoints[axis], track);
+   }
+
+   return true;
+}
+
+bool SweepAndPrune::remove(Boundable* boundable) {
+   auto itr = this->_proxyIndices.find(boundable);
+   if (itr == this->_proxyIndices.end()) {
+      return false;
+   }
+
+   unsigned int index = itr->second;
+   this->_proxyIndices.erase(itr);
+
+   // Sweep both endpoints to the end of every list. The minimum crosses the
+   // maximum of every proxy it overlaps along the way, which removes all of
+   // the pairs this proxy belongs to.
+   static const float sentinel = std::numeric_limits< float >::max();
+   Proxy& proxy = this->_proxies[index];
+   proxy.minimum = glm::vec3(sentinel);
+   proxy.maximum = glm::vec3(sentinel);
+
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      Endpoints& endpoints = this->_endpoints[axis];
+
+      unsigned int maximum = this->_proxies[index].maximumEndpoints[axis];
+      endpoints[maximum].value = sentinel;
+      this->sortUp(axis, maximum, true);
+
+      unsigned int minimum = this->_proxies[index].minimumEndpoints[axis];
+      endpoints[minimum].value = sentinel;
+      this->sortUp(axis, minimum, true);
+
+      endpoints.pop_back();
+      endpoints.pop_back();
+   }
+
+   this->_proxies[index].boundable = nullptr;
+   this->_freeProxies.push_back(index);
+   return true;
+}
+
+bool SweepAndPrune::update(Boundable* boundable) {
+   auto itr = this->_proxyIndices.find(boundable);
+   if (itr == this->_proxyIndices.end()) {
+      return this->add(boundable);
+   }
+
+   unsigned int index = itr->second;
+   Proxy& proxy = this->_proxies[index];
+   glm::vec3 previousMinimum = proxy.minimum;
+   glm::vec3 previousMaximum = proxy.maximum;
+   this->refreshExtents(proxy);
+
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      Endpoints& endpoints = this->_endpoints[axis];
+      const Proxy& current = this->_proxies[index];
+
+      endpoints[current.minimumEndpoints[axis]].value = current.minimum[axis];
+      endpoints[current.maximumEndpoints[axis]].value = current.maximum[axis];
+
+      // Grow before shrinking so that the minimum never has to cross its own
+      // maximum.
+      if (current.minimum[axis] < previousMinimum[axis]) {
+         this->sortDown(axis, current.minimumEndpoints[axis], true);
+      }
+      if (current.maximum[axis] > previousMaximum[axis]) {
+         this->sortUp(axis, current.maximumEndpoints[axis], true);
+      }
+      if (current.minimum[axis] > previousMinimum[axis]) {
+         this->sortUp(axis, current.minimumEndpoints[axis], true);
+      }
+      if (current.maximum[axis] < previousMaximum[axis]) {
+         this->sortDown(axis, current.maximumEndpoints[axis], true);
+      }
+   }
+
+   return true;
+}
+
+void SweepAndPrune::clear() {
+   for (Endpoints& endpoints : this->_endpoints) {
+      endpoints.clear();
+   }
+   this->_proxies.clear();
+   this->_freeProxies.clear();
+   this->_proxyIndices.clear();
+   this->_overlappingPairs.clear();
+}
+
+unsigned int SweepAndPrune::getNumBoundables() const {
+   return this->_proxyIndices.size();
+}
+
+std::vector< Boundable* > SweepAndPrune::getBoundables() const {
+   std::vector< Boundable* > accumulator;
+   accumulator.reserve(this->_proxyIndices.size());
+
+   for (const Proxy& proxy : this->_proxies) {
+      if (proxy.boundable != nullptr) {
+         accumulator.push_back(proxy.boundable);
+      }
+   }
+
+   return accumulator;
+}
+
+void SweepAndPrune::forEachBoundable(const BoundableVisitor& visitor) const {
+   for (const Proxy& proxy : this->_proxies) {
+      if (proxy.boundable != nullptr) {
+         visitor(proxy.boundable);
+      }
+   }
+}
+
+std::vector< Collision > SweepAndPrune::getCandidateElements() const {
+   std::vector< Collision > candidates;
+   candidates.reserve(this->_overlappingPairs.size());
+
+   for (std::uint64_t key : this->_overlappingPairs) {
+      const Proxy& a = this->_proxies[key >> 32];
+      const Proxy& b = this->_proxies[key & 0xFFFFFFFF];
+      if (a.boundable->isCollidable(b.boundable)) {
+         candidates.push_back(Collision::factory(a.boundable, b.boundable));
+      }
+   }
+
+   return candidates;
+}
+
+std::vector< Collision > SweepAndPrune::getCollidingElements() const {
+   std::vector< Collision > accumulator;
+   this->_narrowphase.collide(this->getCandidateElements(), accumulator);
+   return accumulator;
+}
+
+void SweepAndPrune::forEachPair(const CollisionVisitor& visitor) const {
+   this->_narrowphase.collide(this->getCandidateElements(), this->_colliding);
+   for (const Collision& collision : this->_colliding) {
+      visitor(collision);
+   }
+}
+
+std::vector< Boundable* > SweepAndPrune::getVisibleElements(
+ const ViewFrustum& viewFrustum) {
+   std::vector< Boundable* > accumulator;
+   this->forEachVisible(viewFrustum, [&accumulator](Boundable* boundable) {
+      accumulator.push_back(boundable);
+   });
+   return accumulator;
+}
+
+void SweepAndPrune::forEachVisible(const ViewFrustum& viewFrustum,
+ const BoundableVisitor& visitor) {
+   for (const Proxy& proxy : this->_proxies) {
+      if (proxy.boundable != nullptr &&
+       proxy.boundable->isVisible(viewFrustum)) {
+         visitor(proxy.boundable);
+      }
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data access.
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int SweepAndPrune::getNumOverlappingPairs() const {
+   return this->_overlappingPairs.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers.
+////////////////////////////////////////////////////////////////////////////////
+
+void SweepAndPrune::sortDown(unsigned int axis, unsigned int position,
+ bool track) {
+   const Endpoints& endpoints = this->_endpoints[axis];
+
+   while (position > 0 &&
+    SweepAndPrune::precedes(endpoints[position], endpoints[position - 1])) {
+      this->swap(axis, position - 1, track);
+      --position;
+   }
+}
+
+void SweepAndPrune::sortUp(unsigned int axis, unsigned int position,
+ bool track) {
+   const Endpoints& endpoints = this->_endpoints[axis];
+
+   while (position + 1 < endpoints.size() &&
+    SweepAndPrune::precedes(endpoints[position + 1], endpoints[position])) {
+      this->swap(axis, position, track);
+      ++position;
+   }
+}
+
+void SweepAndPrune::swap(unsigned int axis, unsigned int lower, bool track) {
+   Endpoints& endpoints = this->_endpoints[axis];
+   const Endpoint& rising = endpoints[lower];
+   const Endpoint& falling = endpoints[lower + 1];
+
+   if (track && rising.proxy != falling.proxy) {
+      std::uint64_t key = SweepAndPrune::pairKey(rising.proxy, falling.proxy);
+
+      if (rising.isMaximum && !falling.isMaximum) {
+         // A maximum passes a minimum: the intervals begin overlapping on this
+         // axis, so the pair overlaps if it already does on the other two.
+         if (this->isOverlapping(this->_proxies[rising.proxy],
+          this->_proxies[falling.proxy])) {
+            this->_overlappingPairs.insert(key);
+         }
+      } else if (!rising.isMaximum && falling.isMaximum) {
+         // A minimum passes a maximum: the intervals stop overlapping.
+         this->_overlappingPairs.erase(key);
+      }
+   }
+
+   std::swap(endpoints[lower], endpoints[lower + 1]);
+   this->setEndpoint(axis, lower);
+   this->setEndpoint(axis, lower + 1);
+}
+
+void SweepAndPrune::setEndpoint(unsigned int axis, unsigned int position) {
+   const Endpoint& endpoint = this->_endpoints[axis][position];
+   Proxy& proxy = this->_proxies[endpoint.proxy];
+
+   if (endpoint.isMaximum) {
+      proxy.maximumEndpoints[axis] = position;
+   } else {
+      proxy.minimumEndpoints[axis] = position;
+   }
+}
+
+void SweepAndPrune::refreshExtents(Proxy& proxy) {
+   const BoundingBox::Extents& extents =
+    proxy.boundable->getBoundingBox()->getExtents();
+   proxy.minimum = extents[0];
+   proxy.maximum = extents[1];
+}
+
+bool SweepAndPrune::isOverlapping(const Proxy& a, const Proxy& b) const {
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      if (a.minimum[axis] > b.maximum[axis] ||
+       b.minimum[axis] > a.maximum[axis]) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+/* static */ bool SweepAndPrune::precedes(const Endpoint& a,
+ const Endpoint& b) {
+   // Touching intervals overlap, so a minimum sorts before a maximum of the
+   // same value.
+   return a.value < b.value ||
+    (a.value == b.value && !a.isMaximum && b.isMaximum);
+}
+
+/* static */ std::uint64_t SweepAndPrune::pairKey(unsigned int a,
+ unsigned int b) {
+   std::uint64_t low = std::min(a, b);
+   std::uint64_t high = std::max(a, b);
+   return (high << 32) | low;
+}
@@ -1,6 +1,10 @@
 #include <cstdlib>
+#include <crash/common/plane.hpp>
+#include <crash/render/view_frustum.hpp>
 #include <crash/space/util.hpp>
 
+using namespace crash::common;
+using namespace crash::render;
 using namespace crash::space;
 
 int crash::space::linearize_index(const glm::ivec2& index,
@@ -28,3 +32,33 @@ glm::ivec3 crash::space::vectorize_index(int index, const glm::ivec3& bounds) {
    std::div_t yz = std::div(x.quot, bounds.y);
    return glm::ivec3(x.rem, yz.rem, yz.quot);
 }
+
+bool crash::space::extents_overlap(const std::array< glm::vec3, 2 >& a,
+ const std::array< glm::vec3, 2 >& b) {
+   for (unsigned int axis = 0; axis < 3; ++axis) {
+      if (a[0][axis] > b[1][axis] || b[0][axis] > a[1][axis]) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool crash::space::box_visible(const glm::vec3& center,
+ const glm::vec3& halfSize, const ViewFrustum& viewFrustum) {
+   for (const Plane& plane : viewFrustum.getPlanes()) {
+      // The extent of the box along the normal of the plane.
+      float radius = glm::dot(halfSize, glm::abs(plane.normal));
+      if (plane.distance(center) + radius < 0.0f) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool crash::space::extents_visible(const std::array< glm::vec3, 2 >& extents,
+ const ViewFrustum& viewFrustum) {
+   return box_visible((extents[0] + extents[1]) * 0.5f,
+    (extents[1] - extents[0]) * 0.5f, viewFrustum);
+}
@@ -815,6 +815,13 @@ BoundingPartitionPtr getBoundingPartition(
    BoundingPartitionPtr boundingPartition =
     std::make_shared< BoundingPartition >(transformer, partitions);
 
+   // The plane and sky box span the whole partition, so keep them out of the
+   // fine groups that the actors occupy.
+   boundingPartition->setHierarchical(true);
+
+   // Actors gather and scatter as they move, so let the grid follow them.
+   boundingPartition->setAutoPartition(true);
+
    for (const ActorPtr& actor : actors) {
       boundingPartition->add(actor.get());
    }
@@ -0,0 +1,45 @@
+#include <catch.hpp>
+#include <atomic>
+#include <vector>
+#include <crash/common/thread_pool.hpp>
+
+using namespace crash::common;
+
+TEST_CASE("crash/common/thread_pool/run") {
+   ThreadPool threadPool(4);
+   REQUIRE(threadPool.getNumThreads() == 4);
+
+   for (unsigned int batch = 0; batch < 50; ++batch) {
+      std::vector< unsigned int > counts(1000, 0);
+      std::atomic< unsigned int > invalidThreads(0);
+
+      threadPool.run(counts.size(),
+       [&counts, &invalidThreads](unsigned int task, unsigned int thread) {
+         ++counts[task];
+         if (thread >= 4) {
+            ++invalidThreads;
+         }
+      });
+
+      REQUIRE(invalidThreads == 0);
+      for (unsigned int count : counts) {
+         REQUIRE(count == 1);
+      }
+   }
+}
+
+TEST_CASE("crash/common/thread_pool/serial") {
+   ThreadPool threadPool(1);
+   REQUIRE(threadPool.getNumThreads() == 1);
+
+   std::vector< unsigned int > order;
+   threadPool.run(10, [&order](unsigned int task, unsigned int thread) {
+      REQUIRE(thread == 0);
+      order.push_back(task);
+   });
+
+   REQUIRE(order.size() == 10);
+   for (unsigned int ndx = 0; ndx < order.size(); ++ndx) {
+      REQUIRE(order[ndx] == ndx);
+   }
+}
@@ -0,0 +1,163 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/transform.hpp>
+#include <crash/common/arithmetic.hpp>
+#include <crash/render/occlusion_buffer.hpp>
+
+using namespace crash::common;
+using namespace crash::render;
+
+static const unsigned int WIDTH = 64;
+static const unsigned int HEIGHT = 32;
+
+// A camera at the origin looking down -z, with a square field of view.
+static glm::mat4 viewProjection() {
+   return glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f);
+}
+
+static glm::mat4 boxTransform(const glm::vec3& position,
+ const glm::vec3& size) {
+   return glm::translate(position) * glm::scale(size);
+}
+
+static OcclusionBuffer::Corners boxCorners(const glm::vec3& position,
+ const glm::vec3& size) {
+   OcclusionBuffer::Corners corners;
+   for (unsigned int ndx = 0; ndx < OcclusionBuffer::NUM_CORNERS; ++ndx) {
+      glm::vec3 offset((ndx & 1) ? 0.5f : -0.5f, (ndx & 2) ? 0.5f : -0.5f,
+       (ndx & 4) ? 0.5f : -0.5f);
+      corners[ndx] = position + offset * size;
+   }
+   return corners;
+}
+
+TEST_CASE("crash/render/occlusion_buffer/rasterize") {
+   OcclusionBuffer occlusionBuffer(WIDTH, HEIGHT);
+   REQUIRE(occlusionBuffer.getNumLevels() == 7);
+   REQUIRE(occlusionBuffer.getLevelSize(6) == glm::ivec2(1, 1));
+
+   occlusionBuffer.clear(viewProjection());
+   OccluderMesh cube = OccluderMesh::unitCube();
+
+   // The near face of this wall spans x from -0.2 to 0.2 in normalized
+   // device coordinates, which covers the centers of pixels 26 to 37.
+   occlusionBuffer.rasterize(cube, boxTransform(glm::vec3(0.0f, 0.0f, -10.5f),
+    glm::vec3(4.0f, 40.0f, 1.0f)));
+
+   for (unsigned int y = 0; y < HEIGHT; ++y) {
+      REQUIRE(occlusionBuffer.getDepth(25, y) == 1.0f);
+      REQUIRE(occlusionBuffer.getDepth(38, y) == 1.0f);
+      for (unsigned int x = 26; x <= 37; ++x) {
+         REQUIRE(occlusionBuffer.getDepth(x, y) < 1.0f);
+         REQUIRE(std::abs(occlusionBuffer.getDepth(x, y) -
+          occlusionBuffer.getDepth(26, 0)) < 1e-5f);
+      }
+   }
+
+   // Every texel bounds the four beneath it.
+   occlusionBuffer.buildHierarchy();
+   for (unsigned int level = 1; level < occlusionBuffer.getNumLevels();
+    ++level) {
+      glm::ivec2 size = occlusionBuffer.getLevelSize(level);
+      glm::ivec2 finer = occlusionBuffer.getLevelSize(level - 1);
+      for (int y = 0; y < finer.y; ++y) {
+         for (int x = 0; x < finer.x; ++x) {
+            REQUIRE(x / 2 < size.x);
+            REQUIRE(occlusionBuffer.getMinDepth(level, x / 2, y / 2) <=
+             occlusionBuffer.getMinDepth(level - 1, x, y));
+            REQUIRE(occlusionBuffer.getMaxDepth(level, x / 2, y / 2) >=
+             occlusionBuffer.getMaxDepth(level - 1, x, y));
+         }
+      }
+   }
+   REQUIRE(occlusionBuffer.getMinDepth(6, 0, 0) < 1.0f);
+   REQUIRE(occlusionBuffer.getMaxDepth(6, 0, 0) == 1.0f);
+}
+
+TEST_CASE("crash/render/occlusion_buffer/is_occluded") {
+   OcclusionBuffer occlusionBuffer(WIDTH, HEIGHT);
+   occlusionBuffer.clear(viewProjection());
+   occlusionBuffer.rasterize(OccluderMesh::unitCube(),
+    boxTransform(glm::vec3(0.0f, 0.0f, -10.5f), glm::vec3(8.0f, 8.0f, 1.0f)));
+   occlusionBuffer.buildHierarchy();
+
+   glm::vec3 size(1.0f);
+   REQUIRE(occlusionBuffer.isOccluded(
+    boxCorners(glm::vec3(0.0f, 0.0f, -20.0f), size)));
+   REQUIRE(occlusionBuffer.isOccluded(
+    boxCorners(glm::vec3(3.0f, -3.0f, -15.0f), size)));
+
+   // In front of the wall, beside it, overlapping it, or crossing the near
+   // plane.
+   REQUIRE(!occlusionBuffer.isOccluded(
+    boxCorners(glm::vec3(0.0f, 0.0f, -5.0f), size)));
+   REQUIRE(!occlusionBuffer.isOccluded(
+    boxCorners(glm::vec3(12.0f, 0.0f, -20.0f), size)));
+   REQUIRE(!occlusionBuffer.isOccluded(
+    boxCorners(glm::vec3(8.5f, 0.0f, -20.0f), size)));
+   REQUIRE(!occlusionBuffer.isOccluded(
+    boxCorners(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(3.0f))));
+   REQUIRE(!occlusionBuffer.isOccluded(
+    boxCorners(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(3.0f))));
+
+   // Nothing is occluded once the buffer is cleared.
+   occlusionBuffer.clear(viewProjection());
+   occlusionBuffer.buildHierarchy();
+   REQUIRE(!occlusionBuffer.isOccluded(
+    boxCorners(glm::vec3(0.0f, 0.0f, -20.0f), size)));
+}
+
+TEST_CASE("crash/render/occlusion_buffer/random") {
+   OcclusionBuffer occlusionBuffer(WIDTH, HEIGHT);
+   occlusionBuffer.clear(viewProjection());
+   for (unsigned int ndx = 0; ndx < 20; ++ndx) {
+      glm::vec3 position(rand_float(-20.0f, 20.0f), rand_float(-20.0f, 20.0f),
+       rand_float(-40.0f, -5.0f));
+      occlusionBuffer.rasterize(OccluderMesh::unitCube(),
+       boxTransform(position, glm::vec3(rand_float(1.0f, 8.0f),
+       rand_float(1.0f, 8.0f), rand_float(1.0f, 8.0f))));
+   }
+   occlusionBuffer.buildHierarchy();
+
+   // A box is occluded exactly when every pixel its screen bounds touch is
+   // nearer than its nearest corner.
+   glm::mat4 transform = viewProjection();
+   for (unsigned int ndx = 0; ndx < 500; ++ndx) {
+      glm::vec3 position(rand_float(-20.0f, 20.0f), rand_float(-20.0f, 20.0f),
+       rand_float(-60.0f, -10.0f));
+      OcclusionBuffer::Corners corners = boxCorners(position,
+       glm::vec3(rand_float(0.2f, 3.0f)));
+
+      float minX = 1e9f, minY = 1e9f, maxX = -1e9f, maxY = -1e9f;
+      float depth = 1.0f;
+      for (const glm::vec3& corner : corners) {
+         glm::vec4 clip = transform * glm::vec4(corner, 1.0f);
+         minX = std::min(minX, clip.x / clip.w);
+         minY = std::min(minY, clip.y / clip.w);
+         maxX = std::max(maxX, clip.x / clip.w);
+         maxY = std::max(maxY, clip.y / clip.w);
+         depth = std::min(depth, clip.z / clip.w * 0.5f + 0.5f);
+      }
+      if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f) {
+         continue;
+      }
+
+      int x0 = (int)((std::max(minX, -1.0f) * 0.5f + 0.5f) * WIDTH);
+      int y0 = (int)((std::max(minY, -1.0f) * 0.5f + 0.5f) * HEIGHT);
+      int x1 = std::min((int)((std::min(maxX, 1.0f) * 0.5f + 0.5f) * WIDTH),
+       (int)WIDTH - 1);
+      int y1 = std::min((int)((std::min(maxY, 1.0f) * 0.5f + 0.5f) * HEIGHT),
+       (int)HEIGHT - 1);
+
+      bool expected = true;
+      for (int y = y0; y <= y1; ++y) {
+         for (int x = x0; x <= x1; ++x) {
+            expected &= occlusionBuffer.getDepth(x, y) < depth;
+         }
+      }
+
+      REQUIRE(occlusionBuffer.isOccluded(corners) == expected);
+   }
+}
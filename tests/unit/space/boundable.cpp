@@ -0,0 +1,144 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <vector>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/bounding_group.hpp>
+#include <crash/space/bounding_partition.hpp>
+#include <crash/space/dynamic_tree.hpp>
+#include <crash/space/linear_bvh.hpp>
+#include <crash/space/spatial_hash.hpp>
+#include <crash/space/sweep_and_prune.hpp>
+#include "helpers.hpp"
+
+using namespace crash::common;
+using namespace crash::space;
+
+TEST_CASE("crash/space/boundable/is_collidable") {
+   BoundingBox a(Transformer(ORIGIN, NO_ROTATION, UNIT_SIZE,
+    glm::vec3(), NO_ROTATION, glm::vec3()));
+   BoundingBox b(a);
+
+   REQUIRE(a.getCollisionLayers() == Boundable::DEFAULT_LAYER);
+   REQUIRE(a.getCollisionMask() == Boundable::ALL_LAYERS);
+   REQUIRE(!a.isStatic());
+   REQUIRE(a.isCollidable(&b));
+
+   // Both Boundables must accept the layers of the other.
+   a.setCollisionLayers(0x2);
+   b.setCollisionMask(0x1);
+   REQUIRE(!a.isCollidable(&b));
+   REQUIRE(!b.isCollidable(&a));
+   b.setCollisionMask(0x3);
+   REQUIRE(a.isCollidable(&b));
+
+   a.setStatic(true);
+   REQUIRE(a.isCollidable(&b));
+   b.setStatic(true);
+   REQUIRE(!a.isCollidable(&b));
+
+   // Filtering settings are copied along with the Boundable.
+   BoundingBox c(a);
+   REQUIRE(c.getCollisionLayers() == 0x2);
+   REQUIRE(c.isStatic());
+}
+
+TEST_CASE("crash/space/boundable/filtered_pairs") {
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 200; ++ndx) {
+      boxes.push_back(BoundingBox(Transformer(randomVector(8.0f),
+       axisAngleToQuat(randomVector(1.0f), rand_float(0.0f, pi)),
+       glm::vec3(rand_float(0.5f, 2.0f)),
+       glm::vec3(), NO_ROTATION, glm::vec3())));
+
+      BoundingBox& box = boxes.back();
+      box.setCollisionLayers(1 << (ndx % 3));
+      box.setCollisionMask((ndx % 3 == 2) ? 0x3 : Boundable::ALL_LAYERS);
+      box.setStatic(ndx % 4 == 0);
+   }
+
+   BoundingGroup boundingGroup(Transformer(ORIGIN, NO_ROTATION,
+    glm::vec3(40.0f), glm::vec3(), NO_ROTATION, glm::vec3()));
+   BoundingPartition boundingPartition(Transformer(ORIGIN, NO_ROTATION,
+    glm::vec3(40.0f), glm::vec3(), NO_ROTATION, glm::vec3()),
+    glm::ivec3(4));
+   SweepAndPrune sweepAndPrune;
+   DynamicTree dynamicTree;
+   SpatialHash spatialHash(4.0f);
+   LinearBVH linearBVH;
+   for (BoundingBox& box : boxes) {
+      boundingGroup.add(&box);
+      boundingPartition.add(&box);
+      sweepAndPrune.add(&box);
+      dynamicTree.add(&box);
+      spatialHash.add(&box);
+      linearBVH.add(&box);
+   }
+
+   std::vector< Collision > expected;
+   for (unsigned int a = 0; a < boxes.size(); ++a) {
+      for (unsigned int b = a + 1; b < boxes.size(); ++b) {
+         if (boxes[a].isCollidable(&boxes[b]) &&
+          boxes[a].isIntersecting(&boxes[b])) {
+            expected.push_back(Collision::factory(&boxes[a], &boxes[b]));
+         }
+      }
+   }
+
+   requireSamePairs(boundingGroup.getCollidingElements(), expected);
+   requireSamePairs(boundingPartition.getCollidingElements(), expected);
+   requireSamePairs(sweepAndPrune.getCollidingElements(), expected);
+   requireSamePairs(dynamicTree.getCollidingElements(), expected);
+   requireSamePairs(spatialHash.getCollidingElements(), expected);
+   requireSamePairs(linearBVH.getCollidingElements(), expected);
+
+   // No candidate is ever generated for a filtered pair.
+   for (const Collision& candidate : sweepAndPrune.getCandidateElements()) {
+      REQUIRE(candidate.getFirst()->isCollidable(candidate.getSecond()));
+   }
+   for (const Collision& candidate :
+    boundingPartition.getCandidateElements()) {
+      REQUIRE(candidate.getFirst()->isCollidable(candidate.getSecond()));
+   }
+}
+
+TEST_CASE("crash/space/boundable/sleeping") {
+   BoundingBox box(Transformer(ORIGIN, NO_ROTATION, UNIT_SIZE,
+    glm::vec3(), NO_ROTATION, glm::vec3()));
+   REQUIRE(!box.isSleeping());
+   REQUIRE(!box.isMoving());
+
+   // Moving without velocity leaves the transform untouched.
+   box.move(1.0f);
+   REQUIRE(box.getPosition() == ORIGIN);
+   REQUIRE(box.getOrientation() == NO_ROTATION);
+   REQUIRE(box.getSize() == UNIT_SIZE);
+
+   box.setSleeping(true);
+   BoundingBox copy(box);
+   REQUIRE(copy.isSleeping());
+
+   // Moving a sleeping Boundable directly wakes it.
+   copy.setPosition(glm::vec3(2.0f));
+   REQUIRE(!copy.isSleeping());
+   copy.setSleeping(true);
+   copy.setOrientation(axisAngleToQuat(UP, 0.5f));
+   REQUIRE(!copy.isSleeping());
+   copy.setSleeping(true);
+   copy.setSize(UNIT_SIZE * 2.0f);
+   REQUIRE(!copy.isSleeping());
+
+   box.setTranslationalVelocity(glm::vec3(1.0f, 0.0f, 0.0f));
+   REQUIRE(box.isMoving());
+   box.move(0.5f);
+   REQUIRE(box.getPosition() == glm::vec3(0.5f, 0.0f, 0.0f));
+
+   box.setTranslationalVelocity(glm::vec3());
+   box.setRotationalVelocity(axisAngleToQuat(UP, 0.5f));
+   REQUIRE(box.isMoving());
+   box.setRotationalVelocity(NO_ROTATION);
+   box.setScaleVelocity(glm::vec3(0.1f));
+   REQUIRE(box.isMoving());
+}
@@ -0,0 +1,82 @@
+#include <catch.hpp>
+#include <vector>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/render/view_frustum.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/bounding_box_array.hpp>
+
+using namespace crash::common;
+using namespace crash::render;
+using namespace crash::space;
+
+static BoundingBox randomCube(float range) {
+   glm::vec3 position = glm::vec3(
+    rand_float(-range, range), rand_float(-range, range),
+    rand_float(-range, 0.0f));
+   glm::quat orientation = axisAngleToQuat(glm::vec3(
+    rand_float(-1.0f, 1.0f), rand_float(-1.0f, 1.0f), 1.0f),
+    rand_float(0.0f, pi));
+
+   return BoundingBox(Transformer(position, orientation,
+    glm::vec3(rand_float(0.5f, 4.0f)), glm::vec3(), NO_ROTATION, glm::vec3()));
+}
+
+TEST_CASE("crash/space/bounding_box_array/data") {
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 3; ++ndx) {
+      boxes.push_back(randomCube(10.0f));
+   }
+
+   BoundingBoxArray array;
+   for (BoundingBox& box : boxes) {
+      array.add(&box);
+   }
+
+   REQUIRE(array.getNumBoundables() == 3);
+   REQUIRE(array.getCenter(1) == boxes[1].getPosition());
+   REQUIRE(array.getHalfExtents(2) == boxes[2].getSize() * 0.5f);
+
+   array.remove(0);
+
+   REQUIRE(array.getNumBoundables() == 2);
+   REQUIRE(array.getBoundable(0) == &boxes[2]);
+   REQUIRE(array.getCenter(0) == boxes[2].getPosition());
+
+   boxes[1].setPosition(ORIGIN);
+   array.update();
+
+   REQUIRE(array.getCenter(1) == ORIGIN);
+}
+
+TEST_CASE("crash/space/bounding_box_array/cull_against") {
+   ViewFrustum viewFrustum = ViewFrustum::fromValues(glm::radians(60.0f),
+    1.0f, 1.0f, 50.0f, glm::mat4());
+
+   // An odd count exercises both the vector and the remainder paths.
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 1003; ++ndx) {
+      boxes.push_back(randomCube(60.0f));
+   }
+
+   BoundingBoxArray array;
+   for (BoundingBox& box : boxes) {
+      array.add(&box);
+   }
+
+   BoundingBoxArray::Bitmask visible;
+   array.cullAgainst(viewFrustum, visible);
+
+   REQUIRE(visible.size() == (boxes.size() + 31) / 32);
+
+   unsigned int numVisible = 0;
+   for (unsigned int ndx = 0; ndx < boxes.size(); ++ndx) {
+      bool expected = boxes[ndx].isVisible(viewFrustum);
+      REQUIRE(BoundingBoxArray::isSet(visible, ndx) == expected);
+      numVisible += expected;
+   }
+
+   REQUIRE(numVisible > 0);
+   REQUIRE(numVisible < boxes.size());
+}
@@ -0,0 +1,84 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/render/view_frustum.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/bounding_grid.hpp>
+#include "helpers.hpp"
+
+using namespace crash::common;
+using namespace crash::render;
+using namespace crash::space;
+
+static void requireGridQueries(SpatialIndex& grid) {
+   // Some boxes lie beyond the sides of the grid.
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 300; ++ndx) {
+      boxes.push_back(randomBox(14.0f));
+   }
+
+   for (BoundingBox& box : boxes) {
+      REQUIRE(grid.add(&box));
+   }
+   REQUIRE(grid.getNumBoundables() == boxes.size());
+   requireTracksMovement(grid, boxes);
+
+   ViewFrustum viewFrustum = ViewFrustum::fromValues(glm::radians(60.0f),
+    1.0f, 1.0f, 12.0f, glm::mat4());
+   std::vector< Boundable* > visible = grid.getVisibleElements(viewFrustum);
+   std::sort(visible.begin(), visible.end());
+   REQUIRE(std::unique(visible.begin(), visible.end()) == visible.end());
+   for (Boundable* boundable : visible) {
+      REQUIRE(boundable->isVisible(viewFrustum));
+   }
+
+   grid.clear();
+   REQUIRE(grid.getNumBoundables() == 0);
+   REQUIRE(grid.getCandidateElements().empty());
+}
+
+TEST_CASE("crash/space/bounding_grid/indices") {
+   typedef BoundingGridT< 8, 4, 2, DynamicCellPolicy > Grid;
+   REQUIRE(Grid::NUM_CELLS == 64);
+
+   for (unsigned int ndx = 0; ndx < Grid::NUM_CELLS; ++ndx) {
+      REQUIRE(Grid::linearize(Grid::vectorize(ndx)) == ndx);
+   }
+   REQUIRE(Grid::linearize(glm::ivec3(1, 2, 1)) == 1 + 8 * (2 + 4 * 1));
+}
+
+TEST_CASE("crash/space/bounding_grid/dynamic_cells") {
+   std::unique_ptr< BoundingGridT< 8, 8, 8, DynamicCellPolicy > > grid(
+    new BoundingGridT< 8, 8, 8, DynamicCellPolicy >(glm::vec3(-12.0f),
+    glm::vec3(3.0f)));
+   requireGridQueries(*grid);
+   REQUIRE(grid->getNumOverflowing() == 0);
+}
+
+TEST_CASE("crash/space/bounding_grid/fixed_cells") {
+   // Cells this small overflow, which must not lose any pairs.
+   std::unique_ptr< BoundingGridT< 5, 3, 7, FixedCellPolicy< 4 > > > grid(
+    new BoundingGridT< 5, 3, 7, FixedCellPolicy< 4 > >(glm::vec3(-10.0f),
+    glm::vec3(4.0f, 6.0f, 3.0f)));
+   requireGridQueries(*grid);
+
+   BoundingBox a(Transformer(glm::vec3(1.0f), NO_ROTATION, UNIT_SIZE * 0.5f,
+    glm::vec3(), NO_ROTATION, glm::vec3()));
+   std::vector< BoundingBox > boxes(5, a);
+   for (BoundingBox& box : boxes) {
+      grid->add(&box);
+   }
+   REQUIRE(grid->getNumOverflowing() == 1);
+   REQUIRE(grid->getNumMembers(glm::ivec3(2, 1, 3)) == 4);
+   REQUIRE(grid->getCollidingElements().size() == 10);
+
+   // Room left by a removal is taken by the next update to move cells.
+   grid->remove(&boxes[0]);
+   boxes[4].translate(glm::vec3(4.0f, 0.0f, 0.0f));
+   grid->update(&boxes[4]);
+   REQUIRE(grid->getNumOverflowing() == 0);
+}
@@ -0,0 +1,248 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+#include <glm/gtc/quaternion.hpp>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/thread_pool.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/render/view_frustum.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/bounding_group.hpp>
+#include <crash/space/bounding_partition.hpp>
+#include "helpers.hpp"
+
+using namespace crash::common;
+using namespace crash::render;
+using namespace crash::space;
+
+static std::vector< Boundable* > getMembers(const BoundingGroup& group) {
+   std::vector< Boundable* > members(group.getBoundables().begin(),
+    group.getBoundables().end());
+   std::sort(members.begin(), members.end());
+   return members;
+}
+
+TEST_CASE("crash/space/bounding_partition/update_membership") {
+   glm::quat orientation = axisAngleToQuat(glm::vec3(2.0f, 1.0f, 1.0f),
+    pi * 0.15f);
+   Transformer transformer(glm::vec3(1.0f, 2.0f, -3.0f), orientation,
+    glm::vec3(24.0f, 20.0f, 28.0f), glm::vec3(), NO_ROTATION, glm::vec3());
+
+   // Some boxes wander past the partition and back.
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 200; ++ndx) {
+      float size = (ndx % 20 == 0) ? 10.0f : 1.5f;
+      boxes.push_back(makeBox(glm::vec3(1.0f, 2.0f, -3.0f) +
+       randomVector(-16.0f, 16.0f), axisAngleToQuat(randomVector(-1.0f, 1.0f)
+       + Z_AXIS, rand_float(0.0f, pi)), randomVector(0.2f, 1.0f) * size));
+   }
+
+   BoundingPartition actual(transformer, glm::ivec3(6, 5, 7));
+   for (BoundingBox& box : boxes) {
+      REQUIRE(actual.add(&box));
+      REQUIRE(!actual.add(&box));
+   }
+
+   for (unsigned int frame = 0; frame < 10; ++frame) {
+      for (BoundingBox& box : boxes) {
+         box.translate(randomVector(-3.0f, 3.0f));
+         box.rotate(axisAngleToQuat(randomVector(-1.0f, 1.0f) + Z_AXIS,
+          rand_float(0.0f, 0.5f)));
+         actual.update(&box);
+      }
+   }
+
+   // Updating leaves every group with exactly the members that adding the
+   // boxes afresh would give it.
+   BoundingPartition expected(transformer, glm::ivec3(6, 5, 7));
+   for (BoundingBox& box : boxes) {
+      expected.add(&box);
+   }
+
+   REQUIRE(actual.getNumBoundables() == boxes.size());
+   std::vector< BoundingGroup > actualGroups = actual.getBoundingGroups();
+   std::vector< BoundingGroup > expectedGroups = expected.getBoundingGroups();
+   REQUIRE(actualGroups.size() == expectedGroups.size());
+   for (unsigned int ndx = 0; ndx < actualGroups.size(); ++ndx) {
+      REQUIRE(getMembers(actualGroups[ndx]) ==
+       getMembers(expectedGroups[ndx]));
+   }
+   requireSamePairs(actual.getCollidingElements(),
+    expected.getCollidingElements());
+
+   // An update that stays within the same groups changes nothing.
+   REQUIRE(!actual.update(&boxes[1]));
+
+   for (BoundingBox& box : boxes) {
+      REQUIRE(actual.remove(&box));
+   }
+   REQUIRE(actual.getNumBoundables() == 0);
+   for (const BoundingGroup& group : actual.getBoundingGroups()) {
+      REQUIRE(group.getBoundables().empty());
+   }
+}
+
+TEST_CASE("crash/space/bounding_partition/unique_boundables") {
+   ViewFrustum viewFrustum = ViewFrustum::fromValues(glm::radians(60.0f),
+    1.0f, 1.0f, 30.0f, glm::mat4());
+   BoundingPartition partition(Transformer(glm::vec3(0.0f, 0.0f, -10.0f),
+    NO_ROTATION, glm::vec3(24.0f), glm::vec3(), NO_ROTATION, glm::vec3()),
+    glm::ivec3(10));
+
+   // Large boxes lie in dozens of groups each.
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 100; ++ndx) {
+      boxes.push_back(makeBox(randomVector(-14.0f, 14.0f) +
+       glm::vec3(0.0f, 0.0f, -10.0f), NO_ROTATION, randomVector(4.0f, 12.0f)));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   unsigned int numVisible = 0;
+   for (BoundingBox& box : boxes) {
+      numVisible += box.isVisible(viewFrustum);
+   }
+
+   // Repeated queries each see every Boundable exactly once.
+   for (unsigned int trial = 0; trial < 3; ++trial) {
+      std::vector< Boundable* > boundables = partition.getBoundables();
+      std::set< Boundable* > unique(boundables.begin(), boundables.end());
+      REQUIRE(boundables.size() == boxes.size());
+      REQUIRE(unique.size() == boxes.size());
+
+      std::vector< Boundable* > visible =
+       partition.getVisibleElements(viewFrustum);
+      std::set< Boundable* > uniqueVisible(visible.begin(), visible.end());
+      REQUIRE(uniqueVisible.size() == visible.size());
+      REQUIRE(visible.size() == numVisible);
+   }
+}
+
+TEST_CASE("crash/space/bounding_partition/unique_pairs") {
+   glm::quat orientation = axisAngleToQuat(glm::vec3(1.0f, 3.0f, 2.0f),
+    pi * 0.25f);
+   glm::vec3 center = glm::vec3(2.0f, -1.0f, 3.0f);
+   BoundingPartition partition(Transformer(center, orientation,
+    glm::vec3(24.0f), glm::vec3(), NO_ROTATION, glm::vec3()),
+    glm::ivec3(12));
+
+   // Large boxes lie in dozens of groups each, and share many of them with
+   // each other. Every box stays centered within the partition, since pairs
+   // outside of it are not reported.
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 150; ++ndx) {
+      float size = (ndx % 3 == 0) ? 10.0f : 2.0f;
+      boxes.push_back(makeBox(center + orientation * randomVector(-10.0f,
+       10.0f), axisAngleToQuat(randomVector(-1.0f, 1.0f) + Z_AXIS,
+       rand_float(0.0f, pi)), randomVector(0.3f, 1.0f) * size));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   ThreadPool threadPool(4);
+   for (ThreadPool* pool : { (ThreadPool*)nullptr, &threadPool }) {
+      partition.setThreadPool(pool);
+
+      std::vector< Collision > colliding = partition.getCollidingElements();
+      std::set< std::pair< Boundable*, Boundable* > > unique;
+      for (const Collision& collision : colliding) {
+         Boundable* a = std::min(collision.getFirst(), collision.getSecond());
+         Boundable* b = std::max(collision.getFirst(), collision.getSecond());
+         REQUIRE(unique.insert(std::make_pair(a, b)).second);
+      }
+      requireIntersectingPairs(partition);
+   }
+}
+
+TEST_CASE("crash/space/bounding_partition/parallel_visible") {
+   glm::quat orientation = axisAngleToQuat(glm::vec3(1.0f, 2.0f, 1.0f),
+    pi * 0.2f);
+   BoundingPartition partition(Transformer(glm::vec3(0.0f, 0.0f, -10.0f),
+    orientation, glm::vec3(28.0f), glm::vec3(), NO_ROTATION, glm::vec3()),
+    glm::ivec3(9, 7, 8));
+
+   // Some boxes span several groups, and some lie outside of the partition.
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 400; ++ndx) {
+      float size = (ndx % 10 == 0) ? 8.0f : 1.5f;
+      boxes.push_back(makeBox(randomVector(-18.0f, 18.0f) +
+       glm::vec3(0.0f, 0.0f, -10.0f), NO_ROTATION,
+       randomVector(0.2f, 1.0f) * size));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   ThreadPool twoThreads(2);
+   ThreadPool threeThreads(3);
+   ThreadPool fourThreads(4);
+   for (unsigned int trial = 0; trial < 10; ++trial) {
+      glm::mat4 view = glm::mat4_cast(axisAngleToQuat(
+       randomVector(-1.0f, 1.0f) + Y_AXIS, rand_float(-0.5f, 0.5f)));
+      ViewFrustum viewFrustum = ViewFrustum::fromValues(glm::radians(60.0f),
+       1.0f, 1.0f, 30.0f, view);
+
+      partition.setThreadPool(nullptr);
+      std::vector< Boundable* > expected =
+       partition.getVisibleElements(viewFrustum);
+
+      // Every pool size finds the same Boundables in the same order.
+      for (ThreadPool* pool : { &twoThreads, &threeThreads, &fourThreads }) {
+         partition.setThreadPool(pool);
+         REQUIRE(partition.getVisibleElements(viewFrustum) == expected);
+      }
+   }
+}
+
+TEST_CASE("crash/space/bounding_partition/plane_masks") {
+   glm::quat orientation = axisAngleToQuat(glm::vec3(2.0f, 1.0f, 3.0f),
+    pi * 0.3f);
+   BoundingPartition partition(Transformer(glm::vec3(0.0f, 0.0f, -20.0f),
+    orientation, glm::vec3(36.0f), glm::vec3(), NO_ROTATION, glm::vec3()),
+    glm::ivec3(8));
+
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 400; ++ndx) {
+      float size = (ndx % 10 == 0) ? 8.0f : 1.5f;
+      boxes.push_back(makeBox(randomVector(-22.0f, 22.0f) +
+       glm::vec3(0.0f, 0.0f, -20.0f), axisAngleToQuat(randomVector(-1.0f,
+       1.0f) + Z_AXIS, rand_float(0.0f, pi)),
+       randomVector(0.2f, 1.0f) * size));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   // Wide views leave many groups entirely inside the ViewFrustum, so their
+   // members skip some or all of the planes.
+   ThreadPool threadPool(4);
+   for (unsigned int trial = 0; trial < 20; ++trial) {
+      glm::mat4 view = glm::mat4_cast(axisAngleToQuat(
+       randomVector(-1.0f, 1.0f) + Y_AXIS, rand_float(-0.5f, 0.5f)));
+      ViewFrustum viewFrustum = ViewFrustum::fromValues(
+       glm::radians(rand_float(30.0f, 120.0f)), 1.0f, 1.0f,
+       rand_float(10.0f, 60.0f), view);
+
+      std::vector< Boundable* > expected;
+      for (BoundingBox& box : boxes) {
+         if (box.isVisible(viewFrustum)) {
+            expected.push_back(&box);
+         }
+      }
+      std::sort(expected.begin(), expected.end());
+
+      for (ThreadPool* pool : { (ThreadPool*)nullptr, &threadPool }) {
+         partition.setThreadPool(pool);
+
+         std::vector< Boundable* > visible =
+          partition.getVisibleElements(viewFrustum);
+         std::sort(visible.begin(), visible.end());
+         REQUIRE(visible == expected);
+      }
+   }
+}
@@ -0,0 +1,646 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+#include <glm/gtc/quaternion.hpp>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/line.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/thread_pool.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/render/view_frustum.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/bounding_partition.hpp>
+#include <crash/space/ray_hit.hpp>
+#include "helpers.hpp"
+
+using namespace crash::common;
+using namespace crash::render;
+using namespace crash::space;
+
+TEST_CASE("crash/space/bounding_partition/raycast") {
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 4; ++ndx) {
+      boxes.push_back(makeBox(glm::vec3(4.0f * ndx, 0.0f, 0.0f), NO_ROTATION,
+       UNIT_SIZE));
+   }
+   boxes.push_back(makeBox(glm::vec3(4.0f, 4.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE));
+
+   BoundingPartition partition(Transformer(glm::vec3(6.0f, 0.0f, 0.0f),
+    NO_ROTATION, glm::vec3(16.0f), glm::vec3(), NO_ROTATION, glm::vec3()),
+    glm::ivec3(8));
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   Line ray(glm::vec3(-5.0f, 0.0f, 0.0f), glm::vec3(2.0f, 0.0f, 0.0f));
+   std::vector< RayHit > hits = partition.raycast(ray, 15.0f);
+
+   REQUIRE(hits.size() == 3);
+   for (unsigned int ndx = 0; ndx < hits.size(); ++ndx) {
+      REQUIRE(hits[ndx].boundable == &boxes[ndx]);
+      REQUIRE(glm::abs(hits[ndx].distance - (4.5f + 4.0f * ndx)) < 1e-4f);
+   }
+
+   hits = partition.raycast(ray, 15.0f, 1);
+   REQUIRE(hits.size() == 1);
+   REQUIRE(hits[0].boundable == &boxes[0]);
+
+   hits = partition.segmentCast(glm::vec3(2.0f, 0.0f, 0.0f),
+    glm::vec3(2.0f, 10.0f, 0.0f), 4);
+   REQUIRE(hits.empty());
+
+   hits = partition.segmentCast(glm::vec3(4.0f, -3.0f, 0.0f),
+    glm::vec3(4.0f, 10.0f, 0.0f), 4);
+   REQUIRE(hits.size() == 2);
+   REQUIRE(hits[0].boundable == &boxes[1]);
+   REQUIRE(hits[1].boundable == &boxes[4]);
+}
+
+TEST_CASE("crash/space/bounding_partition/raycast_random") {
+   glm::quat orientation = axisAngleToQuat(glm::vec3(1.0f, 2.0f, 3.0f),
+    pi * 0.2f);
+   BoundingPartition partition(Transformer(glm::vec3(1.0f, -2.0f, 0.5f),
+    orientation, glm::vec3(20.0f, 12.0f, 16.0f), glm::vec3(), NO_ROTATION,
+    glm::vec3()), glm::ivec3(7, 5, 6));
+
+   // Some boxes reach past the partition or lie entirely outside of it.
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 200; ++ndx) {
+      glm::quat rotation = axisAngleToQuat(randomVector(-1.0f, 1.0f) +
+       Z_AXIS, rand_float(0.0f, pi));
+      boxes.push_back(makeBox(randomVector(-14.0f, 14.0f), rotation,
+       randomVector(0.2f, 3.0f)));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   for (unsigned int trial = 0; trial < 200; ++trial) {
+      Line ray(randomVector(-16.0f, 16.0f), randomVector(-1.0f, 1.0f));
+      float maxDistance = rand_float(5.0f, 40.0f);
+
+      std::vector< RayHit > expected;
+      for (BoundingBox& box : boxes) {
+         Line normalized(ray.point, glm::normalize(ray.direction));
+         auto distance = box.intersectRay(normalized);
+         if (distance && distance.get() <= maxDistance) {
+            expected.push_back(RayHit(&box, distance.get()));
+         }
+      }
+      std::sort(expected.begin(), expected.end());
+
+      std::vector< RayHit > hits = partition.raycast(ray, maxDistance);
+      REQUIRE(hits.size() == expected.size());
+      for (unsigned int ndx = 0; ndx < hits.size(); ++ndx) {
+         REQUIRE(hits[ndx].distance == expected[ndx].distance);
+      }
+
+      std::vector< RayHit > nearest = partition.raycast(ray, maxDistance, 3);
+      REQUIRE(nearest.size() == std::min< std::size_t >(3, expected.size()));
+      for (unsigned int ndx = 0; ndx < nearest.size(); ++ndx) {
+         REQUIRE(nearest[ndx].distance == expected[ndx].distance);
+      }
+   }
+}
+
+TEST_CASE("crash/space/bounding_partition/neighbors") {
+   glm::quat orientation = axisAngleToQuat(glm::vec3(3.0f, 1.0f, 2.0f),
+    pi * 0.3f);
+   BoundingPartition partition(Transformer(glm::vec3(-1.0f, 2.0f, 0.0f),
+    orientation, glm::vec3(16.0f, 20.0f, 12.0f), glm::vec3(), NO_ROTATION,
+    glm::vec3()), glm::ivec3(6, 8, 5));
+
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 200; ++ndx) {
+      glm::quat rotation = axisAngleToQuat(randomVector(-1.0f, 1.0f) +
+       Z_AXIS, rand_float(0.0f, pi));
+      boxes.push_back(makeBox(randomVector(-14.0f, 14.0f), rotation,
+       randomVector(0.2f, 3.0f)));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   std::vector< Boundable* > results;
+   for (unsigned int trial = 0; trial < 200; ++trial) {
+      glm::vec3 center = randomVector(-18.0f, 18.0f);
+      float radius = rand_float(0.0f, 8.0f);
+
+      std::vector< float > distances;
+      unsigned int numWithin = 0;
+      for (BoundingBox& box : boxes) {
+         distances.push_back(box.getDistance(center));
+         numWithin += distances.back() <= radius;
+      }
+      std::sort(distances.begin(), distances.end());
+
+      partition.queryRadius(center, radius, results);
+      REQUIRE(results.size() == numWithin);
+      for (Boundable* boundable : results) {
+         REQUIRE(boundable->getBoundingBox()->getDistance(center) <= radius);
+      }
+
+      partition.queryNearest(center, 5, results);
+      REQUIRE(results.size() == 5);
+      for (unsigned int ndx = 0; ndx < results.size(); ++ndx) {
+         REQUIRE(results[ndx]->getBoundingBox()->getDistance(center) ==
+          distances[ndx]);
+      }
+   }
+}
+
+TEST_CASE("crash/space/bounding_partition/visitors") {
+   ViewFrustum viewFrustum = ViewFrustum::fromValues(glm::radians(60.0f),
+    1.0f, 1.0f, 30.0f, glm::mat4());
+   BoundingPartition partition(Transformer(glm::vec3(0.0f, 0.0f, -10.0f),
+    NO_ROTATION, glm::vec3(24.0f), glm::vec3(), NO_ROTATION, glm::vec3()),
+    glm::ivec3(6));
+
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 300; ++ndx) {
+      boxes.push_back(makeBox(randomVector(-14.0f, 14.0f) +
+       glm::vec3(0.0f, 0.0f, -10.0f), NO_ROTATION, randomVector(0.2f, 3.0f)));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   ThreadPool threadPool(4);
+   for (ThreadPool* pool : { (ThreadPool*)nullptr, &threadPool }) {
+      partition.setThreadPool(pool);
+
+      std::vector< Boundable* > visible;
+      partition.forEachVisible(viewFrustum, [&visible](Boundable* boundable) {
+         visible.push_back(boundable);
+      });
+      REQUIRE(visible == partition.getVisibleElements(viewFrustum));
+
+      std::vector< Collision > colliding = partition.getCollidingElements();
+      unsigned int numPairs = 0;
+      partition.forEachPair([&colliding, &numPairs](const Collision& pair) {
+         REQUIRE(pair.getFirst() == colliding[numPairs].getFirst());
+         REQUIRE(pair.getSecond() == colliding[numPairs].getSecond());
+         ++numPairs;
+      });
+      REQUIRE(numPairs == colliding.size());
+   }
+
+   unsigned int numMembers = 0;
+   for (unsigned int ndx = 0; ndx < partition.getNumBoundingGroups(); ++ndx) {
+      const BoundingGroup& group = partition.getBoundingGroup(ndx);
+      partition.forEachInCell(ndx, [&group, &numMembers](Boundable* member) {
+         glm::vec3 offset = glm::abs(member->getPosition() -
+          group.getPosition());
+         REQUIRE(glm::all(glm::lessThanEqual(offset,
+          (member->getSize() + group.getSize()) * 0.5f + 1.0e-4f)));
+         ++numMembers;
+      });
+   }
+   REQUIRE(numMembers > boxes.size());
+}
+
+TEST_CASE("crash/space/bounding_partition/hierarchical") {
+   ViewFrustum viewFrustum = ViewFrustum::fromValues(glm::radians(60.0f),
+    1.0f, 1.0f, 30.0f, glm::mat4());
+   glm::quat orientation = axisAngleToQuat(glm::vec3(1.0f, 1.0f, 2.0f),
+    pi * 0.1f);
+   glm::vec3 center = glm::vec3(0.0f, 0.0f, -10.0f);
+   BoundingPartition partition(Transformer(center, orientation,
+    glm::vec3(28.0f, 24.0f, 32.0f), glm::vec3(), NO_ROTATION, glm::vec3()),
+    glm::ivec3(12, 5, 9));
+
+   // Mostly small boxes, with a few that span much or all of the partition.
+   // Every box stays centered within the partition, since pairs outside of it
+   // are not reported.
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 300; ++ndx) {
+      float size = (ndx % 30 == 0) ? 30.0f : ((ndx % 7 == 0) ? 6.0f : 1.5f);
+      glm::quat rotation = axisAngleToQuat(randomVector(-1.0f, 1.0f) +
+       Z_AXIS, rand_float(0.0f, pi));
+      boxes.push_back(makeBox(center + orientation * randomVector(-7.0f, 7.0f),
+       rotation, randomVector(0.2f, 1.0f) * size));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   partition.setHierarchical(true);
+   REQUIRE(partition.getHierarchical());
+   REQUIRE(partition.getNumLevels() == 5);
+   REQUIRE(partition.getNumBoundables() == boxes.size());
+
+   for (unsigned int ndx = 0; ndx < boxes.size(); ndx += 3) {
+      boxes[ndx].setPosition(boxes[ndx].getPosition() + randomVector(-2.0f,
+       2.0f));
+      partition.update(&boxes[ndx]);
+   }
+
+   ThreadPool threadPool(4);
+   for (ThreadPool* pool : { (ThreadPool*)nullptr, &threadPool }) {
+      partition.setThreadPool(pool);
+
+      std::set< std::pair< Boundable*, Boundable* > > pairs;
+      for (const Collision& collision : partition.getCollidingElements()) {
+         Boundable* a = std::min(collision.getFirst(), collision.getSecond());
+         Boundable* b = std::max(collision.getFirst(), collision.getSecond());
+         REQUIRE(pairs.insert(std::make_pair(a, b)).second);
+      }
+
+      unsigned int expected = 0;
+      for (unsigned int a = 0; a < boxes.size(); ++a) {
+         for (unsigned int b = a + 1; b < boxes.size(); ++b) {
+            expected += boxes[a].isIntersecting(&boxes[b]);
+         }
+      }
+      REQUIRE(pairs.size() == expected);
+
+      std::vector< Boundable* > visible =
+       partition.getVisibleElements(viewFrustum);
+      std::set< Boundable* > unique(visible.begin(), visible.end());
+      REQUIRE(unique.size() == visible.size());
+
+      unsigned int numVisible = 0;
+      for (BoundingBox& box : boxes) {
+         numVisible += box.isVisible(viewFrustum);
+      }
+      REQUIRE(numVisible == visible.size());
+   }
+
+   std::vector< Boundable* > results;
+   for (unsigned int trial = 0; trial < 50; ++trial) {
+      Line ray(center + randomVector(-16.0f, 16.0f),
+       randomVector(-1.0f, 1.0f));
+      Line normalized(ray.point, glm::normalize(ray.direction));
+      glm::vec3 point = center + randomVector(-16.0f, 16.0f);
+
+      std::vector< float > hitDistances;
+      std::vector< float > distances;
+      for (BoundingBox& box : boxes) {
+         auto distance = box.intersectRay(normalized);
+         if (distance && distance.get() <= 30.0f) {
+            hitDistances.push_back(distance.get());
+         }
+         distances.push_back(box.getDistance(point));
+      }
+      std::sort(hitDistances.begin(), hitDistances.end());
+      std::sort(distances.begin(), distances.end());
+
+      std::vector< RayHit > hits = partition.raycast(ray, 30.0f, 4);
+      REQUIRE(hits.size() == std::min< std::size_t >(4, hitDistances.size()));
+      for (unsigned int ndx = 0; ndx < hits.size(); ++ndx) {
+         REQUIRE(hits[ndx].distance == hitDistances[ndx]);
+      }
+
+      partition.queryNearest(point, 4, results);
+      REQUIRE(results.size() == 4);
+      for (unsigned int ndx = 0; ndx < results.size(); ++ndx) {
+         REQUIRE(results[ndx]->getBoundingBox()->getDistance(point) ==
+          distances[ndx]);
+      }
+
+      partition.queryRadius(point, 3.0f, results);
+      REQUIRE(results.size() == (unsigned int)(std::upper_bound(
+       distances.begin(), distances.end(), 3.0f) - distances.begin()));
+   }
+}
+
+TEST_CASE("crash/space/bounding_partition/rebalance") {
+   BoundingPartition partition(Transformer(glm::vec3(), NO_ROTATION,
+    glm::vec3(40.0f), glm::vec3(), NO_ROTATION, glm::vec3()), glm::ivec3(2));
+
+   // Boxes jitter around their homes, which keeps them within the partition.
+   std::vector< glm::vec3 > homes;
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 600; ++ndx) {
+      homes.push_back(randomVector(-17.0f, 17.0f));
+      boxes.push_back(makeBox(homes.back(), NO_ROTATION, UNIT_SIZE));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   BoundingPartition::Occupancy before = partition.getOccupancy();
+   REQUIRE(before.numCells == 8);
+   REQUIRE(before.numOccupied == 8);
+   REQUIRE(before.maxMembers >= before.meanMembers);
+   REQUIRE(before.meanMembers > 8.0f);
+   REQUIRE(before.numOutside == 0);
+   REQUIRE(before.numOverhanging == 0);
+
+   // Nothing changes until automatic partitioning is enabled.
+   for (unsigned int frame = 0; frame < 100; ++frame) {
+      REQUIRE(!partition.rebalance());
+   }
+
+   partition.setAutoPartition(true);
+   partition.setOccupancyLimits(8.0f, 0.25f);
+   partition.setMigrationBudget(50);
+
+   unsigned int numRebalances = 0;
+   for (unsigned int frame = 0; frame < 120; ++frame) {
+      for (unsigned int ndx = 0; ndx < boxes.size(); ++ndx) {
+         boxes[ndx].setPosition(homes[ndx] + randomVector(-1.0f, 1.0f));
+         partition.update(&boxes[ndx]);
+      }
+
+      // Boundables come and go while the new grid is being filled.
+      if (partition.isRebalancing()) {
+         for (unsigned int ndx = frame % 5; ndx < boxes.size(); ndx += 50) {
+            REQUIRE(partition.remove(&boxes[ndx]));
+            REQUIRE(partition.add(&boxes[ndx]));
+         }
+      }
+
+      numRebalances += partition.rebalance();
+      REQUIRE(partition.getNumBoundables() == boxes.size());
+
+      if (frame % 10 != 0 && !partition.isRebalancing()) {
+         continue;
+      }
+
+      unsigned int expected = 0;
+      for (unsigned int a = 0; a < boxes.size(); ++a) {
+         for (unsigned int b = a + 1; b < boxes.size(); ++b) {
+            expected += boxes[a].isIntersecting(&boxes[b]);
+         }
+      }
+      REQUIRE(partition.getCollidingElements().size() == expected);
+   }
+
+   BoundingPartition::Occupancy after = partition.getOccupancy();
+   REQUIRE(numRebalances > 0);
+   REQUIRE(!partition.isRebalancing());
+   REQUIRE(partition.getPartitions() != glm::ivec3(2));
+   REQUIRE(after.numOccupied > before.numOccupied);
+   REQUIRE(after.meanMembers < before.meanMembers);
+}
+
+TEST_CASE("crash/space/bounding_partition/rebalance_clustered") {
+   BoundingPartition partition(Transformer(glm::vec3(), NO_ROTATION,
+    glm::vec3(40.0f), glm::vec3(), NO_ROTATION, glm::vec3()), glm::ivec3(2));
+   partition.setAutoPartition(true);
+   partition.setOccupancyLimits(8.0f, 0.25f);
+   partition.setMigrationBudget(1000);
+
+   // Boxes piled on one spot share every group they fall in, however small.
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 100; ++ndx) {
+      boxes.push_back(makeBox(glm::vec3(5.3f, 5.1f, 4.7f) +
+       randomVector(-0.2f, 0.2f), NO_ROTATION, UNIT_SIZE));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   unsigned int numRebalances = 0;
+   for (unsigned int frame = 0; frame < 1000; ++frame) {
+      numRebalances += partition.rebalance();
+   }
+
+   // Only a split that lowered the mean is followed by another, and there
+   // are never more than a few groups per box.
+   glm::ivec3 partitions = partition.getPartitions();
+   REQUIRE(numRebalances <= 2);
+   REQUIRE(partitions.x * partitions.y * partitions.z <=
+    4 * (int)boxes.size());
+   REQUIRE(partition.getCollidingElements().size() ==
+    boxes.size() * (boxes.size() - 1) / 2);
+}
+
+TEST_CASE("crash/space/bounding_partition/rebalance_incremental") {
+   BoundingPartition partition(Transformer(glm::vec3(), NO_ROTATION,
+    glm::vec3(40.0f), glm::vec3(), NO_ROTATION, glm::vec3()), glm::ivec3(1));
+   partition.setAutoPartition(true);
+   partition.setOccupancyLimits(8.0f, 0.25f);
+   partition.setMigrationBudget(1);
+
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 200; ++ndx) {
+      boxes.push_back(makeBox(randomVector(-19.0f, 19.0f), NO_ROTATION,
+       UNIT_SIZE));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+   unsigned int expected = partition.getCollidingElements().size();
+
+   // The old grid serves every query until the new one has been built and
+   // filled, which takes a call per few groups and then a call per box.
+   unsigned int numCalls = 0;
+   while (!partition.rebalance()) {
+      REQUIRE(partition.getPartitions() == glm::ivec3(1));
+      REQUIRE(partition.getNumBoundingGroups() == 1);
+      REQUIRE(partition.getCollidingElements().size() == expected);
+      REQUIRE(++numCalls < 1000);
+   }
+
+   glm::ivec3 partitions = partition.getPartitions();
+   unsigned int numGroups = partitions.x * partitions.y * partitions.z;
+   REQUIRE(numGroups > 1);
+   REQUIRE(numCalls >= boxes.size() + numGroups / 8);
+   REQUIRE(partition.getCollidingElements().size() == expected);
+}
+
+TEST_CASE("crash/space/bounding_partition/statistics") {
+   ViewFrustum viewFrustum = ViewFrustum::fromValues(glm::radians(60.0f),
+    1.0f, 1.0f, 30.0f, glm::mat4());
+   BoundingPartition partition(Transformer(glm::vec3(0.0f, 0.0f, -10.0f),
+    NO_ROTATION, glm::vec3(24.0f), glm::vec3(), NO_ROTATION, glm::vec3()),
+    glm::ivec3(6));
+
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 300; ++ndx) {
+      boxes.push_back(makeBox(randomVector(-14.0f, 14.0f) +
+       glm::vec3(0.0f, 0.0f, -10.0f), NO_ROTATION,
+       randomVector(0.5f, 3.0f)));
+   }
+   for (BoundingBox& box : boxes) {
+      partition.add(&box);
+   }
+
+   BoundingPartition::Occupancy occupancy = partition.getOccupancy();
+   std::vector< unsigned int > histogram = partition.getMemberHistogram();
+   REQUIRE(histogram.size() == occupancy.maxMembers + 1);
+
+   unsigned int numCells = 0;
+   unsigned int numPairs = 0;
+   for (unsigned int size = 0; size < histogram.size(); ++size) {
+      numCells += histogram[size];
+      numPairs += histogram[size] * size * (size - 1) / 2;
+   }
+   REQUIRE(numCells == occupancy.numCells);
+   REQUIRE(numCells - histogram[0] == occupancy.numOccupied);
+   REQUIRE(numPairs == occupancy.numCellPairs);
+
+   ThreadPool threadPool(3);
+   for (ThreadPool* pool : { (ThreadPool*)nullptr, &threadPool }) {
+      partition.setThreadPool(pool);
+
+      std::vector< Collision > colliding = partition.getCollidingElements();
+      const BoundingPartition::QueryStatistics& statistics =
+       partition.getQueryStatistics();
+      REQUIRE(statistics.numColliding == colliding.size());
+      REQUIRE(statistics.numCandidates ==
+       partition.getCandidateElements().size());
+      REQUIRE(statistics.numCandidates >= statistics.numColliding);
+      REQUIRE(statistics.collisionTime >= 0.0f);
+
+      unsigned int numPaired = 0;
+      partition.forEachPair([&numPaired](const Collision&) {
+         ++numPaired;
+      });
+      REQUIRE(statistics.numColliding == numPaired);
+
+      std::vector< Boundable* > visible =
+       partition.getVisibleElements(viewFrustum);
+      REQUIRE(statistics.numVisible == visible.size());
+      REQUIRE(statistics.visibilityTime >= 0.0f);
+   }
+
+   std::vector< RayHit > hits = partition.raycast(Line(glm::vec3(-20.0f,
+    0.0f, -10.0f), X_AXIS), 40.0f);
+   REQUIRE(partition.getQueryStatistics().numRayHits == hits.size());
+   REQUIRE(partition.getQueryStatistics().raycastTime >= 0.0f);
+}
+
+TEST_CASE("crash/space/bounding_partition/build") {
+   glm::quat orientation = axisAngleToQuat(glm::vec3(0.0f, 1.0f, 1.0f),
+    pi * 0.2f);
+   Transformer transformer(glm::vec3(3.0f, -2.0f, 1.0f), orientation,
+    glm::vec3(30.0f), glm::vec3(), NO_ROTATION, glm::vec3());
+
+   // Some boxes overhang the partition or lie entirely outside of it.
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 500; ++ndx) {
+      float size = (ndx % 25 == 0) ? 12.0f : 1.5f;
+      boxes.push_back(makeBox(glm::vec3(3.0f, -2.0f, 1.0f) +
+       randomVector(-20.0f, 20.0f), axisAngleToQuat(randomVector(-1.0f, 1.0f)
+       + Z_AXIS, rand_float(0.0f, pi)), randomVector(0.2f, 1.0f) * size));
+   }
+
+   std::vector< Boundable* > boundables;
+   for (BoundingBox& box : boxes) {
+      boundables.push_back(&box);
+   }
+   boundables.push_back(&boxes[0]);
+
+   ThreadPool threadPool(4);
+   for (bool hierarchical : { false, true }) {
+      BoundingPartition expected(transformer, glm::ivec3(7, 5, 6));
+      BoundingPartition actual(transformer, glm::ivec3(7, 5, 6));
+      expected.setHierarchical(hierarchical);
+      actual.setHierarchical(hierarchical);
+      for (Boundable* boundable : boundables) {
+         expected.add(boundable);
+      }
+
+      for (ThreadPool* pool : { (ThreadPool*)nullptr, &threadPool }) {
+         actual.setThreadPool(pool);
+         actual.build(boundables);
+         REQUIRE(actual.getNumBoundables() == boxes.size());
+
+         // Every cell lists the same members in the same order.
+         REQUIRE(actual.getNumBoundingGroups() ==
+          expected.getNumBoundingGroups());
+         for (unsigned int ndx = 0; ndx < actual.getNumBoundingGroups();
+          ++ndx) {
+            std::vector< Boundable* > actualMembers;
+            std::vector< Boundable* > expectedMembers;
+            actual.forEachInCell(ndx, [&actualMembers](Boundable* member) {
+               actualMembers.push_back(member);
+            });
+            expected.forEachInCell(ndx, [&expectedMembers](Boundable* member) {
+               expectedMembers.push_back(member);
+            });
+            REQUIRE(actualMembers == expectedMembers);
+         }
+
+         BoundingPartition::Occupancy actualOccupancy = actual.getOccupancy();
+         BoundingPartition::Occupancy expectedOccupancy =
+          expected.getOccupancy();
+         REQUIRE(actualOccupancy.numOutside == expectedOccupancy.numOutside);
+         REQUIRE(actualOccupancy.numOverhanging ==
+          expectedOccupancy.numOverhanging);
+         REQUIRE(actual.getCandidateElements().size() ==
+          expected.getCandidateElements().size());
+      }
+
+      // A built partition is maintained incrementally like any other.
+      for (BoundingBox& box : boxes) {
+         box.translate(randomVector(-1.0f, 1.0f));
+         actual.update(&box);
+         expected.update(&box);
+      }
+      REQUIRE(actual.remove(&boxes[1]));
+      REQUIRE(expected.remove(&boxes[1]));
+      REQUIRE(actual.getCandidateElements().size() ==
+       expected.getCandidateElements().size());
+   }
+}
+
+TEST_CASE("crash/space/bounding_partition/sweep_interval") {
+   float delta_t = 1.0f / 60.0f;
+   Transformer transformer(ORIGIN, NO_ROTATION, glm::vec3(40.0f),
+    glm::vec3(), NO_ROTATION, glm::vec3());
+
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 200; ++ndx) {
+      boxes.push_back(makeBox(randomVector(-18.0f, 18.0f),
+       axisAngleToQuat(randomVector(-1.0f, 1.0f) + Z_AXIS,
+       rand_float(0.0f, pi)), randomVector(0.2f, 1.5f)));
+
+      // Some boxes cross several groups in one update, and some spin.
+      BoundingBox& box = boxes.back();
+      if (ndx % 2 == 0) {
+         box.setTranslationalVelocity(randomVector(-600.0f, 600.0f));
+      }
+      if (ndx % 5 == 0) {
+         box.setRotationalVelocity(axisAngleToQuat(Z_AXIS, pi * 0.5f));
+      }
+   }
+
+   BoundingPartition boundingPartition(transformer, glm::ivec3(8));
+   for (BoundingBox& box : boxes) {
+      boundingPartition.add(&box);
+   }
+
+   for (float sweepInterval : { 0.0f, delta_t }) {
+      boundingPartition.setSweepInterval(sweepInterval);
+      REQUIRE(boundingPartition.getSweepInterval() == sweepInterval);
+
+      std::vector< Collision > expected;
+      for (unsigned int a = 0; a < boxes.size(); ++a) {
+         for (unsigned int b = a + 1; b < boxes.size(); ++b) {
+            if (boxes[a].getTimeOfImpact(boxes[b], sweepInterval)) {
+               expected.push_back(Collision::factory(&boxes[a], &boxes[b]));
+            }
+         }
+      }
+
+      std::vector< Collision > actual =
+       boundingPartition.getCollidingElements();
+      std::sort(expected.begin(), expected.end());
+      std::sort(actual.begin(), actual.end());
+      REQUIRE(actual.size() == expected.size());
+      for (unsigned int ndx = 0; ndx < actual.size(); ++ndx) {
+         REQUIRE(actual[ndx].getFirst() == expected[ndx].getFirst());
+         REQUIRE(actual[ndx].getSecond() == expected[ndx].getSecond());
+      }
+   }
+
+   // A box that passes through another between updates still collides.
+   BoundingBox fast = makeBox(glm::vec3(-10.0f, 0.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE);
+   fast.setTranslationalVelocity(glm::vec3(1200.0f, 0.0f, 0.0f));
+   BoundingBox still = makeBox(ORIGIN, NO_ROTATION, UNIT_SIZE);
+
+   BoundingPartition pair(transformer, glm::ivec3(8));
+   pair.add(&fast);
+   pair.add(&still);
+   REQUIRE(pair.getCollidingElements().empty());
+   pair.setSweepInterval(delta_t);
+   REQUIRE(pair.getCollidingElements().size() == 1);
+}
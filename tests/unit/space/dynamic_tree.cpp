@@ -0,0 +1,113 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <vector>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/line.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/render/view_frustum.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/dynamic_tree.hpp>
+#include "helpers.hpp"
+
+using namespace crash::common;
+using namespace crash::render;
+using namespace crash::space;
+
+TEST_CASE("crash/space/dynamic_tree/membership") {
+   BoundingBox a(Transformer(ORIGIN, NO_ROTATION, UNIT_SIZE,
+    glm::vec3(), NO_ROTATION, glm::vec3()));
+   BoundingBox b(Transformer(glm::vec3(0.5f, 0.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE, glm::vec3(), NO_ROTATION, glm::vec3()));
+
+   DynamicTree dynamicTree;
+   REQUIRE(dynamicTree.add(&a));
+   REQUIRE(!dynamicTree.add(&a));
+   REQUIRE(dynamicTree.add(&b));
+   REQUIRE(dynamicTree.getNumBoundables() == 2);
+   REQUIRE(dynamicTree.getBoundables().size() == 2);
+   REQUIRE(dynamicTree.getCollidingElements().size() == 1);
+
+   // Movement within the margin does not reinsert the leaf.
+   b.translate(glm::vec3(0.5f * DynamicTree::DEFAULT_MARGIN, 0.0f, 0.0f));
+   REQUIRE(!dynamicTree.update(&b));
+
+   b.setPosition(glm::vec3(2.0f, 0.0f, 0.0f));
+   REQUIRE(dynamicTree.update(&b));
+   REQUIRE(dynamicTree.getCollidingElements().empty());
+
+   REQUIRE(dynamicTree.remove(&a));
+   REQUIRE(!dynamicTree.remove(&a));
+   REQUIRE(dynamicTree.getNumBoundables() == 1);
+   REQUIRE(dynamicTree.getHeight() == 1);
+}
+
+TEST_CASE("crash/space/dynamic_tree/colliding_elements") {
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 300; ++ndx) {
+      boxes.push_back(randomBox(10.0f));
+   }
+
+   DynamicTree dynamicTree;
+   for (BoundingBox& box : boxes) {
+      dynamicTree.add(&box);
+   }
+   requireTracksMovement(dynamicTree, boxes);
+
+   // The tree stays logarithmic in the number of leaves.
+   REQUIRE(dynamicTree.getHeight() < 20);
+}
+
+TEST_CASE("crash/space/dynamic_tree/visible_elements") {
+   ViewFrustum viewFrustum = ViewFrustum::fromValues(glm::radians(60.0f),
+    1.0f, 1.0f, 50.0f, glm::mat4());
+
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 500; ++ndx) {
+      boxes.push_back(randomBox(60.0f));
+   }
+
+   DynamicTree dynamicTree;
+   for (BoundingBox& box : boxes) {
+      dynamicTree.add(&box);
+   }
+
+   std::vector< Boundable* > visible =
+    dynamicTree.getVisibleElements(viewFrustum);
+   std::sort(visible.begin(), visible.end());
+
+   unsigned int numVisible = 0;
+   for (BoundingBox& box : boxes) {
+      bool expected = box.isVisible(viewFrustum);
+      REQUIRE(std::binary_search(visible.begin(), visible.end(),
+       (Boundable*)&box) == expected);
+      numVisible += expected;
+   }
+
+   REQUIRE(numVisible == visible.size());
+}
+
+TEST_CASE("crash/space/dynamic_tree/raycast") {
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 4; ++ndx) {
+      boxes.push_back(BoundingBox(Transformer(
+       glm::vec3(4.0f * ndx, 0.0f, 0.0f), NO_ROTATION, UNIT_SIZE,
+       glm::vec3(), NO_ROTATION, glm::vec3())));
+   }
+   boxes.push_back(BoundingBox(Transformer(glm::vec3(4.0f, 4.0f, 0.0f),
+    NO_ROTATION, UNIT_SIZE, glm::vec3(), NO_ROTATION, glm::vec3())));
+
+   DynamicTree dynamicTree;
+   for (BoundingBox& box : boxes) {
+      dynamicTree.add(&box);
+   }
+
+   Line ray(glm::vec3(-5.0f, 0.0f, 0.0f), glm::vec3(2.0f, 0.0f, 0.0f));
+   std::vector< RayHit > hits = dynamicTree.raycast(ray, 15.0f);
+
+   REQUIRE(hits.size() == 3);
+   for (unsigned int ndx = 0; ndx < hits.size(); ++ndx) {
+      REQUIRE(hits[ndx].boundable == &boxes[ndx]);
+      REQUIRE(glm::abs(hits[ndx].distance - (4.5f + 4.0f * ndx)) < 1e-4f);
+   }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <catch.hpp>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/space/boundable.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/collision.hpp>
+#include <crash/space/spatial_index.hpp>
+
+/**
+ * Build a BoundingBox at rest.
+ */
+inline crash::space::BoundingBox makeBox(const glm::vec3& position,
+ const glm::quat& orientation, const glm::vec3& size) {
+   return crash::space::BoundingBox(crash::common::Transformer(position,
+    orientation, size, glm::vec3(), crash::common::NO_ROTATION, glm::vec3()));
+}
+
+/**
+ * Pick a vector with every component between minimum and maximum.
+ */
+inline glm::vec3 randomVector(float minimum, float maximum) {
+   return glm::vec3(crash::common::rand_float(minimum, maximum),
+    crash::common::rand_float(minimum, maximum),
+    crash::common::rand_float(minimum, maximum));
+}
+
+/**
+ * Pick a vector with every component between -range and range.
+ */
+inline glm::vec3 randomVector(float range) {
+   return randomVector(-range, range);
+}
+
+/**
+ * Build a cube at rest, turned at random, with its center within range of
+ * the given center along every axis.
+ */
+inline crash::space::BoundingBox randomBox(const glm::vec3& center,
+ float range) {
+   return makeBox(center + randomVector(range),
+    crash::common::axisAngleToQuat(randomVector(1.0f),
+    crash::common::rand_float(0.0f, crash::common::pi)),
+    glm::vec3(crash::common::rand_float(0.5f, 2.0f)));
+}
+
+inline crash::space::BoundingBox randomBox(float range) {
+   return randomBox(glm::vec3(), range);
+}
+
+/**
+ * Require two lists of pairs to hold the same pairs, in any order.
+ */
+inline void requireSamePairs(std::vector< crash::space::Collision > actual,
+ std::vector< crash::space::Collision > expected) {
+   std::sort(actual.begin(), actual.end());
+   std::sort(expected.begin(), expected.end());
+
+   REQUIRE(actual.size() == expected.size());
+   for (unsigned int ndx = 0; ndx < actual.size(); ++ndx) {
+      REQUIRE(actual[ndx].getFirst() == expected[ndx].getFirst());
+      REQUIRE(actual[ndx].getSecond() == expected[ndx].getSecond());
+   }
+}
+
+/**
+ * Require a list of pairs to hold no pair twice.
+ */
+inline void requireUniquePairs(std::vector< crash::space::Collision > pairs) {
+   std::sort(pairs.begin(), pairs.end());
+   for (unsigned int ndx = 1; ndx < pairs.size(); ++ndx) {
+      REQUIRE(pairs[ndx - 1] < pairs[ndx]);
+   }
+}
+
+/**
+ * Require an index to report exactly the collidable, intersecting pairs among
+ * the Boundables it tracks, as found by testing every pair.
+ */
+inline void requireIntersectingPairs(const crash::space::SpatialIndex& index) {
+   std::vector< crash::space::Boundable* > boundables = index.getBoundables();
+   std::vector< crash::space::Collision > expected;
+   for (unsigned int a = 0; a < boundables.size(); ++a) {
+      for (unsigned int b = a + 1; b < boundables.size(); ++b) {
+         if (boundables[a]->isCollidable(boundables[b]) &&
+          boundables[a]->isIntersecting(boundables[b])) {
+            expected.push_back(crash::space::Collision::factory(boundables[a],
+             boundables[b]));
+         }
+      }
+   }
+
+   requireSamePairs(index.getCollidingElements(), expected);
+}
+
+/**
+ * Jostle boxes tracked by an index through several steps, taking one of them
+ * out and putting it back each step. The index must report the intersecting
+ * pairs after every change.
+ *
+ * :param index:   The index to exercise, which tracks every box.
+ * :param boxes:   The boxes to move.
+ * :param prepare: Called with the step number before each query.
+ */
+inline void requireTracksMovement(crash::space::SpatialIndex& index,
+ std::vector< crash::space::BoundingBox >& boxes,
+ const std::function< void(unsigned int step) >& prepare) {
+   for (unsigned int step = 0; step < 10; ++step) {
+      for (crash::space::BoundingBox& box : boxes) {
+         box.translate(randomVector(0.5f));
+         index.update(&box);
+      }
+
+      unsigned int removed = crash::common::rand_int(boxes.size() - 1);
+      REQUIRE(index.remove(&boxes[removed]));
+      REQUIRE(!index.remove(&boxes[removed]));
+      REQUIRE(index.getNumBoundables() == boxes.size() - 1);
+
+      prepare(step);
+      requireIntersectingPairs(index);
+
+      REQUIRE(index.add(&boxes[removed]));
+      prepare(step);
+      requireIntersectingPairs(index);
+   }
+}
+
+inline void requireTracksMovement(crash::space::SpatialIndex& index,
+ std::vector< crash::space::BoundingBox >& boxes) {
+   requireTracksMovement(index, boxes, [](unsigned int) {});
+}
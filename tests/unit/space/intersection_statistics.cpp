@@ -0,0 +1,102 @@
+#include <catch.hpp>
+#include <vector>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/collision.hpp>
+#include <crash/space/intersection_statistics.hpp>
+#include <crash/space/narrowphase.hpp>
+#include "helpers.hpp"
+
+using namespace crash::common;
+using namespace crash::space;
+
+static unsigned long countOutcomes(const IntersectionStatistics& statistics) {
+   unsigned long count = statistics.numSphereRejects +
+    statistics.numIntersections;
+   for (unsigned long numSeparations : statistics.numSeparations) {
+      count += numSeparations;
+   }
+   return count;
+}
+
+TEST_CASE("crash/space/intersection_statistics/single") {
+   BoundingBox origin = makeBox(glm::vec3(), NO_ROTATION, UNIT_SIZE);
+   BoundingBox overlapping = makeBox(glm::vec3(0.5f, 0.0f, 0.0f),
+    NO_ROTATION, UNIT_SIZE);
+   BoundingBox separated = makeBox(glm::vec3(0.0f, 2.5f, 0.0f), NO_ROTATION,
+    UNIT_SIZE);
+   BoundingBox distant = makeBox(glm::vec3(10.0f, 0.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE);
+
+   IntersectionStatistics::resetCollected();
+   IntersectionStatistics::setCollecting(false);
+   origin.isIntersecting(&overlapping);
+   REQUIRE(IntersectionStatistics::getCollected().numTests == 0);
+
+   IntersectionStatistics::setCollecting(true);
+   REQUIRE(origin.isIntersecting(&overlapping));
+   REQUIRE(!origin.isIntersecting(&separated));
+   REQUIRE(!origin.isIntersecting(&distant));
+   IntersectionStatistics::setCollecting(false);
+
+   IntersectionStatistics statistics = IntersectionStatistics::getCollected();
+   REQUIRE(statistics.numTests == 3);
+   REQUIRE(statistics.numSphereRejects == 1);
+   REQUIRE(statistics.numIntersections == 1);
+   REQUIRE(statistics.numSeparations[1] == 1);
+   REQUIRE(countOutcomes(statistics) == statistics.numTests);
+   REQUIRE(statistics.getSphereRejectRate() == 1.0f / 3.0f);
+
+   IntersectionStatistics::resetCollected();
+   REQUIRE(IntersectionStatistics::getCollected().numTests == 0);
+}
+
+TEST_CASE("crash/space/intersection_statistics/batch") {
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 200; ++ndx) {
+      boxes.push_back(makeBox(glm::vec3(rand_float(-10.0f, 10.0f),
+       rand_float(-10.0f, 10.0f), rand_float(-10.0f, 10.0f)),
+       axisAngleToQuat(glm::vec3(rand_float(-1.0f, 1.0f), 1.0f,
+       rand_float(-1.0f, 1.0f)), rand_float(0.0f, pi)),
+       glm::vec3(rand_float(0.5f, 3.0f))));
+   }
+
+   std::vector< Collision > candidates;
+   for (unsigned int a = 0; a < boxes.size(); ++a) {
+      for (unsigned int b = a + 1; b < boxes.size(); ++b) {
+         candidates.push_back(Collision::factory(&boxes[a], &boxes[b]));
+      }
+   }
+
+   // The batch and single tests agree on the outcome of every pair, though
+   // not necessarily on which axis separated it.
+   IntersectionStatistics::resetCollected();
+   IntersectionStatistics::setCollecting(true);
+   Narrowphase narrowphase;
+   std::vector< Collision > colliding;
+   narrowphase.collide(candidates, colliding);
+   IntersectionStatistics batch = IntersectionStatistics::getCollected();
+
+   IntersectionStatistics::resetCollected();
+   for (const Collision& candidate : candidates) {
+      candidate.getFirst()->isIntersecting(candidate.getSecond());
+   }
+   IntersectionStatistics single = IntersectionStatistics::getCollected();
+   IntersectionStatistics::setCollecting(false);
+   IntersectionStatistics::resetCollected();
+
+   REQUIRE(batch.numTests == candidates.size());
+   REQUIRE(batch.numIntersections == colliding.size());
+   REQUIRE(countOutcomes(batch) == batch.numTests);
+
+   REQUIRE(single.numTests == candidates.size());
+   REQUIRE(single.numIntersections == colliding.size());
+   REQUIRE(countOutcomes(single) == single.numTests);
+
+   IntersectionStatistics total = batch;
+   total += single;
+   REQUIRE(total.numTests == 2 * candidates.size());
+   REQUIRE(countOutcomes(total) == total.numTests);
+}
@@ -0,0 +1,115 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <vector>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/thread_pool.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/render/view_frustum.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/dynamic_tree.hpp>
+#include <crash/space/linear_bvh.hpp>
+#include "helpers.hpp"
+
+using namespace crash::common;
+using namespace crash::render;
+using namespace crash::space;
+
+TEST_CASE("crash/space/linear_bvh/membership") {
+   BoundingBox a(Transformer(ORIGIN, NO_ROTATION, UNIT_SIZE,
+    glm::vec3(), NO_ROTATION, glm::vec3()));
+   BoundingBox b(Transformer(glm::vec3(0.5f, 0.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE, glm::vec3(), NO_ROTATION, glm::vec3()));
+   BoundingBox c(Transformer(glm::vec3(0.5f, 0.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE, glm::vec3(), NO_ROTATION, glm::vec3()));
+
+   LinearBVH linearBVH;
+   REQUIRE(linearBVH.getCandidateElements().empty());
+   REQUIRE(linearBVH.add(&a));
+   REQUIRE(!linearBVH.add(&a));
+   REQUIRE(linearBVH.getNumNodes() == 1);
+   REQUIRE(linearBVH.getCandidateElements().empty());
+
+   REQUIRE(linearBVH.add(&b));
+   REQUIRE(linearBVH.isStale());
+   REQUIRE(linearBVH.getNumBoundables() == 2);
+   REQUIRE(linearBVH.getBoundables().size() == 2);
+   REQUIRE(linearBVH.getCollidingElements().size() == 1);
+   REQUIRE(!linearBVH.isStale());
+   REQUIRE(linearBVH.getNumNodes() == 3);
+
+   b.setPosition(glm::vec3(2.0f, 0.0f, 0.0f));
+   REQUIRE(!linearBVH.update(&b));
+   REQUIRE(linearBVH.isStale());
+   REQUIRE(linearBVH.getCollidingElements().empty());
+
+   // Boundables with identical centers share a Morton code.
+   REQUIRE(linearBVH.update(&c));
+   b.setPosition(glm::vec3(0.5f, 0.0f, 0.0f));
+   linearBVH.build();
+   REQUIRE(linearBVH.getCollidingElements().size() == 3);
+
+   REQUIRE(linearBVH.remove(&a));
+   REQUIRE(!linearBVH.remove(&a));
+   REQUIRE(linearBVH.getNumBoundables() == 2);
+   REQUIRE(linearBVH.getCollidingElements().size() == 1);
+
+   linearBVH.clear();
+   REQUIRE(linearBVH.getNumBoundables() == 0);
+   REQUIRE(linearBVH.getNumNodes() == 0);
+}
+
+TEST_CASE("crash/space/linear_bvh/colliding_elements") {
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 400; ++ndx) {
+      boxes.push_back(randomBox(12.0f));
+   }
+
+   LinearBVH linearBVH;
+   for (BoundingBox& box : boxes) {
+      linearBVH.add(&box);
+   }
+
+   // Nearly everything moves every step. Builds alternate between serial
+   // and parallel, and each candidate is reported once.
+   ThreadPool threadPool(4);
+   requireTracksMovement(linearBVH, boxes,
+    [&linearBVH, &threadPool](unsigned int step) {
+      linearBVH.setThreadPool((step % 2 == 0) ? nullptr : &threadPool);
+      linearBVH.build();
+      requireUniquePairs(linearBVH.getCandidateElements());
+   });
+
+   // Sorting by Morton code keeps the hierarchy shallow.
+   REQUIRE(linearBVH.getHeight() < 40);
+
+   LinearBVH copy = linearBVH;
+   copy.setThreadPool(nullptr);
+   requireSamePairs(copy.getCollidingElements(),
+    linearBVH.getCollidingElements());
+}
+
+TEST_CASE("crash/space/linear_bvh/visible_elements") {
+   ViewFrustum viewFrustum = ViewFrustum::fromValues(glm::radians(60.0f),
+    1.0f, 1.0f, 50.0f, glm::mat4());
+
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 500; ++ndx) {
+      boxes.push_back(randomBox(60.0f));
+   }
+
+   LinearBVH linearBVH;
+   DynamicTree dynamicTree;
+   for (BoundingBox& box : boxes) {
+      linearBVH.add(&box);
+      dynamicTree.add(&box);
+   }
+
+   std::vector< Boundable* > actual =
+    linearBVH.getVisibleElements(viewFrustum);
+   std::vector< Boundable* > expected =
+    dynamicTree.getVisibleElements(viewFrustum);
+   std::sort(actual.begin(), actual.end());
+   std::sort(expected.begin(), expected.end());
+   REQUIRE(actual == expected);
+}
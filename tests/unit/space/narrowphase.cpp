@@ -0,0 +1,192 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/collision.hpp>
+#include <crash/space/narrowphase.hpp>
+#include "helpers.hpp"
+
+using namespace crash::common;
+using namespace crash::space;
+
+static bool projectionsOverlap(BoundingBox& a, BoundingBox& b,
+ const glm::vec3& axis) {
+   float aMin = glm::dot(a.getCorners()[0], axis);
+   float aMax = aMin;
+   float bMin = glm::dot(b.getCorners()[0], axis);
+   float bMax = bMin;
+   for (unsigned int ndx = 1; ndx < BoundingBox::NUM_CORNERS; ++ndx) {
+      aMin = std::min(aMin, glm::dot(a.getCorners()[ndx], axis));
+      aMax = std::max(aMax, glm::dot(a.getCorners()[ndx], axis));
+      bMin = std::min(bMin, glm::dot(b.getCorners()[ndx], axis));
+      bMax = std::max(bMax, glm::dot(b.getCorners()[ndx], axis));
+   }
+   return aMin <= bMax && bMin <= aMax;
+}
+
+// Reference separating axis test that projects every corner onto all 15 axes.
+static bool referenceIntersection(BoundingBox& a, BoundingBox& b) {
+   glm::mat4 aRotation = glm::mat4_cast(a.getOrientation());
+   glm::mat4 bRotation = glm::mat4_cast(b.getOrientation());
+
+   std::vector< glm::vec3 > axes;
+   for (unsigned int i = 0; i < 3; ++i) {
+      axes.push_back(glm::vec3(aRotation[i]));
+      axes.push_back(glm::vec3(bRotation[i]));
+      for (unsigned int j = 0; j < 3; ++j) {
+         glm::vec3 axis = glm::cross(glm::vec3(aRotation[i]),
+          glm::vec3(bRotation[j]));
+         if (glm::dot(axis, axis) > 1.0e-6f) {
+            axes.push_back(axis);
+         }
+      }
+   }
+
+   for (const glm::vec3& axis : axes) {
+      if (!projectionsOverlap(a, b, axis)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+TEST_CASE("crash/space/narrowphase/known_pairs") {
+   glm::quat turned = axisAngleToQuat(Z_AXIS, pi * 0.25f);
+
+   std::vector< BoundingBox > boxes = {
+      makeBox(ORIGIN, NO_ROTATION, UNIT_SIZE),
+      makeBox(glm::vec3(0.9f, 0.0f, 0.0f), NO_ROTATION, UNIT_SIZE),
+      makeBox(glm::vec3(1.1f, 0.0f, 0.0f), NO_ROTATION, UNIT_SIZE),
+      makeBox(glm::vec3(1.15f, 0.0f, 0.0f), turned, UNIT_SIZE),
+      makeBox(glm::vec3(1.25f, 0.0f, 0.0f), turned, UNIT_SIZE),
+      makeBox(glm::vec3(10.0f, 0.0f, 0.0f), NO_ROTATION, UNIT_SIZE),
+   };
+
+   std::vector< Collision > candidates;
+   for (unsigned int ndx = 1; ndx < boxes.size(); ++ndx) {
+      candidates.push_back(Collision::factory(&boxes[0], &boxes[ndx]));
+   }
+
+   Narrowphase narrowphase;
+   std::vector< Collision > colliding;
+   narrowphase.collide(candidates, colliding);
+
+   REQUIRE(colliding.size() == 2);
+
+   std::vector< Boundable* > hits;
+   for (const Collision& collision : colliding) {
+      hits.push_back(collision.getFirst() == &boxes[0] ?
+       collision.getSecond() : collision.getFirst());
+   }
+   REQUIRE(std::find(hits.begin(), hits.end(), &boxes[1]) != hits.end());
+   REQUIRE(std::find(hits.begin(), hits.end(), &boxes[3]) != hits.end());
+}
+
+TEST_CASE("crash/space/narrowphase/random_pairs") {
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 61; ++ndx) {
+      glm::vec3 position = glm::vec3(rand_float(-4.0f, 4.0f),
+       rand_float(-4.0f, 4.0f), rand_float(-4.0f, 4.0f));
+      glm::quat orientation = axisAngleToQuat(glm::vec3(
+       rand_float(-1.0f, 1.0f), rand_float(-1.0f, 1.0f), 1.0f),
+       rand_float(0.0f, pi));
+      glm::vec3 size = glm::vec3(rand_float(0.5f, 3.0f),
+       rand_float(0.5f, 3.0f), rand_float(0.5f, 3.0f));
+      boxes.push_back(makeBox(position, orientation, size));
+   }
+
+   std::vector< Collision > candidates;
+   for (unsigned int a = 0; a < boxes.size(); ++a) {
+      for (unsigned int b = a + 1; b < boxes.size(); ++b) {
+         candidates.push_back(Collision::factory(&boxes[a], &boxes[b]));
+      }
+   }
+
+   Narrowphase narrowphase;
+   std::vector< Collision > colliding;
+   narrowphase.collide(candidates, colliding);
+
+   unsigned int expected = 0;
+   for (unsigned int a = 0; a < boxes.size(); ++a) {
+      for (unsigned int b = a + 1; b < boxes.size(); ++b) {
+         expected += referenceIntersection(boxes[a], boxes[b]);
+      }
+   }
+
+   REQUIRE(colliding.size() == expected);
+   for (const Collision& collision : colliding) {
+      REQUIRE(referenceIntersection(
+       *collision.getFirst()->getBoundingBox(),
+       *collision.getSecond()->getBoundingBox()));
+   }
+}
+
+TEST_CASE("crash/space/narrowphase/time_of_impact") {
+   float delta_t = 1.0f / 60.0f;
+
+   // The box travels 20 units in one update, entirely past the other.
+   BoundingBox fast = makeBox(glm::vec3(-10.0f, 0.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE);
+   fast.setTranslationalVelocity(glm::vec3(1200.0f, 0.0f, 0.0f));
+   BoundingBox still = makeBox(ORIGIN, NO_ROTATION, UNIT_SIZE);
+   BoundingBox aside = makeBox(glm::vec3(0.0f, 5.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE);
+
+   REQUIRE(!fast.isIntersecting(&still));
+   REQUIRE(!fast.getMoved(delta_t).isIntersecting(&still));
+
+   // Boxes that only translate are swept exactly.
+   boost::optional< float > impact = fast.getTimeOfImpact(still, delta_t);
+   REQUIRE(impact);
+   REQUIRE(std::abs(*impact - 9.0f / 1200.0f) < 1e-5f);
+   REQUIRE(still.getTimeOfImpact(fast, delta_t));
+   REQUIRE(!fast.getTimeOfImpact(aside, delta_t));
+   REQUIRE(!fast.getTimeOfImpact(still, 0.005f));
+
+   // A long bar sweeps over the box while turning almost half way around.
+   BoundingBox bar = makeBox(ORIGIN, NO_ROTATION,
+    glm::vec3(10.0f, 0.2f, 0.2f));
+   bar.setRotationalVelocity(axisAngleToQuat(Y_AXIS, pi * 0.9f));
+   BoundingBox target = makeBox(glm::vec3(0.0f, 0.0f, 3.0f), NO_ROTATION,
+    UNIT_SIZE);
+   REQUIRE(!bar.getMoved(1.0f).isIntersecting(&target));
+   impact = bar.getTimeOfImpact(target, 1.0f);
+   REQUIRE(impact);
+   REQUIRE(*impact > 0.0f);
+   REQUIRE(*impact < 1.0f);
+
+   // A thin plate passes through the box between any two of the moments a
+   // search of the finest depth would sample.
+   BoundingBox plate = makeBox(glm::vec3(-507.0f, 0.0f, 0.0f), NO_ROTATION,
+    glm::vec3(0.01f, 4.0f, 4.0f));
+   plate.setTranslationalVelocity(glm::vec3(1000.0f, 0.0f, 0.0f));
+   for (unsigned int ndx = 0; ndx <= (1 << BoundingBox::MAX_IMPACT_DEPTH);
+    ++ndx) {
+      float sample = (float)ndx / (1 << BoundingBox::MAX_IMPACT_DEPTH);
+      REQUIRE(!plate.getMoved(sample).isIntersecting(&still));
+   }
+   impact = plate.getTimeOfImpact(still, 1.0f);
+   REQUIRE(impact);
+   REQUIRE(std::abs(*impact - 506.495f / 1000.0f) < 1e-4f);
+
+   BoundingBox::Extents extents = bar.getSweptExtents(1.0f);
+   REQUIRE(extents[0].z < -4.9f);
+   REQUIRE(extents[1].z > 4.9f);
+
+   std::vector< Collision > candidates = {
+      Collision::factory(&fast, &still),
+      Collision::factory(&fast, &aside),
+   };
+   Narrowphase narrowphase;
+   std::vector< Collision > colliding;
+   narrowphase.collide(candidates, colliding);
+   REQUIRE(colliding.empty());
+   narrowphase.collide(candidates, colliding, delta_t);
+   REQUIRE(colliding.size() == 1);
+   REQUIRE(std::abs(colliding[0].getTimeOfImpact() - 9.0f / 1200.0f) <
+    1e-5f);
+}
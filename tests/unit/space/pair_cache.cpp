@@ -0,0 +1,135 @@
+#include <catch.hpp>
+#include <vector>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/collision.hpp>
+#include <crash/space/pair_cache.hpp>
+#include "helpers.hpp"
+
+using namespace crash::common;
+using namespace crash::space;
+
+TEST_CASE("crash/space/pair_cache/events") {
+   BoundingBox a = makeBox(ORIGIN, NO_ROTATION, UNIT_SIZE);
+   BoundingBox b = makeBox(glm::vec3(0.5f, 0.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE);
+   std::vector< Collision > candidates = { Collision::factory(&a, &b) };
+
+   PairCache pairCache;
+   pairCache.update(candidates);
+   REQUIRE(pairCache.getBegun().size() == 1);
+   REQUIRE(pairCache.getStaying().empty());
+   REQUIRE(pairCache.getEnded().empty());
+
+   pairCache.update(candidates);
+   REQUIRE(pairCache.getBegun().empty());
+   REQUIRE(pairCache.getStaying().size() == 1);
+   REQUIRE(pairCache.getColliding().size() == 1);
+
+   b.setPosition(glm::vec3(3.0f, 0.0f, 0.0f));
+   pairCache.update(candidates);
+   REQUIRE(pairCache.getStaying().empty());
+   REQUIRE(pairCache.getEnded().size() == 1);
+   REQUIRE(pairCache.getNumPairs() == 1);
+
+   pairCache.update(candidates);
+   REQUIRE(pairCache.getEnded().empty());
+   REQUIRE(pairCache.getColliding().empty());
+
+   b.setPosition(glm::vec3(0.5f, 0.0f, 0.0f));
+   pairCache.update(candidates);
+   REQUIRE(pairCache.getBegun().size() == 1);
+
+   // A pair the broadphase stops reporting ends and is forgotten.
+   pairCache.update(std::vector< Collision >());
+   REQUIRE(pairCache.getEnded().size() == 1);
+   REQUIRE(pairCache.getNumPairs() == 0);
+}
+
+TEST_CASE("crash/space/pair_cache/orientation") {
+   BoundingBox a = makeBox(ORIGIN, NO_ROTATION, UNIT_SIZE);
+   BoundingBox b = makeBox(glm::vec3(0.5f, 0.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE);
+   std::vector< Collision > forward = { Collision::factory(&a, &b) };
+   std::vector< Collision > backward = { Collision::factory(&b, &a) };
+
+   PairCache pairCache;
+   pairCache.update(forward);
+   REQUIRE(pairCache.getBegun().size() == 1);
+
+   // A pair reported the other way around is the same pair.
+   pairCache.update(backward);
+   REQUIRE(pairCache.getBegun().empty());
+   REQUIRE(pairCache.getStaying().size() == 1);
+   REQUIRE(pairCache.getEnded().empty());
+   REQUIRE(pairCache.getNumPairs() == 1);
+
+   b.setPosition(glm::vec3(3.0f, 0.0f, 0.0f));
+   pairCache.update(forward);
+   REQUIRE(pairCache.getEnded().size() == 1);
+   REQUIRE(pairCache.getNumPairs() == 1);
+
+   pairCache.update(backward);
+   REQUIRE(pairCache.getEnded().empty());
+   REQUIRE(pairCache.getColliding().empty());
+   REQUIRE(pairCache.getNumPairs() == 1);
+}
+
+TEST_CASE("crash/space/pair_cache/separating_axis_hint") {
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 41; ++ndx) {
+      glm::vec3 position = glm::vec3(rand_float(-4.0f, 4.0f),
+       rand_float(-4.0f, 4.0f), rand_float(-4.0f, 4.0f));
+      glm::quat orientation = axisAngleToQuat(glm::vec3(
+       rand_float(-1.0f, 1.0f), rand_float(-1.0f, 1.0f), 1.0f),
+       rand_float(0.0f, pi));
+      glm::vec3 size = glm::vec3(rand_float(0.5f, 3.0f),
+       rand_float(0.5f, 3.0f), rand_float(0.5f, 3.0f));
+      boxes.push_back(makeBox(position, orientation, size));
+   }
+
+   for (unsigned int a = 0; a < boxes.size(); ++a) {
+      for (unsigned int b = a + 1; b < boxes.size(); ++b) {
+         bool expected = boxes[a].isIntersecting(&boxes[b]);
+
+         // Every hint, valid or stale, must give the same answer.
+         for (int hint = BoundingBox::NO_AXIS;
+          hint < BoundingBox::NUM_SEPARATING_AXES; ++hint) {
+            int separatingAxis = hint;
+            REQUIRE(boxes[a].isIntersecting(&boxes[b], separatingAxis) ==
+             expected);
+            if (expected) {
+               REQUIRE(separatingAxis == BoundingBox::NO_AXIS);
+            }
+         }
+      }
+   }
+}
+
+TEST_CASE("crash/space/pair_cache/sweep") {
+   // The box passes entirely through the other within the interval.
+   BoundingBox fast = makeBox(glm::vec3(-10.0f, 0.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE);
+   fast.setTranslationalVelocity(glm::vec3(1200.0f, 0.0f, 0.0f));
+   BoundingBox still = makeBox(ORIGIN, NO_ROTATION, UNIT_SIZE);
+   std::vector< Collision > candidates = {
+      Collision::factory(&fast, &still),
+   };
+
+   PairCache pairCache;
+   pairCache.update(candidates);
+   REQUIRE(pairCache.getBegun().empty());
+
+   pairCache.update(candidates, 1.0f / 60.0f);
+   REQUIRE(pairCache.getBegun().size() == 1);
+   REQUIRE(pairCache.getBegun()[0].getTimeOfImpact() > 0.0f);
+   REQUIRE(pairCache.getBegun()[0].getTimeOfImpact() < 1.0f / 60.0f);
+
+   // Pairs intersecting now touch at once.
+   fast.setPosition(ORIGIN);
+   pairCache.update(candidates, 1.0f / 60.0f);
+   REQUIRE(pairCache.getStaying().size() == 1);
+   REQUIRE(pairCache.getStaying()[0].getTimeOfImpact() == 0.0f);
+}
@@ -0,0 +1,124 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <vector>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/plane.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/render/view_frustum.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/spatial_hash.hpp>
+#include "helpers.hpp"
+
+using namespace crash::common;
+using namespace crash::render;
+using namespace crash::space;
+
+TEST_CASE("crash/space/spatial_hash/membership") {
+   BoundingBox a(Transformer(ORIGIN, NO_ROTATION, UNIT_SIZE,
+    glm::vec3(), NO_ROTATION, glm::vec3()));
+   BoundingBox b(Transformer(glm::vec3(0.5f, 0.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE, glm::vec3(), NO_ROTATION, glm::vec3()));
+
+   SpatialHash spatialHash(4.0f);
+   REQUIRE(spatialHash.add(&a));
+   REQUIRE(!spatialHash.add(&a));
+   REQUIRE(spatialHash.add(&b));
+   REQUIRE(spatialHash.getNumBoundables() == 2);
+   REQUIRE(spatialHash.getBoundables().size() == 2);
+   REQUIRE(spatialHash.getCollidingElements().size() == 1);
+
+   // Movement within the same cells leaves the table untouched.
+   b.translate(glm::vec3(0.25f, 0.0f, 0.0f));
+   REQUIRE(!spatialHash.update(&b));
+
+   // The world has no bounds, and distant cells are only stored while they
+   // have members.
+   unsigned int numCells = spatialHash.getNumCells();
+   b.setPosition(glm::vec3(1.0e5f, -2.0e5f, 3.0e5f));
+   REQUIRE(spatialHash.update(&b));
+   REQUIRE(spatialHash.getCollidingElements().empty());
+   REQUIRE(spatialHash.getCandidateElements().empty());
+
+   REQUIRE(spatialHash.remove(&b));
+   REQUIRE(!spatialHash.remove(&b));
+   REQUIRE(spatialHash.getNumBoundables() == 1);
+   REQUIRE(spatialHash.getNumCells() <= numCells);
+
+   REQUIRE(spatialHash.remove(&a));
+   REQUIRE(spatialHash.getNumCells() == 0);
+}
+
+TEST_CASE("crash/space/spatial_hash/colliding_elements") {
+   // Clusters of Boundables far apart from one another, as in an open world.
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 300; ++ndx) {
+      glm::vec3 cluster(float(ndx % 3) * 5000.0f, 0.0f,
+       -float(ndx % 2) * 8000.0f);
+      boxes.push_back(randomBox(cluster, 8.0f));
+   }
+
+   // A Boundable spanning many cells is kept aside and paired with all.
+   boxes.push_back(BoundingBox(Transformer(ORIGIN, NO_ROTATION,
+    glm::vec3(40.0f), glm::vec3(), NO_ROTATION, glm::vec3())));
+
+   SpatialHash spatialHash(3.0f);
+   for (BoundingBox& box : boxes) {
+      spatialHash.add(&box);
+   }
+   REQUIRE(spatialHash.getNumOversized() == 1);
+
+   // Each candidate is reported once.
+   requireTracksMovement(spatialHash, boxes,
+    [&spatialHash](unsigned int) {
+      requireUniquePairs(spatialHash.getCandidateElements());
+   });
+
+   SpatialHash copy = spatialHash;
+   requireSamePairs(copy.getCollidingElements(),
+    spatialHash.getCollidingElements());
+
+   spatialHash.clear();
+   REQUIRE(spatialHash.getNumBoundables() == 0);
+   REQUIRE(spatialHash.getNumCells() == 0);
+   REQUIRE(spatialHash.getCandidateElements().empty());
+}
+
+TEST_CASE("crash/space/spatial_hash/visible_elements") {
+   ViewFrustum viewFrustum = ViewFrustum::fromValues(glm::radians(60.0f),
+    1.0f, 1.0f, 50.0f, glm::mat4());
+
+   std::vector< BoundingBox > boxes;
+   for (unsigned int ndx = 0; ndx < 500; ++ndx) {
+      boxes.push_back(randomBox(ORIGIN, 60.0f));
+   }
+
+   SpatialHash spatialHash(8.0f);
+   for (BoundingBox& box : boxes) {
+      spatialHash.add(&box);
+   }
+
+   for (unsigned int step = 0; step < 2; ++step) {
+      std::vector< Boundable* > visible =
+       spatialHash.getVisibleElements(viewFrustum);
+      std::sort(visible.begin(), visible.end());
+      REQUIRE(std::unique(visible.begin(), visible.end()) == visible.end());
+
+      for (BoundingBox& box : boxes) {
+         bool reported = std::binary_search(visible.begin(), visible.end(),
+          (Boundable*)&box);
+         if (reported) {
+            REQUIRE(box.isVisible(viewFrustum));
+         }
+
+         // Boundables whose centers lie within the frustum are never culled.
+         bool inside = true;
+         for (const Plane& plane : viewFrustum.getPlanes()) {
+            inside &= plane.distance(box.getPosition()) > 0.0f;
+         }
+         if (inside) {
+            REQUIRE(reported);
+         }
+      }
+   }
+}
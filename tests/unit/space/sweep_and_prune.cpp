@@ -0,0 +1,101 @@
+#include <catch.hpp>
+#include <vector>
+#include <crash/common/arithmetic.hpp>
+#include <crash/common/symbols.hpp>
+#include <crash/common/transformer.hpp>
+#include <crash/space/bounding_box.hpp>
+#include <crash/space/sweep_and_prune.hpp>
+#include "helpers.hpp"
+
+using namespace crash::common;
+using namespace crash::space;
+
+static unsigned int countOverlaps(std::vector< BoundingBox >& boxes,
+ const std::vector< bool >& present) {
+   unsigned int count = 0;
+   for (unsigned int a = 0; a < boxes.size(); ++a) {
+      for (unsigned int b = a + 1; b < boxes.size(); ++b) {
+         if (!present[a] || !present[b]) {
+            continue;
+         }
+
+         auto aExtents = boxes[a].getExtents();
+         auto bExtents = boxes[b].getExtents();
+         bool overlapping = true;
+         for (unsigned int axis = 0; axis < 3; ++axis) {
+            overlapping &= aExtents[0][axis] <= bExtents[1][axis] &&
+             bExtents[0][axis] <= aExtents[1][axis];
+         }
+         count += overlapping;
+      }
+   }
+   return count;
+}
+
+TEST_CASE("crash/space/sweep_and_prune/membership") {
+   BoundingBox a(Transformer(ORIGIN, NO_ROTATION, UNIT_SIZE,
+    glm::vec3(), NO_ROTATION, glm::vec3()));
+   BoundingBox b(Transformer(glm::vec3(0.5f, 0.0f, 0.0f), NO_ROTATION,
+    UNIT_SIZE, glm::vec3(), NO_ROTATION, glm::vec3()));
+
+   SweepAndPrune sweepAndPrune;
+   REQUIRE(sweepAndPrune.add(&a));
+   REQUIRE(!sweepAndPrune.add(&a));
+   REQUIRE(sweepAndPrune.add(&b));
+   REQUIRE(sweepAndPrune.getNumBoundables() == 2);
+   REQUIRE(sweepAndPrune.getBoundables().size() == 2);
+   REQUIRE(sweepAndPrune.getCollidingElements().size() == 1);
+
+   b.setPosition(glm::vec3(2.0f, 0.0f, 0.0f));
+   REQUIRE(sweepAndPrune.update(&b));
+   REQUIRE(sweepAndPrune.getNumOverlappingPairs() == 0);
+   REQUIRE(sweepAndPrune.getCollidingElements().empty());
+
+   // Touching boxes overlap.
+   b.setPosition(glm::vec3(1.0f, 0.0f, 0.0f));
+   REQUIRE(sweepAndPrune.update(&b));
+   REQUIRE(sweepAndPrune.getNumOverlappingPairs() == 1);
+
+   REQUIRE(sweepAndPrune.remove(&a));
+   REQUIRE(!sweepAndPrune.remove(&a));
+   REQUIRE(sweepAndPrune.getNumBoundables() == 1);
+}
+
+TEST_CASE("crash/space/sweep_and_prune/incremental_pairs") {
+   std::vector< BoundingBox > boxes;
+   std::vector< bool > present;
+   for (unsigned int ndx = 0; ndx < 200; ++ndx) {
+      boxes.push_back(BoundingBox(Transformer(randomVector(10.0f),
+       axisAngleToQuat(randomVector(1.0f), rand_float(0.0f, pi)),
+       glm::vec3(rand_float(0.5f, 2.0f)),
+       glm::vec3(), NO_ROTATION, glm::vec3())));
+      present.push_back(true);
+   }
+
+   SweepAndPrune sweepAndPrune;
+   for (BoundingBox& box : boxes) {
+      sweepAndPrune.add(&box);
+   }
+   REQUIRE(sweepAndPrune.getNumOverlappingPairs() ==
+    countOverlaps(boxes, present));
+
+   for (unsigned int step = 0; step < 20; ++step) {
+      for (unsigned int ndx = 0; ndx < boxes.size(); ++ndx) {
+         boxes[ndx].translate(randomVector(0.5f));
+         if (present[ndx]) {
+            sweepAndPrune.update(&boxes[ndx]);
+         }
+      }
+
+      unsigned int toggled = rand_int(boxes.size() - 1);
+      if (present[toggled]) {
+         REQUIRE(sweepAndPrune.remove(&boxes[toggled]));
+      } else {
+         REQUIRE(sweepAndPrune.add(&boxes[toggled]));
+      }
+      present[toggled] = !present[toggled];
+
+      REQUIRE(sweepAndPrune.getNumOverlappingPairs() ==
+       countOverlaps(boxes, present));
+   }
+}